@@ -1,22 +1,39 @@
-from os import scandir, path
-import pprint
-import re
+from os import walk, path
+import json
 import csv
 import itertools
+import statistics
 
-LOGS_DIR="./logs/Polybench"
-LOG_CPU_PREFIX="cpu"
-LOG_OMP_CPU_PREFIX="omp_cpu"
-LOG_OMP_GPU_PREFIX="omp_gpu"
-
-KERNEL_SIZES=(512, 1024, 2048, 4096)
-KERNEL_SIZES_NAMES = {
-    512: 'Mini',
-    1024: 'Small',
-    2048: 'Medium',
-    4096: 'Large',
+LOGS_DIR="./logs"
+RESULTS_FILENAME="results.jsonl"
+
+# device names written by the benchmarks and their column names
+DEVICES = {
+    'CPU': 'cpu',
+    'OMP CPU': 'omp_cpu',
+    'OMP GPU': 'omp_gpu',
 }
 
+# work that the records may declare, see benchmarks/common/BenchmarksResults.h
+WORK_FIELDS = ('flops', 'bytes', 'edges', 'queries', 'iterations')
+
+
+def split_device(device:str) -> tuple:
+    """Splits a device name into its column name and flavour
+
+    Variants that run in several flavours append it to the device name, e.g.
+    'OMP CPU avx2' for the SIMD variant built for AVX2.
+
+    Returns: (column name, flavour), the flavour being None when there is
+    none, or (None, None) for unknown devices
+    """
+    for name, column in DEVICES.items():
+        if device == name:
+            return column, None
+        if device and device.startswith(name + ' '):
+            return column, device[len(name) + 1:]
+    return None, None
+
 
 def get_speedup(cpu_t:float, acc_t:float) -> float:
     """Computes the speedup in offloading to accelerator compared to sequential
@@ -39,99 +56,129 @@ def get_speedup(cpu_t:float, acc_t:float) -> float:
     else:
         return cpu_t/acc_t
 
-def parse_kernel_log(filepath):
-    """Parses a log file with execution time measurements and returns the
-    average
+def parse_results_file(filepath):
+    """Parses a JSON-lines results file written by the benchmarks
 
     Args:
-        filepath: The path to the log file (str)
-    
+        filepath: The path to the results file (str)
+
     Returns:
-        The average time or None if no data is available or parsing failed
+        The list of records, skipping lines that are not valid JSON
     """
+    records = []
     try:
         with open(filepath, "r") as f:
-            # parse all measured times
-            times = re.findall(r'Runtime \(\d+\): (\d+.\d+)', f.read())
-            # convert time values to floats
-            times = [float(t) for t in times]
-            # return the average time if non-empty list
-            if times:
-                return sum(times)/len(times)
-            else:
-                return None
-    except:
+            for line in f:
+                try:
+                    records.append(json.loads(line))
+                except ValueError:
+                    print(f'[DEBUG] Skipping malformed line in {filepath}')
+    except OSError:
         print(f'[DEBUG] Failed to open {filepath}')
-        return None
+    return records
 
-def parse_all_kernel_logs(path:str) -> dict:
-    """Parses all logs with respect to a kernel, located on the same parent dir
+def parse_results() -> dict:
+    """Parses all results files under LOGS_DIR
 
-    Given a path, e.g. ./logs/Polybench/2MM, it iterates over the logs with
-    filenames `<target prefix>_<size>.log`, parses the execution times and
-    stores the average on a dictionary. It adds the speedups relative to CPU
-    sequential runtime.
+    Groups the per-iteration times by kernel, size and device, then stores the
+    median time of each group and the speedups relative to CPU sequential
+    runtime. For kernels that declare their work, it also stores the
+    arithmetic intensity and the achieved GFLOP/s and GB/s on each device, and
+    for graph kernels the traversed edges per second (GTEPS), for batches of
+    queries the queries answered per second and for time-stepped solvers the
+    iterations per second.
 
-    Args:
-        path: The parent directory for a kenel's log files
-    
-    Returns: Nested dictionary with average execution times and speedup values
-    for different problem sizes
+    Returns: Nested dictionary {kernel: {size: {column: value}}}
     """
-    # dict for storing the times per kernel sizes
-    times = dict()
-
-    # formats floating point numbers as strings, with the number of decimal digits
-    # set in 'FLOAT_DIGITS'
+    samples = dict()
+    work = dict()
+    for root, _, files in walk(LOGS_DIR):
+        if RESULTS_FILENAME not in files:
+            continue
+        for r in parse_results_file(path.join(root, RESULTS_FILENAME)):
+            device, flavour = split_device(r.get('device'))
+            if device is None:
+                continue
+            # each flavour is reported as a kernel of its own, and so is each
+            # precision other than the default single precision, each memory
+            # placement other than the default first touch, each cache mode
+            # other than the default steady state and each huge page backing
+            kernel = r['kernel'] + (f'/{flavour}' if flavour else '')
+            if r.get('precision', 'fp32') != 'fp32':
+                kernel += f"/{r['precision']}"
+            if r.get('mempolicy', 'default') != 'default':
+                kernel += f"/{r['mempolicy']}"
+            if r.get('cache', 'steady') != 'steady':
+                kernel += f"/{r['cache']}"
+            if r.get('hugepages', 'none') != 'none':
+                kernel += f"/{r['hugepages']}"
+            key = (kernel, r['size'], device)
+            samples.setdefault(key, []).extend(
+                t for t in r.get('times', []) if t is not None)
+            if any(r.get(k) for k in WORK_FIELDS):
+                work[(kernel, r['size'])] = \
+                    tuple(r.get(k) or 0.0 for k in WORK_FIELDS)
+
+    # formats floating point numbers as strings, with n decimal digits
     format_float = lambda f, n: format(f, f'.{n}f') if f else "nan"
 
-    for s in KERNEL_SIZES:
-        cpu_t = parse_kernel_log(f'{path}/{LOG_CPU_PREFIX}_{s}.log')
-        omp_cpu_t = parse_kernel_log(f'{path}/{LOG_OMP_CPU_PREFIX}_{s}.log')
-        omp_gpu_t = parse_kernel_log(f'{path}/{LOG_OMP_GPU_PREFIX}_{s}.log')
-        speedup_omp_cpu = get_speedup(cpu_t, omp_cpu_t)
-        speedup_omp_gpu = get_speedup(cpu_t, omp_gpu_t)
-        
-        times[s] = {
-            'cpu': format_float(cpu_t, 6),
-            'omp_cpu': format_float(omp_cpu_t, 6),
-            'omp_gpu': format_float(omp_gpu_t, 6),
-            'speedup_omp_cpu':  format_float(speedup_omp_cpu, 2),
-            'speedup_omp_gpu': format_float(speedup_omp_gpu, 2),
-        }
-    
-    return times
-
-def parse_logs():
     times = dict()
-    for kernel_dir in scandir(LOGS_DIR):
-        if kernel_dir.is_dir():
-            times[kernel_dir.name] = parse_all_kernel_logs(kernel_dir.path)
-    
+    for (kernel, size, device), t in samples.items():
+        if t:
+            times.setdefault(kernel, {}).setdefault(size, {})[device] = \
+                statistics.median(t)
+
+    # achieved rate in G<unit>/s, given the work of one run
+    rate = lambda amount, t: amount / t * 1e-9 if amount and t else None
+
+    for kernel, sizes in times.items():
+        for size, m in sizes.items():
+            cpu_t = m.get('cpu')
+            omp_cpu_t = m.get('omp_cpu')
+            omp_gpu_t = m.get('omp_gpu')
+            flops, nbytes, edges, queries, iterations = \
+                work.get((kernel, size), (0.0,) * len(WORK_FIELDS))
+            sizes[size] = {
+                'cpu': format_float(cpu_t, 6),
+                'omp_cpu': format_float(omp_cpu_t, 6),
+                'omp_gpu': format_float(omp_gpu_t, 6),
+                'speedup_omp_cpu': format_float(get_speedup(cpu_t, omp_cpu_t), 2),
+                'speedup_omp_gpu': format_float(get_speedup(cpu_t, omp_gpu_t), 2),
+                'ai': format_float(flops / nbytes if nbytes else None, 3),
+            }
+            for device in DEVICES.values():
+                sizes[size][f'gflops_{device}'] = \
+                    format_float(rate(flops, m.get(device)), 3)
+                sizes[size][f'gbs_{device}'] = \
+                    format_float(rate(nbytes, m.get(device)), 3)
+                sizes[size][f'gteps_{device}'] = \
+                    format_float(rate(edges, m.get(device)), 3)
+                sizes[size][f'qps_{device}'] = \
+                    format_float(queries / m[device]
+                                 if queries and m.get(device) else None, 1)
+                sizes[size][f'ips_{device}'] = \
+                    format_float(iterations / m[device]
+                                 if iterations and m.get(device) else None, 1)
+
     return times
 
-def dump_csv(times):
-    with open('polybench.csv', 'w') as f:
+def dump_csv(times, filename='results.csv'):
+    with open(filename, 'w') as f:
         writer = csv.writer(f, delimiter=',')
 
-        # product of kernel sizes and type of target device
-        cols = itertools.product(KERNEL_SIZES, ('cpu', 'ompCpu', 'ompGpu', 'speedOmpCpu', 'speedOmpGpu'))
-        
-        # write the header
-        header = ['kernelName'] + [f'{target}{KERNEL_SIZES_NAMES[size]}' for size, target in cols]
-        writer.writerow(header)
-
-        # sort by kernel name
-        times = {k:times[k] for k in sorted(times.keys())}
+        cols = ('cpu', 'omp_cpu', 'omp_gpu', 'speedup_omp_cpu', 'speedup_omp_gpu',
+                'ai') + tuple(f'{unit}_{device}'
+                              for unit in ('gflops', 'gbs', 'gteps', 'qps',
+                                           'ips')
+                              for device in DEVICES.values())
+        writer.writerow(['kernelName', 'size'] + list(cols))
 
-        # for each kernel, dump the timings
-        for kernel, measures in times.items():
-            # chain all measures for each kernel size, creating a plain list of measures in seconds
-            # and respecting the header ordering: cpu_512, omp_cpu_512, omp_gpu_512, cpu_1024, ...
-            t = list(itertools.chain.from_iterable([_.values() for _ in measures.values()]))
-            # write the row (kernel name followed by times)
-            writer.writerow([kernel] + t)
+        # one row per kernel and size, sorted by kernel name then size
+        for kernel in sorted(times.keys()):
+            for size in sorted(times[kernel].keys()):
+                measures = times[kernel][size]
+                writer.writerow([kernel, size] + [measures[c] for c in cols])
 
 if __name__ == "__main__":
-    times = parse_logs()
-    dump_csv(times)
\ No newline at end of file
+    times = parse_results()
+    dump_csv(times)
@@ -86,10 +86,10 @@ int main(int argc, char *argv[]) {
   DATA_TYPE *C;
   DATA_TYPE *C_OMP;
 
-  A = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
-  B = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
-  C = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
-  C_OMP = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
+  A = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  B = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  C = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  C_OMP = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
 
   fprintf(stdout, ">> Two vector multiplication <<\n");
 
@@ -100,20 +100,22 @@ int main(int argc, char *argv[]) {
   vec_mult_OMP(A, B, C_OMP);
   t_end_OMP = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end_OMP - t_start_OMP); //);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, N, t_end_OMP - t_start_OMP);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   vec_mult(A, B, C);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start); //);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", N, t_end - t_start);
 
   fail = compareResults(C, C_OMP);
 #endif
 
-  free(A);
-  free(B);
-  free(C);
-  free(C_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(C);
+  bench_free(C_OMP);
 
   return fail;
 }
@@ -3,6 +3,7 @@
  */
 
 #include "parboil.h"
+#include "BenchmarksResults.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -561,6 +562,21 @@ void pb_PrintTimerSet(struct pb_TimerSet *timers) {
 
   float walltime = (wall_end - timers->wall_begin) / 1e6;
   printf("Timer Wall Time: %f\n", walltime);
+
+  // emit the same breakdown as a result record
+  bench_result_t r;
+  double wall = walltime;
+  bench_result_init(&r, BENCH_KERNEL, "Parboil timers", 0);
+  r.times = &wall;
+  r.n_times = 1;
+  for (i = 1; i < pb_TimerID_LAST - 1; ++i) {
+    if (pb_GetElapsedTime(&t[i]) != 0)
+      bench_result_add_num(&r, categories[i - 1], pb_GetElapsedTime(&t[i]));
+  }
+  if (pb_GetElapsedTime(&t[pb_TimerID_OVERLAP]) != 0)
+    bench_result_add_num(&r, "Overlap",
+                         pb_GetElapsedTime(&t[pb_TimerID_OVERLAP]));
+  bench_result_emit(&r);
 }
 
 void pb_DestroyTimerSet(struct pb_TimerSet *timers) {
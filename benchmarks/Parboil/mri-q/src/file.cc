@@ -12,11 +12,10 @@
 
 #ifndef __APPLE__
 #include <endian.h>
-#include <malloc.h>
-#else
-void *memalign(int alignment, size_t size) { return malloc(size); }
 #endif
 
+#include "BenchmarksAlloc.h"
+
 #if __BYTE_ORDER != __LITTLE_ENDIAN
 #error "File I/O is not implemented for this system: wrong endianness."
 #endif
@@ -35,21 +34,21 @@ extern "C" void inputData(char *fName, int *_numK, int *_numX, float **kx,
   *_numK = numK;
   fread(&numX, sizeof(int), 1, fid);
   *_numX = numX;
-  *kx = (float *)memalign(16, numK * sizeof(float));
+  *kx = (float *)bench_malloc(numK * sizeof(float));
   fread(*kx, sizeof(float), numK, fid);
-  *ky = (float *)memalign(16, numK * sizeof(float));
+  *ky = (float *)bench_malloc(numK * sizeof(float));
   fread(*ky, sizeof(float), numK, fid);
-  *kz = (float *)memalign(16, numK * sizeof(float));
+  *kz = (float *)bench_malloc(numK * sizeof(float));
   fread(*kz, sizeof(float), numK, fid);
-  *x = (float *)memalign(16, numX * sizeof(float));
+  *x = (float *)bench_malloc(numX * sizeof(float));
   fread(*x, sizeof(float), numX, fid);
-  *y = (float *)memalign(16, numX * sizeof(float));
+  *y = (float *)bench_malloc(numX * sizeof(float));
   fread(*y, sizeof(float), numX, fid);
-  *z = (float *)memalign(16, numX * sizeof(float));
+  *z = (float *)bench_malloc(numX * sizeof(float));
   fread(*z, sizeof(float), numX, fid);
-  *phiR = (float *)memalign(16, numK * sizeof(float));
+  *phiR = (float *)bench_malloc(numK * sizeof(float));
   fread(*phiR, sizeof(float), numK, fid);
-  *phiI = (float *)memalign(16, numK * sizeof(float));
+  *phiI = (float *)bench_malloc(numK * sizeof(float));
   fread(*phiI, sizeof(float), numK, fid);
   fclose(fid);
 }
@@ -30,12 +30,6 @@
 #include <string.h>
 #include <sys/time.h>
 
-#ifndef __APPLE__
-#include <malloc.h>
-#else
-void *memalign(int alignment, size_t size) { return malloc(size); }
-#endif
-
 #include "parboil.h"
 
 #include "computeQ.cc"
@@ -130,7 +124,7 @@ double mriqGPU(int argc, char *argv[]) {
 
   ComputePhiMagCPU(numK, phiR, phiI, phiMag);
 
-  kVals = (struct kValues *)calloc(numK, sizeof(struct kValues));
+  kVals = (struct kValues *)bench_calloc(numK, sizeof(struct kValues));
   int k;
 #pragma omp parallel for
   for (k = 0; k < numK; k++) {
@@ -154,16 +148,16 @@ double mriqGPU(int argc, char *argv[]) {
 
   N = numX;
 
-  free(kx);
-  free(ky);
-  free(kz);
-  free(x);
-  free(y);
-  free(z);
-  free(phiR);
-  free(phiI);
-  free(phiMag);
-  free(kVals);
+  bench_free(kx);
+  bench_free(ky);
+  bench_free(kz);
+  bench_free(x);
+  bench_free(y);
+  bench_free(z);
+  bench_free(phiR);
+  bench_free(phiI);
+  bench_free(phiMag);
+  bench_free(kVals);
 
   return t_end_GPU - t_start_GPU;
   /*  pb_SwitchToTimer(&timers, pb_TimerID_NONE);
@@ -224,7 +218,7 @@ double mriqCPU(int argc, char *argv[]) {
 
   ComputePhiMagCPU(numK, phiR, phiI, phiMag);
 
-  kVals = (struct kValues *)calloc(numK, sizeof(struct kValues));
+  kVals = (struct kValues *)bench_calloc(numK, sizeof(struct kValues));
   int k;
 #pragma omp parallel for
   for (k = 0; k < numK; k++) {
@@ -248,16 +242,16 @@ double mriqCPU(int argc, char *argv[]) {
 
   N = numX;
 
-  free(kx);
-  free(ky);
-  free(kz);
-  free(x);
-  free(y);
-  free(z);
-  free(phiR);
-  free(phiI);
-  free(phiMag);
-  free(kVals);
+  bench_free(kx);
+  bench_free(ky);
+  bench_free(kz);
+  bench_free(x);
+  bench_free(y);
+  bench_free(z);
+  bench_free(phiR);
+  bench_free(phiI);
+  bench_free(phiMag);
+  bench_free(kVals);
 
   return t_end - t_start;
   /*  pb_SwitchToTimer(&timers, pb_TimerID_NONE);
@@ -271,18 +265,20 @@ int main(int argc, char *argv[]) {
 
   t_GPU = mriqGPU(argc, argv);
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_GPU);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, 0, t_GPU);
 
 #ifdef RUN_TEST
   t_CPU = mriqCPU(argc, argv);
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_CPU);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", 0, t_CPU);
 
   fail = compareResults(Qr_CPU, Qr_GPU, Qi_CPU, Qi_GPU);
 #endif
 
-  free(Qr_GPU);
-  free(Qi_GPU);
-  free(Qr_CPU);
-  free(Qi_CPU);
+  bench_free(Qr_GPU);
+  bench_free(Qi_GPU);
+  bench_free(Qr_CPU);
+  bench_free(Qi_CPU);
 
   return fail;
 }
@@ -18,12 +18,6 @@
 #include <sys/time.h>
 #include <vector>
 
-#ifndef __APPLE__
-#include <malloc.h>
-#else
-void *memalign(int alignment, size_t size) { return malloc(size); }
-#endif
-
 #include "parboil.h"
 #include "BenchmarksUtil.h"
 #include "sgemm_kernel.cc"
@@ -95,7 +89,7 @@ double sgemmGPU(int argc, char *argv[]) {
 
   // allocate space for C
   //  std::vector<float> matC(matArow*matBcol);
-  matC_GPU = (float *)calloc(matArow * matBcol, sizeof(float));
+  matC_GPU = (float *)bench_calloc(matArow * matBcol, sizeof(float));
 
   t_start_GPU = rtclock();
   // Use standard sgemm interface
@@ -156,7 +150,7 @@ double sgemmCPU(int argc, char *argv[]) {
 
   // allocate space for C
   //  std::vector<float> matC(matArow*matBcol);
-  matC_CPU = (float *)calloc(matArow * matBcol, sizeof(float));
+  matC_CPU = (float *)bench_calloc(matArow * matBcol, sizeof(float));
 
   t_start = rtclock();
   // Use standard sgemm interface
@@ -190,10 +184,12 @@ int main(int argc, char *argv[]) {
 
   t_GPU = sgemmGPU(argc, argv);
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_GPU);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, 0, t_GPU);
 
 #ifdef RUN_TEST
   t_CPU = sgemmCPU(argc, argv);
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_CPU);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", 0, t_CPU);
 
   fail = compareResults(matC_GPU, matC_CPU);
 #endif
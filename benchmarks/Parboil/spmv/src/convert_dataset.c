@@ -17,6 +17,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "BenchmarksAlloc.h"
 
 typedef struct _mat_entry {
   int row, col; /* i,j */
@@ -114,9 +115,9 @@ int coo_to_jds(char *mtx_filename, int pad_rows, int warp_size, int pack_size,
 
   if (mirrored) {
     // max possible size, might be less because diagonal values aren't doubled
-    entries = (mat_entry *)malloc(2 * nz * sizeof(mat_entry));
+    entries = (mat_entry *)bench_malloc(2 * nz * sizeof(mat_entry));
   } else {
-    entries = (mat_entry *)malloc(nz * sizeof(mat_entry));
+    entries = (mat_entry *)bench_malloc(nz * sizeof(mat_entry));
   }
 
   /* NOTE: when reading in doubles, ANSI C requires the use of the "l"  */
@@ -180,8 +181,8 @@ int coo_to_jds(char *mtx_filename, int pad_rows, int warp_size, int pack_size,
   if (rows % warp_size) {         // pad group number to warp_size here
     rows += warp_size - rows % warp_size;
   }
-  stats = (row_stats *)calloc(rows, sizeof(row_stats)); // set to 0
-  *data_row_map = (int *)calloc(rows, sizeof(int));
+  stats = (row_stats *)bench_calloc(rows, sizeof(row_stats)); // set to 0
+  *data_row_map = (int *)bench_calloc(rows, sizeof(int));
   irow = entries[0].row; // set first row
 
   // printf("First row %d\n", irow);
@@ -208,7 +209,7 @@ int coo_to_jds(char *mtx_filename, int pad_rows, int warp_size, int pack_size,
 
   *nz_count_len = rows / warp_size + rows % warp_size;
   *nz_count =
-      (int *)malloc(*nz_count_len * sizeof(int)); // only one value per group
+      (int *)bench_malloc(*nz_count_len * sizeof(int)); // only one value per group
 
   /* sort based upon row size, greatest first */
   qsort(stats, rows, sizeof(row_stats), sort_stats);
@@ -265,11 +266,11 @@ int coo_to_jds(char *mtx_filename, int pad_rows, int warp_size, int pack_size,
   if (debug_level >= 1)
     printf("Allocating data space: %d entries (%f%% padding)\n", total_size,
            (float)100 * total_padding / total_size);
-  *data = (float *)calloc(total_size,
+  *data = (float *)bench_calloc(total_size,
                           sizeof(float)); // set to 0 so padded values are set
   *data_col_index =
-      (int *)calloc(total_size, sizeof(int)); // any unset indexes point to 0
-  *data_row_ptr = (int *)calloc(rows, sizeof(int));
+      (int *)bench_calloc(total_size, sizeof(int)); // any unset indexes point to 0
+  *data_row_ptr = (int *)bench_calloc(rows, sizeof(int));
   *len = total_size;
   i = 0; // data index, including padding
 
@@ -342,8 +343,8 @@ int coo_to_jds(char *mtx_filename, int pad_rows, int warp_size, int pack_size,
   if (debug_level >= 1)
     printf("Finished converting.\nJDS format has %d columns, %d rows.\n", rows,
            irow);
-  free(entries);
-  free(stats);
+  bench_free(entries);
+  bench_free(stats);
   //    printf("nz_count_len = %d\n", *nz_count_len);
 
   *data_cols = rows;
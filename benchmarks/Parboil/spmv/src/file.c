@@ -12,11 +12,10 @@
 
 #ifndef __APPLE__
 #include <endian.h>
-#include <malloc.h>
-#else
-void *memalign(int alignment, size_t size) { return malloc(size); }
 #endif
 
+#include "BenchmarksAlloc.h"
+
 #if __BYTE_ORDER != __LITTLE_ENDIAN
 #error "File I/O is not implemented for this system: wrong endianness."
 #endif
@@ -38,19 +37,19 @@ void inputData(char *fName, int *len, int *depth, int *dim, int *nzcnt_len,
   int _pad = pad[0];
   int _nzcnt_len = nzcnt_len[0];
 
-  *h_data = (float *)malloc(_len * sizeof(float));
+  *h_data = (float *)bench_malloc(_len * sizeof(float));
   fread(*h_data, sizeof(float), _len, fid);
 
-  *h_indices = (int *)malloc(_len * sizeof(int));
+  *h_indices = (int *)bench_malloc(_len * sizeof(int));
   fread(*h_indices, sizeof(int), _len, fid);
 
-  *h_ptr = (int *)malloc(_depth * sizeof(int));
+  *h_ptr = (int *)bench_malloc(_depth * sizeof(int));
   fread(*h_ptr, sizeof(int), _depth, fid);
 
-  *h_perm = (int *)malloc(_dim * sizeof(int));
+  *h_perm = (int *)bench_malloc(_dim * sizeof(int));
   fread(*h_perm, sizeof(int), _dim, fid);
 
-  *h_nzcnt = (int *)malloc(_nzcnt_len * sizeof(int));
+  *h_nzcnt = (int *)bench_malloc(_nzcnt_len * sizeof(int));
   fread(*h_nzcnt, sizeof(int), _nzcnt_len, fid);
 
   fclose(fid);
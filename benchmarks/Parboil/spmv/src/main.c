@@ -128,8 +128,8 @@ double spmvGPU(int argc, char **argv) {
              &h_data, &h_ptr, &h_nzcnt, &h_indices, &h_perm, &col_count, &dim,
              &len, &nzcnt_len, &depth);
 
-  h_Ax_vector = (float *)malloc(sizeof(float) * dim);
-  h_x_vector = (float *)malloc(sizeof(float) * dim);
+  h_Ax_vector = (float *)bench_malloc(sizeof(float) * dim);
+  h_x_vector = (float *)bench_malloc(sizeof(float) * dim);
   //  generate_vector(h_x_vector, dim);
   input_vec(parameters->inpFiles[1], h_x_vector, dim);
 
@@ -173,12 +173,12 @@ double spmvGPU(int argc, char **argv) {
   //	}
   //	pb_SwitchToTimer(&timers, pb_TimerID_COMPUTE);
 
-  free(h_data);
-  free(h_indices);
-  free(h_ptr);
-  free(h_perm);
-  free(h_nzcnt);
-  free(h_x_vector);
+  bench_free(h_data);
+  bench_free(h_indices);
+  bench_free(h_ptr);
+  bench_free(h_perm);
+  bench_free(h_nzcnt);
+  bench_free(h_x_vector);
   //	pb_SwitchToTimer(&timers, pb_TimerID_NONE);
 
   //	pb_PrintTimerSet(&timers);
@@ -238,8 +238,8 @@ double spmvCPU(int argc, char **argv) {
              &h_data, &h_ptr, &h_nzcnt, &h_indices, &h_perm, &col_count, &dim,
              &len, &nzcnt_len, &depth);
 
-  h_Ax_vector = (float *)malloc(sizeof(float) * dim);
-  h_x_vector = (float *)malloc(sizeof(float) * dim);
+  h_Ax_vector = (float *)bench_malloc(sizeof(float) * dim);
+  h_x_vector = (float *)bench_malloc(sizeof(float) * dim);
   //  generate_vector(h_x_vector, dim);
   input_vec(parameters->inpFiles[1], h_x_vector, dim);
 
@@ -279,12 +279,12 @@ double spmvCPU(int argc, char **argv) {
   //	}
   //	pb_SwitchToTimer(&timers, pb_TimerID_COMPUTE);
 
-  free(h_data);
-  free(h_indices);
-  free(h_ptr);
-  free(h_perm);
-  free(h_nzcnt);
-  free(h_x_vector);
+  bench_free(h_data);
+  bench_free(h_indices);
+  bench_free(h_ptr);
+  bench_free(h_perm);
+  bench_free(h_nzcnt);
+  bench_free(h_x_vector);
   //	pb_SwitchToTimer(&timers, pb_TimerID_NONE);
 
   //	pb_PrintTimerSet(&timers);
@@ -298,16 +298,18 @@ int main(int argc, char **argv) {
 
   t_GPU = spmvGPU(argc, argv);
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_GPU);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, 0, t_GPU);
 
 #ifdef RUN_TEST
   t_CPU = spmvCPU(argc, argv);
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_CPU);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", 0, t_CPU);
 
   fail = compareResults(h_Ax_vector_GPU, h_Ax_vector_CPU);
 #endif
 
-  free(h_Ax_vector_GPU);
-  free(h_Ax_vector_CPU);
+  bench_free(h_Ax_vector_GPU);
+  bench_free(h_Ax_vector_CPU);
 
   return fail;
 }
@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "mmio.h"
+#include "BenchmarksAlloc.h"
 
 int mm_read_unsymmetric_sparse(const char *fname, int *M_, int *N_, int *nz_,
                                double **val_, int **I_, int **J_) {
@@ -52,9 +53,9 @@ int mm_read_unsymmetric_sparse(const char *fname, int *M_, int *N_, int *nz_,
 
   /* reseve memory for matrices */
 
-  I = (int *)malloc(nz * sizeof(int));
-  J = (int *)malloc(nz * sizeof(int));
-  val = (double *)malloc(nz * sizeof(double));
+  I = (int *)bench_malloc(nz * sizeof(int));
+  J = (int *)bench_malloc(nz * sizeof(int));
+  val = (double *)bench_malloc(nz * sizeof(double));
 
   *val_ = val;
   *I_ = I;
@@ -308,17 +309,17 @@ int mm_read_mtx_crd(char *fname, int *M, int *N, int *nz, int **I, int **J,
   if ((ret_code = mm_read_mtx_crd_size(f, M, N, nz)) != 0)
     return ret_code;
 
-  *I = (int *)malloc(*nz * sizeof(int));
-  *J = (int *)malloc(*nz * sizeof(int));
+  *I = (int *)bench_malloc(*nz * sizeof(int));
+  *J = (int *)bench_malloc(*nz * sizeof(int));
   *val = NULL;
 
   if (mm_is_complex(*matcode)) {
-    *val = (double *)malloc(*nz * 2 * sizeof(double));
+    *val = (double *)bench_malloc(*nz * 2 * sizeof(double));
     ret_code = mm_read_mtx_crd_data(f, *M, *N, *nz, *I, *J, *val, *matcode);
     if (ret_code != 0)
       return ret_code;
   } else if (mm_is_real(*matcode)) {
-    *val = (double *)malloc(*nz * sizeof(double));
+    *val = (double *)bench_malloc(*nz * sizeof(double));
     ret_code = mm_read_mtx_crd_data(f, *M, *N, *nz, *I, *J, *val, *matcode);
     if (ret_code != 0)
       return ret_code;
@@ -340,7 +341,7 @@ int mm_write_banner(FILE *f, MM_typecode matcode) {
   int ret_code;
 
   ret_code = fprintf(f, "%s %s\n", MatrixMarketBanner, str);
-  free(str);
+  bench_free(str);
   if (ret_code != 2)
     return MM_COULD_NOT_WRITE_FILE;
   else
@@ -394,7 +395,7 @@ int mm_write_mtx_crd(char fname[], int M, int N, int nz, int I[], int J[],
 */
 char *mm_strdup(const char *s) {
   int len = strlen(s);
-  char *s2 = (char *)malloc((len + 1) * sizeof(char));
+  char *s2 = (char *)bench_malloc((len + 1) * sizeof(char));
   return strcpy(s2, s);
 }
 
@@ -12,11 +12,10 @@
 
 #ifndef __APPLE__
 #include <endian.h>
-#include <malloc.h>
-#else
-void *memalign(int alignment, size_t size) { return malloc(size); }
 #endif
 
+#include "BenchmarksAlloc.h"
+
 #if __BYTE_ORDER != __LITTLE_ENDIAN
 #error "File I/O is not implemented for this system: wrong endianness."
 #endif
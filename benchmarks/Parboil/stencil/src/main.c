@@ -111,13 +111,18 @@ double stencilGPU(int argc, char **argv) {
 
   size = nx * ny * nz;
 
-  h_A0 = (float *)malloc(sizeof(float) * size);
-  h_Anext = (float *)malloc(sizeof(float) * size);
+  h_A0 = (float *)bench_malloc(sizeof(float) * size);
+  h_Anext = (float *)bench_malloc(sizeof(float) * size);
   FILE *fp = fopen(parameters->inpFiles[0], "rb");
   read_data(h_A0, nx, ny, nz, fp);
   fclose(fp);
   memcpy(h_Anext, h_A0, sizeof(float) * size);
 
+  // 7-point stencil: 6 additions and 2 multiplications per interior point,
+  // every sweep reads A0 and writes Anext once
+  bench_work(8.0 * iteration * (nx - 2) * (ny - 2) * (nz - 2),
+             2.0 * iteration * size * sizeof(float));
+
   int t;
   t_start_GPU = rtclock();
   for (t = 0; t < iteration; t++) {
@@ -140,7 +145,7 @@ double stencilGPU(int argc, char **argv) {
           }*/
   //	pb_SwitchToTimer(&timers, pb_TimerID_COMPUTE);
 
-  free(h_A0);
+  bench_free(h_A0);
   //	free (h_Anext);
   //	pb_SwitchToTimer(&timers, pb_TimerID_NONE);
 
@@ -197,13 +202,16 @@ double stencilCPU(int argc, char **argv) {
 
   size = nx * ny * nz;
 
-  h_A0 = (float *)malloc(sizeof(float) * size);
-  h_Anext = (float *)malloc(sizeof(float) * size);
+  h_A0 = (float *)bench_malloc(sizeof(float) * size);
+  h_Anext = (float *)bench_malloc(sizeof(float) * size);
   FILE *fp = fopen(parameters->inpFiles[0], "rb");
   read_data(h_A0, nx, ny, nz, fp);
   fclose(fp);
   memcpy(h_Anext, h_A0, sizeof(float) * size);
 
+  bench_work(8.0 * iteration * (nx - 2) * (ny - 2) * (nz - 2),
+             2.0 * iteration * size * sizeof(float));
+
   int t;
   t_start = rtclock();
   for (t = 0; t < iteration; t++) {
@@ -227,7 +235,7 @@ double stencilCPU(int argc, char **argv) {
           }*/
   //	pb_SwitchToTimer(&timers, pb_TimerID_COMPUTE);
 
-  free(h_A0);
+  bench_free(h_A0);
   //	free (h_Anext);
   //	pb_SwitchToTimer(&timers, pb_TimerID_NONE);
 
@@ -244,17 +252,19 @@ int main(int argc, char **argv) {
 
   t_GPU = stencilGPU(argc, argv);
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_GPU);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, NX, t_GPU);
 
 #ifdef RUN_TEST
   t_CPU = stencilCPU(argc, argv);
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_CPU);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", NX, t_CPU);
 
   fail = compareResults(h_Anext_GPU, h_Anext_CPU);
 #endif
 
   pb_FreeParameters(parameters);
-  free(h_Anext_GPU);
-  free(h_Anext_CPU);
+  bench_free(h_Anext_GPU);
+  bench_free(h_Anext_CPU);
 
   return fail;
 }
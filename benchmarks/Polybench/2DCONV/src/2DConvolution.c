@@ -22,12 +22,38 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define NI SIZE
-#define NJ SIZE
+#define NI BENCH_DIM(NI)
+#define NJ BENCH_DIM(NJ)
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#if defined(BLOCKED) && defined(RUN_OMP_GPU)
+#error "The BLOCKED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Output rows computed together by the BLOCKED variant */
+#ifndef CONV_ROWS
+#define CONV_ROWS 4
+#endif
+
+/** Columns of a tile of the BLOCKED variant, whose input rows stay in L2 */
+#ifndef CONV_TILE_J
+#define CONV_TILE_J 4096
+#endif
+
+/** Rows of a tile of the BLOCKED variant */
+#ifndef CONV_TILE_I
+#define CONV_TILE_I 16
+#endif
+
+#define CONV_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (17.0 * (NI - 2) * (NJ - 2))
+#define KERNEL_BYTES (2.0 * NI * NJ * sizeof(DATA_TYPE))
 
 void conv2D(DATA_TYPE *A, DATA_TYPE *B) {
   DATA_TYPE c11, c12, c13, c21, c22, c23, c31, c32, c33;
@@ -69,6 +95,11 @@ void conv2D_OMP(DATA_TYPE *A, DATA_TYPE *B) {
   c23 = +0.7;
   c33 = +0.10;
 
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NI*NJ]) map(alloc: B[:NI*NJ]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, NI * NJ * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target teams distribute parallel for map(to : A[ : NI *NJ]) map(from : B[ : NI *NJ]) device(OMP_DEVICE_ID)
   for (int i = 1; i < NI - 1; ++i) {
     LLVM_MCA_BEGIN("loop_j");
@@ -82,7 +113,145 @@ void conv2D_OMP(DATA_TYPE *A, DATA_TYPE *B) {
     }
     LLVM_MCA_END("loop_j");
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: B[:NI*NJ]) map(release: A[:NI*NJ]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, NI * NJ * sizeof(DATA_TYPE));
+}
+
+#ifdef BLOCKED
+/**
+ * @brief Rows i0 .. i0 + rows - 1 of B, over the columns [j0, j1)
+ *
+ * The columns are vectorized, and the rows + 2 input rows are loaded once per
+ * vector for all the output rows, where the OMP version loads three rows for
+ * each of them. c[x][y] is the coefficient cxy of the stencil. The compiler
+ * unrolls the row loops for a constant rows.
+ */
+static inline void conv2D_rows(const DATA_TYPE *restrict A,
+                               DATA_TYPE *restrict B, const DATA_TYPE c[3][3],
+                               int i0, int rows, int j0, int j1) {
+  #pragma omp simd
+  for (int j = j0; j < j1; j++) {
+    DATA_TYPE w[CONV_ROWS + 2][3];
+    for (int r = 0; r < rows + 2; r++) {
+      const DATA_TYPE *a = &A[(i0 - 1 + r) * NJ + j - 1];
+      w[r][0] = a[0];
+      w[r][1] = a[1];
+      w[r][2] = a[2];
+    }
+    for (int r = 0; r < rows; r++) {
+      B[(i0 + r) * NJ + j] =
+          c[0][0] * w[r][0] + c[0][1] * w[r + 1][0] + c[0][2] * w[r + 2][0] +
+          c[1][0] * w[r][1] + c[1][1] * w[r + 1][1] + c[1][2] * w[r + 2][1] +
+          c[2][0] * w[r][2] + c[2][1] * w[r + 1][2] + c[2][2] * w[r + 2][2];
+    }
+  }
+}
+
+/**
+ * @brief Register-blocked and tiled 2D convolution
+ *
+ * The threads share out tiles of CONV_TILE_I x CONV_TILE_J outputs. A tile is
+ * swept by blocks of CONV_ROWS rows, so the two input rows that consecutive
+ * blocks have in common are still in L1 when the next block reads them.
+ */
+void conv2D_blocked(DATA_TYPE *A, DATA_TYPE *B) {
+  const DATA_TYPE c[3][3] = {
+      {+0.2, -0.3, +0.4}, {+0.5, +0.6, +0.7}, {-0.8, -0.9, +0.10}};
+
+  #pragma omp parallel for collapse(2) schedule(static)
+  for (int ii = 1; ii < NI - 1; ii += CONV_TILE_I) {
+    for (int jj = 1; jj < NJ - 1; jj += CONV_TILE_J) {
+      int i1 = CONV_MIN(ii + CONV_TILE_I, NI - 1);
+      int j1 = CONV_MIN(jj + CONV_TILE_J, NJ - 1);
+      int i0 = ii;
+
+      for (; i0 + CONV_ROWS <= i1; i0 += CONV_ROWS) {
+        conv2D_rows(A, B, c, i0, CONV_ROWS, jj, j1);
+      }
+      for (; i0 < i1; i0++) {
+        conv2D_rows(A, B, c, i0, 1, jj, j1);
+      }
+    }
+  }
+}
+#endif
+
+#ifdef PIPELINED
+/**
+ * @brief conv2D_OMP over chunks of rows, pipelined with target tasks: the copy
+ * of the next chunk of A to the device and the copy of the previous chunk of
+ * B back to the host overlap the kernel of a chunk
+ *
+ * Chunk c of B reads the first row of chunk c + 1 of A, so the copy of that
+ * chunk is issued before the kernel. The kernels run in order, since each
+ * one waits for the previous to read its chunk. dep[chunks] stands for the
+ * chunk past the last one.
+ */
+void conv2D_pipelined(DATA_TYPE *A, DATA_TYPE *B) {
+  DATA_TYPE c11, c12, c13, c21, c22, c23, c31, c32, c33;
+
+  c11 = +0.2;
+  c21 = +0.5;
+  c31 = -0.8;
+  c12 = -0.3;
+  c22 = +0.6;
+  c32 = -0.9;
+  c13 = +0.4;
+  c23 = +0.7;
+  c33 = +0.10;
+
+  int chunks = bench_pipe_chunks(NI);
+  char *dep = (char *)malloc(chunks + 1);
+
+  bench_phase_start();
+  #pragma omp target enter data map(alloc: A[:NI*NJ], B[:NI*NJ]) device(OMP_DEVICE_ID)
+
+  #pragma omp parallel num_threads(2)
+  #pragma omp single
+  {
+    #pragma omp target update to(A[0:bench_chunk_lo(1, chunks, NI)*NJ]) device(OMP_DEVICE_ID) nowait depend(out: dep[0])
+
+    for (int c = 0; c < chunks; c++) {
+      int lo = bench_chunk_lo(c, chunks, NI);
+      int hi = bench_chunk_lo(c + 1, chunks, NI);
+
+      if (c + 1 < chunks) {
+        int next = bench_chunk_lo(c + 2, chunks, NI);
+        #pragma omp target update to(A[hi*NJ:(next-hi)*NJ]) device(OMP_DEVICE_ID) nowait depend(out: dep[c + 1])
+      }
+
+      int i0 = lo > 1 ? lo : 1;
+      int i1 = hi < NI - 1 ? hi : NI - 1;
+      #pragma omp target teams distribute parallel for map(to : A[ : NI *NJ]) map(from : B[ : NI *NJ]) device(OMP_DEVICE_ID) nowait depend(in: dep[c + 1]) depend(inout: dep[c])
+      for (int i = i0; i < i1; ++i) {
+        for (int j = 1; j < NJ - 1; ++j) {
+          B[i * NJ + j] = c11 * A[(i - 1) * NJ + (j - 1)] +
+                          c12 * A[(i + 0) * NJ + (j - 1)] +
+                          c13 * A[(i + 1) * NJ + (j - 1)] +
+                          c21 * A[(i - 1) * NJ + (j + 0)] +
+                          c22 * A[(i + 0) * NJ + (j + 0)] +
+                          c23 * A[(i + 1) * NJ + (j + 0)] +
+                          c31 * A[(i - 1) * NJ + (j + 1)] +
+                          c32 * A[(i + 0) * NJ + (j + 1)] +
+                          c33 * A[(i + 1) * NJ + (j + 1)];
+        }
+      }
+
+      #pragma omp target update from(B[lo*NJ:(hi-lo)*NJ]) device(OMP_DEVICE_ID) nowait depend(in: dep[c])
+    }
+    #pragma omp taskwait
+  }
+
+  #pragma omp target exit data map(release: A[:NI*NJ], B[:NI*NJ]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+  bench_phase_bytes(BENCH_PHASE_H2D, NI * NJ * sizeof(DATA_TYPE));
+  bench_phase_bytes(BENCH_PHASE_D2H, NI * NJ * sizeof(DATA_TYPE));
+  free(dep);
 }
+#endif
 
 void init(DATA_TYPE *A) {
   int i, j;
@@ -112,9 +281,10 @@ int compareResults(DATA_TYPE *B, DATA_TYPE *B_OMP) {
 
 int main(int argc, char *argv[]) {
   SALUTE("Two dimensional (2D) convolution");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NI * NJ * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NI * NJ * sizeof(DATA_TYPE));
   DATA_TYPE *B = NULL;
   DATA_TYPE *B_OMP = NULL;
 
@@ -123,15 +293,21 @@ int main(int argc, char *argv[]) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  B_OMP = (DATA_TYPE *)malloc(NI * NJ * sizeof(DATA_TYPE));
+  B_OMP = (DATA_TYPE *)bench_malloc(NI * NJ * sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP(conv2D_blocked(A, B_OMP));
+#elif defined(PIPELINED)
+  BENCHMARK_OMP(conv2D_pipelined(A, B_OMP));
+#else
   BENCHMARK_OMP(conv2D_OMP(A, B_OMP));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(B_OMP, NI*NJ);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  B = (DATA_TYPE *)malloc(NI * NJ * sizeof(DATA_TYPE));
+  B = (DATA_TYPE *)bench_malloc(NI * NJ * sizeof(DATA_TYPE));
   BENCHMARK_CPU(conv2D(A, B));
   // prevent dead code elimination
   DCE_PREVENT(B, NI*NJ);
@@ -144,9 +320,9 @@ int main(int argc, char *argv[]) {
   printf("Errors on OMP (threshold %4.2lf): %d\n", ERROR_THRESHOLD, fail);
 #endif
 
-  free(A);
-  free(B);
-  free(B_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(B_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -19,19 +19,27 @@
 #include <omp.h>
 #endif
 
+// define the error threshold for the results "not matching"
+#define KERNEL_ERROR_THRESHOLD 1.5
+
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
+
+#define NI BENCH_DIM(NI)
+#define NJ BENCH_DIM(NJ)
+#define NK BENCH_DIM(NK)
+#define NL BENCH_DIM(NL)
 
-#define NI SIZE
-#define NJ SIZE
-#define NK SIZE
-#define NL SIZE
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
 
-#pragma GCC diagnostic ignored "-Wbuiltin-macro-redefined"
-#pragma clang diagnostic ignored "-Wmacro-redefined"
-#define ERROR_THRESHOLD 1.5
+#include "BenchmarksGemm.h"
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (2.0 * NI * NJ * NK + 2.0 * NI * NL * NJ)
+#define KERNEL_BYTES                                                           \
+  (((double)NI * NK + NK * NJ + NI * NJ + NJ * NL + NI * NL) *                 \
+   sizeof(DATA_TYPE))
 
 /**
  * @brief Initialize operand matrices
@@ -45,19 +53,21 @@ void init_array(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *D) {
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NK; j++) {
-      A[i * NI + j] = ((DATA_TYPE)i * j) / NI;
+      A[i * NK + j] = BENCH_INPUT(((ACC_TYPE)i * j) / NI, NK);
     }
   }
 
   for (i = 0; i < NK; i++) {
     for (j = 0; j < NJ; j++) {
-      B[i * NK + j] = ((DATA_TYPE)i * (j + 1)) / NJ;
+      B[i * NJ + j] = BENCH_INPUT(((ACC_TYPE)i * (j + 1)) / NJ,
+                                  (ACC_TYPE)NK * NK);
     }
   }
 
-  for (i = 0; i < NI; i++) {
+  for (i = 0; i < NJ; i++) {
     for (j = 0; j < NL; j++) {
-      D[i * NL + j] = ((DATA_TYPE)i * (j + 2)) / NK;
+      D[i * NL + j] = BENCH_INPUT(((ACC_TYPE)i * (j + 2)) / NK,
+                                  (ACC_TYPE)NJ * (NL + 1) / NK * NJ);
     }
   }
 }
@@ -67,15 +77,18 @@ void init_array(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *D) {
  * 
  * @param E Expected result matrix 
  * @param E_OMP Obtained matrix
+ * @param rows Rows of the matrices
+ * @param cols Columns of the matrices
  * @return int Number of detected fails
  */
-int compareResults(DATA_TYPE *E, DATA_TYPE *E_OMP) {
+int compareResults(DATA_TYPE *E, DATA_TYPE *E_OMP, int rows, int cols) {
   int i, j, fail;
   fail = 0;
 
-  for (i = 0; i < NL; i++) {
-    for (j = 0; j < NI; j++) {
-      if (percentDiff(E[i * NI + j], E_OMP[i * NI + j]) > ERROR_THRESHOLD) {
+  for (i = 0; i < rows; i++) {
+    for (j = 0; j < cols; j++) {
+      if (percentDiff(E[i * cols + j], E_OMP[i * cols + j]) >
+          ERROR_THRESHOLD) {
         fail++;
       }
     }
@@ -99,44 +112,53 @@ void mm2(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NJ; j++) {
-      C[i * NJ + j] = 0.0;
+      ACC_TYPE acc = 0;
       for (k = 0; k < NK; ++k) {
-        C[i * NJ + j] += A[i * NK + k] * B[k * NJ + j];
+        acc += A[i * NK + k] * B[k * NJ + j];
       }
+      C[i * NJ + j] = acc;
     }
   }
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NL; j++) {
-      E[i * NL + j] = 0.0;
+      ACC_TYPE acc = 0;
       for (k = 0; k < NJ; ++k) {
-        E[i * NL + j] += C[i * NJ + k] * D[k * NL + j];
+        acc += C[i * NJ + k] * D[k * NL + j];
       }
+      E[i * NL + j] = acc;
     }
   }
 }
 
 /**
- * @brief OMP version to compute A.B.D matrixes
- *
- * @param A Input
- * @param B Input
- * @param C Auxiliar
- * @param D Input
- * @param E Output
+ * @brief Maps A, B and D to the device, and allocates C and E there
  */
-void mm2_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D, DATA_TYPE *E) {
+void mm2_enter(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+               DATA_TYPE *E) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NI*NK], B[:NK*NJ], D[:NJ*NL]) map(alloc: C[:NI*NJ], E[:NI*NL]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (NI * NK + NK * NJ + NJ * NL) * sizeof(DATA_TYPE));
+}
 
+/**
+ * @brief C = A.B and E = C.D on the device, where the matrices are present
+ */
+void mm2_kernel(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+                DATA_TYPE *E) {
+  bench_phase_start();
 #pragma omp target teams map(from: E[:NI*NL], C[:NI*NJ]) map(to: A[:NI*NK], B[:NK*NJ], D[:NJ*NL]) device(OMP_DEVICE_ID) 
   {
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < NI; i++) {
       for (int j = 0; j < NJ; j++) {
         LLVM_MCA_BEGIN("kernel");
-        C[i * NJ + j] = 0.0;
+        ACC_TYPE acc = 0;
         for (int k = 0; k < NK; ++k) {
-          C[i * NJ + j] += A[i * NK + k] * B[k * NJ + j];
+          acc += A[i * NK + k] * B[k * NJ + j];
         }
+        C[i * NJ + j] = acc;
         LLVM_MCA_END("kernel");
       }
     }
@@ -144,22 +166,60 @@ void mm2_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D, DATA_TYPE *
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < NI; i++) {
       for (int j = 0; j < NL; j++) {
-        E[i * NL + j] = 0.0;
+        ACC_TYPE acc = 0;
         for (int k = 0; k < NJ; ++k) {
-          E[i * NL + j] += C[i * NJ + k] * D[k * NL + j];
+          acc += C[i * NJ + k] * D[k * NL + j];
         }
+        E[i * NL + j] = acc;
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+}
+
+/**
+ * @brief Copies C and E back to the host and releases the device data
+ */
+void mm2_exit(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+              DATA_TYPE *E) {
+  bench_phase_start();
+  #pragma omp target exit data map(from: C[:NI*NJ], E[:NI*NL]) map(release: A[:NI*NK], B[:NK*NJ], D[:NJ*NL]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (NI * NJ + NI * NL) * sizeof(DATA_TYPE));
+}
+
+/**
+ * @brief OMP version to compute A.B.D matrixes
+ *
+ * @param A Input
+ * @param B Input
+ * @param C Auxiliar
+ * @param D Input
+ * @param E Output
+ */
+void mm2_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+             DATA_TYPE *E) {
+  mm2_enter(A, B, C, D, E);
+  mm2_kernel(A, B, C, D, E);
+  mm2_exit(A, B, C, D, E);
+}
+
+/**
+ * @brief Cache-blocked and register-tiled version of mm2_OMP, for the CPU
+ */
+void mm2_blocked(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+                 DATA_TYPE *E) {
+  bench_gemm(0, 0, NI, NJ, NK, 1, A, NK, B, NJ, 0, C, NJ);
+  bench_gemm(0, 0, NI, NL, NJ, 1, C, NJ, D, NL, 0, E, NL);
 }
 
 int main(int argc, char **argv) {
   SALUTE("Linear Algebra: 2 Matrix Multiplications (C=A.B; E=C.D)");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NI * NK * sizeof(DATA_TYPE));
-  DATA_TYPE *B = (DATA_TYPE *)malloc(NK * NJ * sizeof(DATA_TYPE));
-  DATA_TYPE *D = (DATA_TYPE *)malloc(NJ * NL * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NI * NK * sizeof(DATA_TYPE));
+  DATA_TYPE *B = (DATA_TYPE *)bench_malloc(NK * NJ * sizeof(DATA_TYPE));
+  DATA_TYPE *D = (DATA_TYPE *)bench_malloc(NJ * NL * sizeof(DATA_TYPE));
   DATA_TYPE *C = NULL;
   DATA_TYPE *C_OMP = NULL;
   DATA_TYPE *E = NULL;
@@ -170,17 +230,26 @@ int main(int argc, char **argv) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  C_OMP = (DATA_TYPE *)calloc(NI * NJ, sizeof(DATA_TYPE));
-  E_OMP = (DATA_TYPE *)calloc(NI * NL, sizeof(DATA_TYPE));
+  C_OMP = (DATA_TYPE *)bench_calloc(NI * NJ, sizeof(DATA_TYPE));
+  E_OMP = (DATA_TYPE *)bench_calloc(NI * NL, sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP(mm2_blocked(A, B, C_OMP, D, E_OMP));
+#elif defined(RESIDENT)
+  // the products overwrite their outputs, which need no reset
+  BENCHMARK_OMP_RESIDENT(mm2_enter(A, B, C_OMP, D, E_OMP), ,
+                         mm2_kernel(A, B, C_OMP, D, E_OMP),
+                         mm2_exit(A, B, C_OMP, D, E_OMP));
+#else
   BENCHMARK_OMP(mm2_OMP(A, B, C_OMP, D, E_OMP));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(E_OMP, NI*NL);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  C = (DATA_TYPE *)calloc(NI * NJ, sizeof(DATA_TYPE));
-  E = (DATA_TYPE *)calloc(NI * NL, sizeof(DATA_TYPE));
+  C = (DATA_TYPE *)bench_calloc(NI * NJ, sizeof(DATA_TYPE));
+  E = (DATA_TYPE *)bench_calloc(NI * NL, sizeof(DATA_TYPE));
   BENCHMARK_CPU(mm2(A, B, C, D, E));
   // prevent dead code elimination
   DCE_PREVENT(E, NI*NL);
@@ -189,19 +258,19 @@ int main(int argc, char **argv) {
   // if TEST is enabled, then compare OMP results against sequential mode
   int fail = 0;
 #ifdef RUN_TEST
-  fail += compareResults(C, C_OMP);
-  fail += compareResults(E, E_OMP);
+  fail += compareResults(C, C_OMP, NI, NJ);
+  fail += compareResults(E, E_OMP, NI, NL);
   printf("Errors on OMP (threshold %4.2lf): %d\n", ERROR_THRESHOLD, fail);
 #endif
 
   /** Release memory */
-  free(A);
-  free(B);
-  free(D);
-  free(C_OMP);
-  free(E_OMP);
-  free(C);
-  free(E);
+  bench_free(A);
+  bench_free(B);
+  bench_free(D);
+  bench_free(C_OMP);
+  bench_free(E_OMP);
+  bench_free(C);
+  bench_free(E);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
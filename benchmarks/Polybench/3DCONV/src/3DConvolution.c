@@ -21,13 +21,39 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define NI SIZE
-#define NJ SIZE
-#define NK SIZE
+#define NI BENCH_DIM(NI)
+#define NJ BENCH_DIM(NJ)
+#define NK BENCH_DIM(NK)
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#if defined(BLOCKED) && defined(RUN_OMP_GPU)
+#error "The BLOCKED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Output rows computed together by the BLOCKED variant */
+#ifndef CONV_ROWS
+#define CONV_ROWS 2
+#endif
+
+/** Rows of a tile of the BLOCKED variant */
+#ifndef CONV_TILE_J
+#define CONV_TILE_J 16
+#endif
+
+/** Columns of a tile of the BLOCKED variant */
+#ifndef CONV_TILE_K
+#define CONV_TILE_K 512
+#endif
+
+#define CONV_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (29.0 * (NI - 2) * (NJ - 2) * (NK - 2))
+#define KERNEL_BYTES (2.0 * NI * NJ * NK * sizeof(DATA_TYPE))
 
 void conv3D(DATA_TYPE *A, DATA_TYPE *B) {
   int i, j, k;
@@ -84,6 +110,11 @@ void conv3D_OMP(DATA_TYPE *A, DATA_TYPE *B) {
   unsigned long int size = NI;
   size *= NJ;
   size *= NK;
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:size]) map(alloc: B[:size]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, size * sizeof(DATA_TYPE));
+
+  bench_phase_start();
 #pragma omp target teams distribute parallel for \
   map(to: A[:size])       \
   map(from: B[:size]) \
@@ -113,7 +144,83 @@ void conv3D_OMP(DATA_TYPE *A, DATA_TYPE *B) {
     }
     LLVM_MCA_END("kernel");
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: B[:size]) map(release: A[:size]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, size * sizeof(DATA_TYPE));
+}
+
+#ifdef BLOCKED
+/**
+ * @brief Rows j0 .. j0 + rows - 1 of the plane i of B, over the columns
+ * [k0, k1)
+ *
+ * The columns are vectorized, and the values each output row shares with its
+ * neighbours are loaded once per vector for all the rows. c[x][y] is the
+ * coefficient cxy of the stencil. The compiler unrolls the row loops for a
+ * constant rows.
+ */
+static inline void conv3D_rows(const DATA_TYPE *restrict A,
+                               DATA_TYPE *restrict B, const DATA_TYPE c[3][3],
+                               int i, int j0, int rows, int k0, int k1) {
+  const DATA_TYPE *P = &A[(i - 1) * (NK * NJ) + (j0 - 1) * NK];
+  const DATA_TYPE *C = &A[(i + 0) * (NK * NJ) + (j0 - 1) * NK];
+  const DATA_TYPE *Q = &A[(i + 1) * (NK * NJ) + (j0 - 1) * NK];
+
+  #pragma omp simd
+  for (int k = k0; k < k1; k++) {
+    DATA_TYPE pl[CONV_ROWS + 2], pr[CONV_ROWS + 2], ql[CONV_ROWS + 2],
+        qr[CONV_ROWS + 2], cm[CONV_ROWS + 2];
+    for (int r = 0; r < rows + 2; r++) {
+      pl[r] = P[r * NK + k - 1];
+      pr[r] = P[r * NK + k + 1];
+      ql[r] = Q[r * NK + k - 1];
+      qr[r] = Q[r * NK + k + 1];
+      cm[r] = C[r * NK + k];
+    }
+    for (int r = 0; r < rows; r++) {
+      B[i * (NK * NJ) + (j0 + r) * NK + k] =
+          c[0][0] * pl[r] + c[0][2] * ql[r] + c[1][0] * pl[r] +
+          c[1][2] * ql[r] + c[2][0] * pl[r] + c[2][2] * ql[r] +
+          c[0][1] * cm[r] + c[1][1] * cm[r + 1] + c[2][1] * cm[r + 2] +
+          c[0][0] * pr[r] + c[0][2] * qr[r] + c[1][0] * pr[r + 1] +
+          c[1][2] * qr[r + 1] + c[2][0] * pr[r + 2] + c[2][2] * qr[r + 2];
+    }
+  }
+}
+
+/**
+ * @brief Register-blocked and tiled 3D convolution
+ *
+ * The threads share out columns of CONV_TILE_J x CONV_TILE_K outputs and sweep
+ * them plane by plane, so the tile of a plane, with its halo, is read from
+ * memory once and reused from cache as the lower, middle and upper plane of
+ * three consecutive outputs. The OMP version walks the planes in its inner
+ * loop and reloads all three for every row.
+ */
+void conv3D_blocked(DATA_TYPE *A, DATA_TYPE *B) {
+  const DATA_TYPE c[3][3] = {{+2, -3, +4}, {+5, +6, +7}, {-8, -9, +10}};
+
+  #pragma omp parallel for collapse(2) schedule(static)
+  for (int jj = 1; jj < NJ - 1; jj += CONV_TILE_J) {
+    for (int kk = 1; kk < NK - 1; kk += CONV_TILE_K) {
+      int j1 = CONV_MIN(jj + CONV_TILE_J, NJ - 1);
+      int k1 = CONV_MIN(kk + CONV_TILE_K, NK - 1);
+
+      for (int i = 1; i < NI - 1; i++) {
+        int j0 = jj;
+        for (; j0 + CONV_ROWS <= j1; j0 += CONV_ROWS) {
+          conv3D_rows(A, B, c, i, j0, CONV_ROWS, kk, k1);
+        }
+        for (; j0 < j1; j0++) {
+          conv3D_rows(A, B, c, i, j0, 1, kk, k1);
+        }
+      }
+    }
+  }
 }
+#endif
 
 void init(DATA_TYPE *A) {
   int i, j, k;
@@ -148,6 +255,7 @@ int compareResults(DATA_TYPE *B, DATA_TYPE *B_OMP) {
 
 int main(int argc, char *argv[]) {
   SALUTE("Three dimensional (3D) convolution");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // small hack to cast the macros into unsigned longs (UL) and multiply without
   // overflowing
@@ -156,7 +264,7 @@ int main(int argc, char *argv[]) {
   size *= NK;
   
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(size * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(size * sizeof(DATA_TYPE));
   DATA_TYPE *B = NULL;
   DATA_TYPE *B_OMP = NULL;
 
@@ -165,15 +273,19 @@ int main(int argc, char *argv[]) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  B_OMP = (DATA_TYPE *)malloc(size * sizeof(DATA_TYPE));
+  B_OMP = (DATA_TYPE *)bench_malloc(size * sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP(conv3D_blocked(A, B_OMP));
+#else
   BENCHMARK_OMP(conv3D_OMP(A, B_OMP));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(B_OMP, size);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  B = (DATA_TYPE *)malloc(size * sizeof(DATA_TYPE));
+  B = (DATA_TYPE *)bench_malloc(size * sizeof(DATA_TYPE));
   BENCHMARK_CPU(conv3D(A, B));
   // prevent dead code elimination
   DCE_PREVENT(B, size);
@@ -187,9 +299,9 @@ int main(int argc, char *argv[]) {
 #endif
 
   // Release memory
-  free(A);
-  free(B);
-  free(B_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(B_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -19,45 +19,58 @@
 #include <omp.h>
 #endif
 
+// define the error threshold for the results "not matching"
+#define KERNEL_ERROR_THRESHOLD 1.5
+
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
+
+#define NI BENCH_DIM(NI)
+#define NJ BENCH_DIM(NJ)
+#define NK BENCH_DIM(NK)
+#define NL BENCH_DIM(NL)
+#define NM BENCH_DIM(NM)
 
-#define NI SIZE
-#define NJ SIZE
-#define NK SIZE
-#define NL SIZE
-#define NM SIZE
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
 
-#pragma GCC diagnostic ignored "-Wbuiltin-macro-redefined"
-#pragma clang diagnostic ignored "-Wmacro-redefined"
-#define ERROR_THRESHOLD 1.5
+#include "BenchmarksGemm.h"
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS                                                           \
+  (2.0 * NI * NJ * NK + 2.0 * NJ * NL * NM + 2.0 * NI * NL * NJ)
+#define KERNEL_BYTES                                                           \
+  (((double)NI * NK + NK * NJ + NJ * NM + NM * NL + NI * NJ + NJ * NL +        \
+   NI * NL) * sizeof(DATA_TYPE))
 
 void init_array(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D) {
   int i, j;
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NK; j++) {
-      A[i * NK + j] = ((DATA_TYPE)i * j) / NI;
+      A[i * NK + j] = BENCH_INPUT(((ACC_TYPE)i * j) / NI, NK);
     }
   }
 
   for (i = 0; i < NK; i++) {
     for (j = 0; j < NJ; j++) {
-      B[i * NJ + j] = ((DATA_TYPE)i * (j + 1)) / NJ;
+      B[i * NJ + j] = BENCH_INPUT(((ACC_TYPE)i * (j + 1)) / NJ,
+                                  (ACC_TYPE)NK * NK);
     }
   }
 
   for (i = 0; i < NJ; i++) {
     for (j = 0; j < NM; j++) {
-      C[i * NM + j] = ((DATA_TYPE)i * (j + 3)) / NL;
+      // G = E.F also reduces over NJ
+      C[i * NM + j] = BENCH_INPUT(((ACC_TYPE)i * (j + 3)) / NL,
+                                  (ACC_TYPE)NJ * (NM + 2) / NL * NJ);
     }
   }
 
   for (i = 0; i < NM; i++) {
     for (j = 0; j < NL; j++) {
-      D[i * NL + j] = ((DATA_TYPE)i * (j + 2)) / NK;
+      D[i * NL + j] = BENCH_INPUT(((ACC_TYPE)i * (j + 2)) / NK,
+                                  (ACC_TYPE)NM * (NL + 1) / NK * NM);
     }
   }
 }
@@ -85,52 +98,71 @@ void mm3(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
   /* E := A*B */
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NJ; j++) {
-      E[i * NJ + j] = 0;
+      ACC_TYPE acc = 0;
       for (k = 0; k < NK; ++k) {
-        E[i * NJ + j] += A[i * NK + k] * B[k * NJ + j];
+        acc += A[i * NK + k] * B[k * NJ + j];
       }
+      E[i * NJ + j] = acc;
     }
   }
 
   /* F := C*D */
   for (i = 0; i < NJ; i++) {
     for (j = 0; j < NL; j++) {
-      F[i * NL + j] = 0;
+      ACC_TYPE acc = 0;
       for (k = 0; k < NM; ++k) {
-        F[i * NL + j] += C[i * NM + k] * D[k * NL + j];
+        acc += C[i * NM + k] * D[k * NL + j];
       }
+      F[i * NL + j] = acc;
     }
   }
 
   /* G := E*F */
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NL; j++) {
-      G[i * NL + j] = 0;
+      ACC_TYPE acc = 0;
       for (k = 0; k < NJ; ++k) {
-        G[i * NL + j] += E[i * NJ + k] * F[k * NL + j];
+        acc += E[i * NJ + k] * F[k * NL + j];
       }
+      G[i * NL + j] = acc;
     }
   }
 }
 
-void mm3_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
-             DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+/**
+ * @brief Maps A, B, C and D to the device, and allocates E, F and G there
+ */
+void mm3_enter(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+               DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NI*NK], B[:NK*NJ], C[:NJ*NM], D[:NM*NL]) map(alloc: E[:NI*NJ], F[:NJ*NL], G[:NI*NL]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (NI * NK + NK * NJ + NJ * NM + NM * NL) * sizeof(DATA_TYPE));
+}
 
-/* E := A*B */
+/**
+ * @brief E = A.B, F = C.D and G = E.F on the device, where the matrices are
+ * present
+ */
+void mm3_kernel(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+                DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+  bench_phase_start();
 #pragma omp target teams \
   map(to : A[ : NI *NK], B[ : NK *NJ], C[ : NJ *NM], D[ : NM *NL]) \
   map(from : E[ : NI *NJ], F[ : NJ *NL], G[ : NI *NL]) \
   device(OMP_DEVICE_ID) \
   thread_limit(128)
   {
+    /* E := A*B */
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < NI; i++) {
       for (int j = 0; j < NJ; j++) {
         LLVM_MCA_BEGIN("kernel");
-        E[i * NJ + j] = 0;
+        ACC_TYPE acc = 0;
         for (int k = 0; k < NK; ++k) {
-          E[i * NJ + j] += A[i * NK + k] * B[k * NJ + j];
+          acc += A[i * NK + k] * B[k * NJ + j];
         }
+        E[i * NJ + j] = acc;
         LLVM_MCA_END("kernel");
       }
     }
@@ -139,10 +171,11 @@ void mm3_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < NJ; i++) {
       for (int j = 0; j < NL; j++) {
-        F[i * NL + j] = 0;
+        ACC_TYPE acc = 0;
         for (int k = 0; k < NM; ++k) {
-          F[i * NL + j] += C[i * NM + k] * D[k * NL + j];
+          acc += C[i * NM + k] * D[k * NL + j];
         }
+        F[i * NL + j] = acc;
       }
     }
 
@@ -150,23 +183,57 @@ void mm3_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < NI; i++) {
       for (int j = 0; j < NL; j++) {
-        G[i * NL + j] = 0;
+        ACC_TYPE acc = 0;
         for (int k = 0; k < NJ; ++k) {
-          G[i * NL + j] += E[i * NJ + k] * F[k * NL + j];
+          acc += E[i * NJ + k] * F[k * NL + j];
         }
+        G[i * NL + j] = acc;
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+}
+
+/**
+ * @brief Copies E, F and G back to the host and releases the device data
+ */
+void mm3_exit(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+              DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+  bench_phase_start();
+  #pragma omp target exit data map(from: E[:NI*NJ], F[:NJ*NL], G[:NI*NL]) map(release: A[:NI*NK], B[:NK*NJ], C[:NJ*NM], D[:NM*NL]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H,
+                   (NI * NJ + NJ * NL + NI * NL) * sizeof(DATA_TYPE));
+}
+
+void mm3_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+             DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+  mm3_enter(A, B, C, D, E, F, G);
+  mm3_kernel(A, B, C, D, E, F, G);
+  mm3_exit(A, B, C, D, E, F, G);
+}
+
+/**
+ * @brief Cache-blocked and register-tiled version of mm3_OMP, for the CPU
+ */
+void mm3_blocked(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C, DATA_TYPE *D,
+                 DATA_TYPE *E, DATA_TYPE *F, DATA_TYPE *G) {
+  /* E := A*B */
+  bench_gemm(0, 0, NI, NJ, NK, 1, A, NK, B, NJ, 0, E, NJ);
+  /* F := C*D */
+  bench_gemm(0, 0, NJ, NL, NM, 1, C, NM, D, NL, 0, F, NL);
+  /* G := E*F */
+  bench_gemm(0, 0, NI, NL, NJ, 1, E, NJ, F, NL, 0, G, NL);
 }
 
 int main(int argc, char **argv) {
   SALUTE("Linear Algebra: 3 Matrix Multiplications (E=A.B; F=C.D; G=E.F)");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NI * NK * sizeof(DATA_TYPE));
-  DATA_TYPE *B = (DATA_TYPE *)malloc(NK * NJ * sizeof(DATA_TYPE));
-  DATA_TYPE *C = (DATA_TYPE *)malloc(NJ * NM * sizeof(DATA_TYPE));
-  DATA_TYPE *D = (DATA_TYPE *)malloc(NM * NL * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NI * NK * sizeof(DATA_TYPE));
+  DATA_TYPE *B = (DATA_TYPE *)bench_malloc(NK * NJ * sizeof(DATA_TYPE));
+  DATA_TYPE *C = (DATA_TYPE *)bench_malloc(NJ * NM * sizeof(DATA_TYPE));
+  DATA_TYPE *D = (DATA_TYPE *)bench_malloc(NM * NL * sizeof(DATA_TYPE));
   DATA_TYPE *E = NULL;
   DATA_TYPE *F = NULL;
   DATA_TYPE *G = NULL;
@@ -179,19 +246,28 @@ int main(int argc, char **argv) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  E_OMP = (DATA_TYPE *)calloc(NI * NJ, sizeof(DATA_TYPE));
-  F_OMP = (DATA_TYPE *)calloc(NJ * NL, sizeof(DATA_TYPE));
-  G_OMP = (DATA_TYPE *)calloc(NI * NL, sizeof(DATA_TYPE));
+  E_OMP = (DATA_TYPE *)bench_calloc(NI * NJ, sizeof(DATA_TYPE));
+  F_OMP = (DATA_TYPE *)bench_calloc(NJ * NL, sizeof(DATA_TYPE));
+  G_OMP = (DATA_TYPE *)bench_calloc(NI * NL, sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP(mm3_blocked(A, B, C, D, E_OMP, F_OMP, G_OMP));
+#elif defined(RESIDENT)
+  // the products overwrite their outputs, which need no reset
+  BENCHMARK_OMP_RESIDENT(mm3_enter(A, B, C, D, E_OMP, F_OMP, G_OMP), ,
+                         mm3_kernel(A, B, C, D, E_OMP, F_OMP, G_OMP),
+                         mm3_exit(A, B, C, D, E_OMP, F_OMP, G_OMP));
+#else
   BENCHMARK_OMP(mm3_OMP(A, B, C, D, E_OMP, F_OMP, G_OMP));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(G_OMP, NI*NL);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  E = (DATA_TYPE *)malloc(NI * NJ * sizeof(DATA_TYPE));
-  F = (DATA_TYPE *)malloc(NJ * NL * sizeof(DATA_TYPE));
-  G = (DATA_TYPE *)malloc(NI * NL * sizeof(DATA_TYPE));
+  E = (DATA_TYPE *)bench_malloc(NI * NJ * sizeof(DATA_TYPE));
+  F = (DATA_TYPE *)bench_malloc(NJ * NL * sizeof(DATA_TYPE));
+  G = (DATA_TYPE *)bench_malloc(NI * NL * sizeof(DATA_TYPE));
   BENCHMARK_CPU(mm3(A, B, C, D, E, F, G));
   // prevent dead code elimination
   DCE_PREVENT(G, NI*NL);
@@ -205,16 +281,16 @@ int main(int argc, char **argv) {
 #endif
 
   // Release memory
-  free(A);
-  free(B);
-  free(C);
-  free(D);
-  free(E);
-  free(E_OMP);
-  free(F);
-  free(F_OMP);
-  free(G);
-  free(G_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(C);
+  bench_free(D);
+  bench_free(E);
+  bench_free(E_OMP);
+  bench_free(F);
+  bench_free(F_OMP);
+  bench_free(G);
+  bench_free(G_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -21,24 +21,40 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define NX SIZE
-#define NY SIZE
+#define NX BENCH_DIM(NX)
+#define NY BENCH_DIM(NY)
 
 #ifndef M_PI
 #define M_PI 3.14159
 #endif
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksSimd.h"
+
+#if defined(FUSED) && defined(RUN_OMP_GPU)
+#error "The FUSED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (4.0 * NX * NY)
+#define KERNEL_BYTES (((double)NX * NY + 2 * NY + NX) * sizeof(DATA_TYPE))
 
 void init_array(DATA_TYPE *x, DATA_TYPE *A) {
   int i, j;
 
+  for (i = 0; i < NY; i++) {
+    x[i] = BENCH_INPUT(i * M_PI, M_PI * NY);
+  }
+
   for (i = 0; i < NX; i++) {
-    x[i] = i * M_PI;
     for (j = 0; j < NY; j++) {
-      A[i * NY + j] = ((DATA_TYPE)i * (j)) / NX;
+      // A.x reduces over NY and A^T.tmp over NX
+      A[i * NY + j] = BENCH_INPUT(((ACC_TYPE)i * (j)) / NX,
+                                  (ACC_TYPE)NY * (NX > NY ? NX : NY));
     }
   }
 }
@@ -64,11 +80,12 @@ void atax(DATA_TYPE *A, DATA_TYPE *x, DATA_TYPE *y, DATA_TYPE *tmp) {
   }
 
   for (i = 0; i < NX; i++) {
-    tmp[i] = 0;
+    ACC_TYPE acc = 0;
 
     for (j = 0; j < NY; j++) {
-      tmp[i] = tmp[i] + A[i * NY + j] * x[j];
+      acc = acc + A[i * NY + j] * x[j];
     }
+    tmp[i] = acc;
 
     for (j = 0; j < NY; j++) {
       y[j] = y[j] + A[i * NY + j] * tmp[i];
@@ -82,52 +99,197 @@ void atax_OMP(DATA_TYPE *A, DATA_TYPE *x, DATA_TYPE *y, DATA_TYPE *tmp) {
     y[i] = 0;
   }
 
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NX*NY], x[:NY], tmp[:NX], y[:NY]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (NX * NY + NY + NX + NY) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target teams map(to : A[ : NX *NY], x[ : NY]) map(tofrom : tmp[ : NX], y[ : NY]) device(OMP_DEVICE_ID)
   {
     #pragma omp distribute parallel for
     for (int i = 0; i < NX; i++) {
       LLVM_MCA_BEGIN("kernel");
-      tmp[i] = 0;
+      ACC_TYPE acc = 0;
       for (int j = 0; j < NY; j++) {
-        tmp[i] += A[i * NY + j] * x[j];
+        acc += A[i * NY + j] * x[j];
       }
+      tmp[i] = acc;
       LLVM_MCA_END("kernel");
     }
 
     // Note that the Loop has been reversed
     #pragma omp distribute parallel for
     for (int j = 0; j < NY; j++) {
+      ACC_TYPE acc = y[j];
+      for (int i = 0; i < NX; i++) {
+        acc += A[i * NY + j] * tmp[i];
+      }
+      y[j] = acc;
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: tmp[:NX], y[:NY]) map(release: A[:NX*NY], x[:NY]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (NX + NY) * sizeof(DATA_TYPE));
+}
+
+#ifdef FUSED
+/**
+ * @brief Single sweep over A: each row is read for tmp[i] and, while it is
+ * still in cache, added into private partial sums of y, one set per thread
+ */
+void atax_fused(DATA_TYPE *A, DATA_TYPE *x, DATA_TYPE *y, DATA_TYPE *tmp) {
+  for (int j = 0; j < NY; j++) {
+    y[j] = 0;
+  }
+
+  #pragma omp parallel
+  {
+    ACC_TYPE *y_part = (ACC_TYPE *)calloc(NY, sizeof(ACC_TYPE));
+
+    #pragma omp for nowait
+    for (int i = 0; i < NX; i++) {
+      ACC_TYPE t = 0;
+      #pragma omp simd reduction(+ : t)
+      for (int j = 0; j < NY; j++) {
+        t += A[i * NY + j] * x[j];
+      }
+      tmp[i] = t;
+
+      #pragma omp simd
+      for (int j = 0; j < NY; j++) {
+        y_part[j] += A[i * NY + j] * t;
+      }
+    }
+
+    #pragma omp critical
+    for (int j = 0; j < NY; j++) {
+      y[j] += y_part[j];
+    }
+    free(y_part);
+  }
+}
+#endif
+
+#ifdef PIPELINED
+/**
+ * @brief atax_OMP over chunks of rows of A, pipelined with target tasks: the
+ * copy of a chunk to the device overlaps the kernel of the previous one,
+ * which computes its part of tmp and adds its rows into y
+ */
+void atax_pipelined(DATA_TYPE *A, DATA_TYPE *x, DATA_TYPE *y,
+                    DATA_TYPE *tmp) {
+  int chunks = bench_pipe_chunks(NX);
+  char *dep = (char *)malloc(chunks);
+
+  for (int j = 0; j < NY; j++) {
+    y[j] = 0;
+  }
+
+  bench_phase_start();
+  #pragma omp target enter data map(to: x[:NY], y[:NY]) map(alloc: A[:NX*NY], tmp[:NX]) device(OMP_DEVICE_ID)
+
+  #pragma omp parallel num_threads(2)
+  #pragma omp single
+  {
+    for (int c = 0; c < chunks; c++) {
+      int lo = bench_chunk_lo(c, chunks, NX);
+      int hi = bench_chunk_lo(c + 1, chunks, NX);
+
+      #pragma omp target update to(A[lo*NY:(hi-lo)*NY]) device(OMP_DEVICE_ID) nowait depend(out: dep[c])
+
+      #pragma omp target teams distribute parallel for map(to : A[ : NX *NY], x[ : NY]) map(tofrom : tmp[ : NX]) device(OMP_DEVICE_ID) nowait depend(inout: dep[c])
+      for (int i = lo; i < hi; i++) {
+        ACC_TYPE acc = 0;
+        for (int j = 0; j < NY; j++) {
+          acc += A[i * NY + j] * x[j];
+        }
+        tmp[i] = acc;
+      }
+
+      // the teams of a region do not synchronize, so the rows of the chunk
+      // go into y in a region of their own, after its part of tmp. The
+      // chunks add into y one after the other
+      #pragma omp target teams distribute parallel for map(to : A[ : NX *NY], tmp[ : NX]) map(tofrom : y[ : NY]) device(OMP_DEVICE_ID) nowait depend(inout: dep[c], y[0])
+      for (int j = 0; j < NY; j++) {
+        ACC_TYPE acc = y[j];
+        for (int i = lo; i < hi; i++) {
+          acc += A[i * NY + j] * tmp[i];
+        }
+        y[j] = acc;
+      }
+
+      #pragma omp target update from(tmp[lo:hi-lo]) device(OMP_DEVICE_ID) nowait depend(in: dep[c])
+    }
+    #pragma omp taskwait
+  }
+
+  #pragma omp target exit data map(from: y[:NY]) map(release: A[:NX*NY], x[:NY], tmp[:NX]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+  bench_phase_bytes(BENCH_PHASE_H2D, (NX * NY + NY + NY) * sizeof(DATA_TYPE));
+  bench_phase_bytes(BENCH_PHASE_D2H, (NX + NY) * sizeof(DATA_TYPE));
+  free(dep);
+}
+#endif
+
+#ifdef SIMD
+void atax_simd(DATA_TYPE *A, DATA_TYPE *x, DATA_TYPE *y, DATA_TYPE *tmp) {
+  #pragma omp parallel
+  {
+    #pragma omp for
+    for (int i = 0; i < NX; i++) {
+      tmp[i] = bench_simd.dot(&A[i * NY], x, NY);
+    }
+
+    // y = A^T tmp as axpy updates along the rows of A, each thread owning
+    // slices of y
+    #pragma omp for
+    for (int j = 0; j < NY; j += BENCH_SIMD_SLICE) {
+      int n = BENCH_SIMD_MIN(BENCH_SIMD_SLICE, NY - j);
+      memset(&y[j], 0, n * sizeof(DATA_TYPE));
       for (int i = 0; i < NX; i++) {
-        y[j] += A[i * NY + j] * tmp[i];
+        bench_simd.axpy(&y[j], tmp[i], &A[i * NY + j], n);
       }
     }
   }
 }
+#endif
 
 int main(int argc, char **argv) {
   SALUTE("Matrix Transpose and Vector Multiplication");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NX * NY * sizeof(DATA_TYPE));
-  DATA_TYPE *x = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NX * NY * sizeof(DATA_TYPE));
+  DATA_TYPE *x = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
   DATA_TYPE *y = NULL;
   DATA_TYPE *y_OMP = NULL;
-  DATA_TYPE *tmp = (DATA_TYPE *)malloc(NX * sizeof(DATA_TYPE));
+  DATA_TYPE *tmp = (DATA_TYPE *)bench_malloc(NX * sizeof(DATA_TYPE));
 
   // initialize arrays
   init_array(x, A);
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  y_OMP = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
+  y_OMP = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
+#if defined(SIMD)
+  BENCHMARK_SIMD(atax_simd(A, x, y_OMP, tmp));
+#elif defined(FUSED)
+  BENCHMARK_OMP(atax_fused(A, x, y_OMP, tmp));
+#elif defined(PIPELINED)
+  BENCHMARK_OMP(atax_pipelined(A, x, y_OMP, tmp));
+#else
   BENCHMARK_OMP(atax_OMP(A, x, y_OMP, tmp));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(y_OMP, NY);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  y = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
+  y = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
   BENCHMARK_CPU(atax(A, x, y, tmp));
   // prevent dead code elimination
   DCE_PREVENT(y, NY);
@@ -141,11 +303,11 @@ int main(int argc, char **argv) {
 #endif
 
   // Release memory
-  free(A);
-  free(x);
-  free(y);
-  free(y_OMP);
-  free(tmp);
+  bench_free(A);
+  bench_free(x);
+  bench_free(y);
+  bench_free(y_OMP);
+  bench_free(tmp);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -20,29 +20,42 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define NX SIZE
-#define NY SIZE
+#define NX BENCH_DIM(NX)
+#define NY BENCH_DIM(NY)
 
 #ifndef M_PI
 #define M_PI 3.14159
 #endif
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksSimd.h"
+
+#if defined(FUSED) && defined(RUN_OMP_GPU)
+#error "The FUSED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (4.0 * NX * NY)
+#define KERNEL_BYTES (((double)NX * NY + 2 * NX + 2 * NY) * sizeof(DATA_TYPE))
 
 void init_array(DATA_TYPE *A, DATA_TYPE *p, DATA_TYPE *r) {
   int i, j;
 
   for (i = 0; i < NX; i++) {
-    r[i] = i * M_PI;
+    r[i] = BENCH_INPUT(i * M_PI, M_PI * NX);
     for (j = 0; j < NY; j++) {
-      A[i * NY + j] = ((DATA_TYPE)i * j) / NX;
+      // A.p reduces over NY and r.A over NX
+      A[i * NY + j] = BENCH_INPUT(((ACC_TYPE)i * j) / NX,
+                                  (ACC_TYPE)NY * (NX > NY ? NX : NY));
     }
   }
 
   for (i = 0; i < NY; i++) {
-    p[i] = i * M_PI;
+    p[i] = BENCH_INPUT(i * M_PI, M_PI * NY);
   }
 }
 
@@ -76,11 +89,12 @@ void bicg(DATA_TYPE *A, DATA_TYPE *r, DATA_TYPE *s, DATA_TYPE *p,
   }
 
   for (i = 0; i < NX; i++) {
-    q[i] = 0.0;
+    ACC_TYPE acc = 0;
     for (j = 0; j < NY; j++) {
       s[j] = s[j] + r[i] * A[i * NY + j];
-      q[i] = q[i] + A[i * NY + j] * p[j];
+      acc = acc + A[i * NY + j] * p[j];
     }
+    q[i] = acc;
   }
 }
 
@@ -92,34 +106,171 @@ void bicg_OMP(DATA_TYPE *A, DATA_TYPE *r, DATA_TYPE *s, DATA_TYPE *p,
     s[i] = 0.0;
   }
 
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NX*NY], p[:NY], r[:NX], s[:NY], q[:NX]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (NX * NY + NY + NX + NY + NX) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target teams map(to : A[ : NX *NY], p[ : NY], r[ : NX]) map(tofrom : s[ : NY], q[ : NX]) device(OMP_DEVICE_ID)
   {
     #pragma omp distribute parallel for private(i)
     for (j = 0; j < NY; j++) {
       LLVM_MCA_BEGIN("kernel");
+      ACC_TYPE acc = s[j];
       for (i = 0; i < NX; i++) {
-        s[j] = s[j] + r[i] * A[i * NY + j];
+        acc = acc + r[i] * A[i * NY + j];
       }
+      s[j] = acc;
       LLVM_MCA_END("kernel");
     }
 
     #pragma omp distribute parallel for private(j)
     for (i = 0; i < NX; i++) {
-      q[i] = 0.0;
+      ACC_TYPE acc = 0;
       for (j = 0; j < NY; j++) {
-        q[i] = q[i] + A[i * NY + j] * p[j];
+        acc = acc + A[i * NY + j] * p[j];
+      }
+      q[i] = acc;
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: s[:NY], q[:NX]) map(release: A[:NX*NY], p[:NY], r[:NX]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (NY + NX) * sizeof(DATA_TYPE));
+}
+
+#ifdef FUSED
+/**
+ * @brief Single sweep over A: each element feeds both q and private partial
+ * sums of s, one set per thread
+ */
+void bicg_fused(DATA_TYPE *A, DATA_TYPE *r, DATA_TYPE *s, DATA_TYPE *p,
+                DATA_TYPE *q) {
+  for (int j = 0; j < NY; j++) {
+    s[j] = 0;
+  }
+
+  #pragma omp parallel
+  {
+    ACC_TYPE *s_part = (ACC_TYPE *)calloc(NY, sizeof(ACC_TYPE));
+
+    #pragma omp for nowait
+    for (int i = 0; i < NX; i++) {
+      ACC_TYPE q_i = 0;
+      #pragma omp simd reduction(+ : q_i)
+      for (int j = 0; j < NY; j++) {
+        s_part[j] += r[i] * A[i * NY + j];
+        q_i += A[i * NY + j] * p[j];
       }
+      q[i] = q_i;
+    }
+
+    #pragma omp critical
+    for (int j = 0; j < NY; j++) {
+      s[j] += s_part[j];
     }
+    free(s_part);
   }
 }
+#endif
+
+#ifdef PIPELINED
+/**
+ * @brief bicg_OMP over chunks of rows of A, pipelined with target tasks: the
+ * copy of a chunk to the device overlaps the kernel of the previous one,
+ * which computes its part of q and adds its rows into s
+ */
+void bicg_pipelined(DATA_TYPE *A, DATA_TYPE *r, DATA_TYPE *s, DATA_TYPE *p,
+                    DATA_TYPE *q) {
+  int chunks = bench_pipe_chunks(NX);
+  char *dep = (char *)malloc(chunks);
+
+  for (int j = 0; j < NY; j++) {
+    s[j] = 0.0;
+  }
+
+  bench_phase_start();
+  #pragma omp target enter data map(to: p[:NY], s[:NY]) map(alloc: A[:NX*NY], r[:NX], q[:NX]) device(OMP_DEVICE_ID)
+
+  #pragma omp parallel num_threads(2)
+  #pragma omp single
+  {
+    for (int c = 0; c < chunks; c++) {
+      int lo = bench_chunk_lo(c, chunks, NX);
+      int hi = bench_chunk_lo(c + 1, chunks, NX);
+
+      #pragma omp target update to(A[lo*NY:(hi-lo)*NY], r[lo:hi-lo]) device(OMP_DEVICE_ID) nowait depend(out: dep[c])
+
+      // the chunks add into s one after the other
+      #pragma omp target teams map(to : A[ : NX *NY], p[ : NY], r[ : NX]) map(tofrom : s[ : NY], q[ : NX]) device(OMP_DEVICE_ID) nowait depend(inout: dep[c], s[0])
+      {
+        #pragma omp distribute parallel for
+        for (int j = 0; j < NY; j++) {
+          ACC_TYPE acc = s[j];
+          for (int i = lo; i < hi; i++) {
+            acc = acc + r[i] * A[i * NY + j];
+          }
+          s[j] = acc;
+        }
+
+        #pragma omp distribute parallel for
+        for (int i = lo; i < hi; i++) {
+          ACC_TYPE acc = 0;
+          for (int j = 0; j < NY; j++) {
+            acc = acc + A[i * NY + j] * p[j];
+          }
+          q[i] = acc;
+        }
+      }
+
+      #pragma omp target update from(q[lo:hi-lo]) device(OMP_DEVICE_ID) nowait depend(in: dep[c])
+    }
+    #pragma omp taskwait
+  }
+
+  #pragma omp target exit data map(from: s[:NY]) map(release: A[:NX*NY], p[:NY], r[:NX], q[:NX]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+  bench_phase_bytes(BENCH_PHASE_H2D,
+                    (NX * NY + NY + NX + NY) * sizeof(DATA_TYPE));
+  bench_phase_bytes(BENCH_PHASE_D2H, (NY + NX) * sizeof(DATA_TYPE));
+  free(dep);
+}
+#endif
+
+#ifdef SIMD
+void bicg_simd(DATA_TYPE *A, DATA_TYPE *r, DATA_TYPE *s, DATA_TYPE *p,
+               DATA_TYPE *q) {
+  #pragma omp parallel
+  {
+    // s = A^T r as axpy updates along the rows of A, each thread owning
+    // slices of s
+    #pragma omp for
+    for (int j = 0; j < NY; j += BENCH_SIMD_SLICE) {
+      int n = BENCH_SIMD_MIN(BENCH_SIMD_SLICE, NY - j);
+      memset(&s[j], 0, n * sizeof(DATA_TYPE));
+      for (int i = 0; i < NX; i++) {
+        bench_simd.axpy(&s[j], r[i], &A[i * NY + j], n);
+      }
+    }
+
+    #pragma omp for
+    for (int i = 0; i < NX; i++) {
+      q[i] = bench_simd.dot(&A[i * NY], p, NY);
+    }
+  }
+}
+#endif
 
 int main(int argc, char **argv) {
   SALUTE("BiCG Sub Kernel of BiCGStab Linear Solver");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NX * NY * sizeof(DATA_TYPE));
-  DATA_TYPE *r = (DATA_TYPE *)malloc(NX * sizeof(DATA_TYPE));
-  DATA_TYPE *p = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NX * NY * sizeof(DATA_TYPE));
+  DATA_TYPE *r = (DATA_TYPE *)bench_malloc(NX * sizeof(DATA_TYPE));
+  DATA_TYPE *p = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
   DATA_TYPE *s = NULL;
   DATA_TYPE *s_OMP = NULL;
   DATA_TYPE *q = NULL;
@@ -130,9 +281,17 @@ int main(int argc, char **argv) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  s_OMP = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
-  q_OMP = (DATA_TYPE *)malloc(NX * sizeof(DATA_TYPE));
+  s_OMP = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
+  q_OMP = (DATA_TYPE *)bench_malloc(NX * sizeof(DATA_TYPE));
+#if defined(SIMD)
+  BENCHMARK_SIMD(bicg_simd(A, r, s_OMP, p, q_OMP));
+#elif defined(FUSED)
+  BENCHMARK_OMP(bicg_fused(A, r, s_OMP, p, q_OMP));
+#elif defined(PIPELINED)
+  BENCHMARK_OMP(bicg_pipelined(A, r, s_OMP, p, q_OMP));
+#else
   BENCHMARK_OMP(bicg_OMP(A, r, s_OMP, p, q_OMP));
+#endif
   // prevent dead code elimination
   DCE_PREVENT(s_OMP, NY);
   DCE_PREVENT(q_OMP, NX);
@@ -140,8 +299,8 @@ int main(int argc, char **argv) {
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  s = (DATA_TYPE *)malloc(NY * sizeof(DATA_TYPE));
-  q = (DATA_TYPE *)malloc(NX * sizeof(DATA_TYPE));
+  s = (DATA_TYPE *)bench_malloc(NY * sizeof(DATA_TYPE));
+  q = (DATA_TYPE *)bench_malloc(NX * sizeof(DATA_TYPE));
   BENCHMARK_CPU(bicg(A, r, s, p, q));
   // prevent dead code elimination
   DCE_PREVENT(s, NY);
@@ -156,13 +315,13 @@ int main(int argc, char **argv) {
 #endif
 
   // Release memory
-  free(A);
-  free(r);
-  free(s);
-  free(p);
-  free(q);
-  free(s_OMP);
-  free(q_OMP);
+  bench_free(A);
+  bench_free(r);
+  bench_free(s);
+  bench_free(p);
+  bench_free(q);
+  bench_free(s_OMP);
+  bench_free(q_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
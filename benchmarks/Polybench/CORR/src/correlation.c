@@ -19,18 +19,32 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
 /* Problem size */
-#define M SIZE
-#define N SIZE
+#define M BENCH_DIM(M)
+#define N BENCH_DIM(N)
 
 #define sqrt_of_array_cell(x, j) sqrt(x[j])
 
 #define FLOAT_N 3214212.01f
 #define EPS 0.005f
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+/** Columns per tile and rows per chunk of the symmetric product of SYRK */
+#ifndef SYRK_TILE
+#define SYRK_TILE 32
+#endif
+#ifndef SYRK_DEPTH
+#define SYRK_DEPTH 512
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (8.0 * M * N + (double)M * (M - 1) * N)
+#define KERNEL_BYTES                                                           \
+  ((2.0 * (N + 1) + (M + 1)) * (M + 1) * sizeof(DATA_TYPE))
 
 /**
  * @brief Initialize matrice
@@ -40,9 +54,9 @@ typedef float DATA_TYPE;
 void init_arrays(DATA_TYPE *data) {
   int i, j;
 
-  for (i = 0; i < (M + 1); i++) {
-    for (j = 0; j < (N + 1); j++) {
-      data[i * (N + 1) + j] = ((DATA_TYPE)i * j) / (M + 1);
+  for (i = 0; i < (N + 1); i++) {
+    for (j = 0; j < (M + 1); j++) {
+      data[i * (M + 1) + j] = ((DATA_TYPE)i * j) / (M + 1);
     }
   }
 }
@@ -59,9 +73,9 @@ int compareResults(DATA_TYPE *symmat, DATA_TYPE *symmat_outputFromGpu) {
   fail = 0;
 
   for (i = 1; i < (M + 1); i++) {
-    for (j = 1; j < (N + 1); j++) {
-      if (percentDiff(symmat[i * (N + 1) + j],
-                      symmat_outputFromGpu[i * (N + 1) + j]) >
+    for (j = 1; j < (M + 1); j++) {
+      if (percentDiff(symmat[i * (M + 1) + j],
+                      symmat_outputFromGpu[i * (M + 1) + j]) >
           ERROR_THRESHOLD) {
         fail++;
       }
@@ -86,25 +100,22 @@ void correlation(DATA_TYPE *data, DATA_TYPE *mean, DATA_TYPE *stddev,
 
   // Determine mean of column vectors of input data matrix
   for (j = 1; j < (M + 1); j++) {
-    mean[j] = 0.0;
-
+    ACC_TYPE acc = 0;
     for (i = 1; i < (N + 1); i++) {
-      mean[j] += data[i * (M + 1) + j];
+      acc += data[i * (M + 1) + j];
     }
-
-    mean[j] /= (DATA_TYPE)FLOAT_N;
+    mean[j] = acc / (ACC_TYPE)FLOAT_N;
   }
 
   // Determine standard deviations of column vectors of data matrix.
   for (j = 1; j < (M + 1); j++) {
-    stddev[j] = 0.0;
+    ACC_TYPE acc = 0;
 
     for (i = 1; i < (N + 1); i++) {
-      stddev[j] +=
+      acc +=
           (data[i * (M + 1) + j] - mean[j]) * (data[i * (M + 1) + j] - mean[j]);
     }
-
-    stddev[j] /= FLOAT_N;
+    stddev[j] = acc / FLOAT_N;
     stddev[j] = sqrt_of_array_cell(stddev, j);
     stddev[j] = stddev[j] <= EPS ? 1.0 : stddev[j];
   }
@@ -123,12 +134,12 @@ void correlation(DATA_TYPE *data, DATA_TYPE *mean, DATA_TYPE *stddev,
     symmat[j1 * (M + 1) + j1] = 1.0;
 
     for (j2 = j1 + 1; j2 < (M + 1); j2++) {
-      symmat[j1 * (M + 1) + j2] = 0.0;
+      ACC_TYPE acc = 0;
 
       for (i = 1; i < (N + 1); i++) {
-        symmat[j1 * (M + 1) + j2] +=
-            (data[i * (M + 1) + j1] * data[i * (M + 1) + j2]);
+        acc += (data[i * (M + 1) + j1] * data[i * (M + 1) + j2]);
       }
+      symmat[j1 * (M + 1) + j2] = acc;
 
       symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
     }
@@ -148,68 +159,175 @@ void correlation(DATA_TYPE *data, DATA_TYPE *mean, DATA_TYPE *stddev,
 void correlation_OMP(DATA_TYPE *data, DATA_TYPE *mean, DATA_TYPE *stddev,
                      DATA_TYPE *symmat) {
   int i, j, k;
-  #pragma omp target data map(to: data[:(M+1)*(N+1)], mean[:(M+1)], stddev[:(M+1)]) map(tofrom: symmat[:(M+1)*(N+1)]) device(OMP_DEVICE_ID)
-  {
-    // Determine mean of column vectors of input data matrix
-    #pragma omp target teams distribute  parallel for private(i) device(OMP_DEVICE_ID)
-    for (j = 1; j < (M + 1); j++) {
-      mean[j] = 0.0;
-      for (i = 1; i < (N + 1); i++) {
-        mean[j] += data[i * (M + 1) + j];
-      }
-      mean[j] /= (DATA_TYPE)FLOAT_N;
+  bench_phase_start();
+  #pragma omp target enter data map(to: data[:(M+1)*(N+1)], mean[:(M+1)], stddev[:(M+1)], symmat[:(M+1)*(M+1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   ((M + 1) * (N + 1) + (M + 1) * (M + 1) + 2 * (M + 1)) *
+                       sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  // Determine mean of column vectors of input data matrix
+  #pragma omp target teams distribute  parallel for private(i) device(OMP_DEVICE_ID)
+  for (j = 1; j < (M + 1); j++) {
+    ACC_TYPE acc = 0;
+    for (i = 1; i < (N + 1); i++) {
+      acc += data[i * (M + 1) + j];
     }
+    mean[j] = acc / (ACC_TYPE)FLOAT_N;
+  }
 
-    // Determine standard deviations of column vectors of data matrix.
-    #pragma omp target teams distribute parallel for private(i) device(OMP_DEVICE_ID)
+  // Determine standard deviations of column vectors of data matrix.
+  #pragma omp target teams distribute parallel for private(i) device(OMP_DEVICE_ID)
+  for (j = 1; j < (M + 1); j++) {
+    ACC_TYPE acc = 0;
+    for (i = 1; i < (N + 1); i++) {
+      acc +=
+        (data[i * (M + 1) + j] - mean[j]) * (data[i * (M + 1) + j] - mean[j]);
+    }
+    stddev[j] = acc / FLOAT_N;
+    stddev[j] = sqrt(stddev[j]);
+    if (stddev[j] <= EPS) {
+      stddev[j] = 1.0;
+    }
+  }
+
+  // Center and reduce the column vectors.
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (i = 1; i < (N + 1); i++) {
     for (j = 1; j < (M + 1); j++) {
-      stddev[j] = 0.0;
+      data[i * (M + 1) + j] -= mean[j];
+      data[i * (M + 1) + j] /= (sqrt(FLOAT_N) * stddev[j]);
+    }
+  }
+
+  // Calculate the m * m correlation matrix.
+  #pragma omp target teams distribute parallel for private(j, i) device(OMP_DEVICE_ID)
+  for (k = 1; k < M; k++) {
+    symmat[k * (M + 1) + k] = 1.0;
+    for (j = k + 1; j < (M + 1); j++) {
+      ACC_TYPE acc = 0;
       for (i = 1; i < (N + 1); i++) {
-        stddev[j] +=
-          (data[i * (M + 1) + j] - mean[j]) * (data[i * (M + 1) + j] - mean[j]);
+        acc += (data[i * (M + 1) + k] * data[i * (M + 1) + j]);
       }
+      symmat[k * (M + 1) + j] = acc;
+      symmat[j * (M + 1) + k] = symmat[k * (M + 1) + j];
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
 
-      stddev[j] /= FLOAT_N;
-      stddev[j] = sqrt(stddev[j]);
-      if (stddev[j] <= EPS) {
-        stddev[j] = 1.0;
-      }
+  bench_phase_start();
+  #pragma omp target exit data map(from: symmat[:(M+1)*(M+1)]) map(release: data[:(M+1)*(N+1)], mean[:(M+1)], stddev[:(M+1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (M + 1) * (M + 1) * sizeof(DATA_TYPE));
+
+  symmat[M * (M + 1) + M] = 1.0;
+}
+
+#ifdef SYRK
+/**
+ * @brief Correlation with single-pass statistics and a blocked SYRK
+ *
+ * The mean and the variance of each column come from one streaming Welford
+ * pass. The centered and reduced data is written transposed to dataT, so that
+ * the upper triangle of the symmetric product reads contiguous rows, by tiles
+ * of SYRK_TILE x SYRK_TILE columns over chunks of SYRK_DEPTH samples. The
+ * lower triangle is mirrored afterwards.
+ */
+void correlation_syrk(DATA_TYPE *data, DATA_TYPE *mean, DATA_TYPE *stddev,
+                      DATA_TYPE *symmat, DATA_TYPE *dataT) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: data[:(M+1)*(N+1)]) map(alloc: mean[:(M+1)], stddev[:(M+1)], symmat[:(M+1)*(M+1)], dataT[:(M+1)*(N+1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (M + 1) * (N + 1) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  // Welford: running mean mu and sum of squared deviations m2
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j = 1; j < (M + 1); j++) {
+    ACC_TYPE mu = 0, m2 = 0;
+    for (int i = 1; i < (N + 1); i++) {
+      DATA_TYPE delta = data[i * (M + 1) + j] - mu;
+      mu += delta / i;
+      m2 += delta * (data[i * (M + 1) + j] - mu);
     }
 
-    // Center and reduce the column vectors.
-    #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
-    for (i = 1; i < (N + 1); i++) {
-      for (j = 1; j < (M + 1); j++) {
-        data[i * (M + 1) + j] -= mean[j];
-        data[i * (M + 1) + j] /= (sqrt(FLOAT_N) * stddev[j]);
+    // the reference divides by FLOAT_N rather than by N, so its deviations
+    // are taken around a shifted mean
+    mean[j] = mu * N / (ACC_TYPE)FLOAT_N;
+    DATA_TYPE shift = mu - mean[j];
+    stddev[j] = sqrt((m2 + N * shift * shift) / FLOAT_N);
+    if (stddev[j] <= EPS) {
+      stddev[j] = 1.0;
+    }
+  }
+
+  // Center, reduce and transpose the column vectors, by tiles
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (int ii = 1; ii < (N + 1); ii += SYRK_TILE) {
+    for (int jj = 1; jj < (M + 1); jj += SYRK_TILE) {
+      for (int j = jj; j < jj + SYRK_TILE && j < (M + 1); j++) {
+        for (int i = ii; i < ii + SYRK_TILE && i < (N + 1); i++) {
+          dataT[j * (N + 1) + i] =
+              (data[i * (M + 1) + j] - mean[j]) / (sqrt(FLOAT_N) * stddev[j]);
+        }
       }
     }
+  }
+
+  // Upper triangle of the m * m correlation matrix, by tiles
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (int jj1 = 1; jj1 < (M + 1); jj1 += SYRK_TILE) {
+    for (int jj2 = 1; jj2 < (M + 1); jj2 += SYRK_TILE) {
+      if (jj2 < jj1) {
+        continue;
+      }
+      int j1_end = jj1 + SYRK_TILE < (M + 1) ? jj1 + SYRK_TILE : (M + 1);
+      int j2_end = jj2 + SYRK_TILE < (M + 1) ? jj2 + SYRK_TILE : (M + 1);
+
+      for (int j1 = jj1; j1 < j1_end; j1++) {
+        for (int j2 = j1 + 1 > jj2 ? j1 + 1 : jj2; j2 < j2_end; j2++) {
+          symmat[j1 * (M + 1) + j2] = 0.0;
+        }
+      }
 
-    // Calculate the m * m correlation matrix.
-    #pragma omp target teams distribute parallel for private(j, i) device(OMP_DEVICE_ID)
-    for (k = 1; k < M; k++) {
-      symmat[k * (M + 1) + k] = 1.0;
-      for (j = k + 1; j < (M + 1); j++) {
-        symmat[k * (M + 1) + j] = 0.0;
-        for (i = 1; i < (N + 1); i++) {
-          symmat[k * (M + 1) + j] +=
-            (data[i * (M + 1) + k] * data[i * (M + 1) + j]);
+      for (int ii = 1; ii < (N + 1); ii += SYRK_DEPTH) {
+        int i_end = ii + SYRK_DEPTH < (N + 1) ? ii + SYRK_DEPTH : (N + 1);
+        for (int j1 = jj1; j1 < j1_end; j1++) {
+          for (int j2 = j1 + 1 > jj2 ? j1 + 1 : jj2; j2 < j2_end; j2++) {
+            ACC_TYPE acc = 0;
+            for (int i = ii; i < i_end; i++) {
+              acc += dataT[j1 * (N + 1) + i] * dataT[j2 * (N + 1) + i];
+            }
+            symmat[j1 * (M + 1) + j2] += acc;
+          }
         }
-        symmat[j * (M + 1) + k] = symmat[k * (M + 1) + j];
       }
     }
   }
 
-  symmat[M * (M + 1) + M] = 1.0;
+  // Unit diagonal and mirrored lower triangle
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j1 = 1; j1 < (M + 1); j1++) {
+    symmat[j1 * (M + 1) + j1] = 1.0;
+    for (int j2 = j1 + 1; j2 < (M + 1); j2++) {
+      symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: symmat[:(M+1)*(M+1)]) map(release: data[:(M+1)*(N+1)], mean[:(M+1)], stddev[:(M+1)], dataT[:(M+1)*(N+1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (M + 1) * (M + 1) * sizeof(DATA_TYPE));
 }
+#endif
 
 int main() {
   SALUTE("Correlation Computation");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *data = (DATA_TYPE *) malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
-  DATA_TYPE *mean = (DATA_TYPE *) malloc((M + 1) * sizeof(DATA_TYPE));
-  DATA_TYPE *stddev = (DATA_TYPE *) malloc((M + 1) * sizeof(DATA_TYPE));
+  DATA_TYPE *data =
+      (DATA_TYPE *) bench_malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
+  DATA_TYPE *mean = (DATA_TYPE *) bench_malloc((M + 1) * sizeof(DATA_TYPE));
+  DATA_TYPE *stddev = (DATA_TYPE *) bench_malloc((M + 1) * sizeof(DATA_TYPE));
   DATA_TYPE *symmat = NULL;
   DATA_TYPE *symmat_GPU = NULL;
 
@@ -217,21 +335,30 @@ int main() {
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
   // init operand matrices
-  init_arrays(data);
-  symmat_GPU = (DATA_TYPE *) malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
-  BENCHMARK_OMP(correlation_OMP(data, mean, stddev, symmat_GPU));
+  symmat_GPU =
+      (DATA_TYPE *) bench_malloc((M + 1) * (M + 1) * sizeof(DATA_TYPE));
+#ifdef SYRK
+  DATA_TYPE *dataT =
+      (DATA_TYPE *) bench_malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
+  BENCHMARK_OMP_SETUP(init_arrays(data),
+                      correlation_syrk(data, mean, stddev, symmat_GPU, dataT));
+  bench_free(dataT);
+#else
+  BENCHMARK_OMP_SETUP(init_arrays(data),
+                      correlation_OMP(data, mean, stddev, symmat_GPU));
+#endif
   // prevent dead-code elimination
-  DCE_PREVENT(symmat_GPU, (M+1)*(N+1));
+  DCE_PREVENT(symmat_GPU, (M+1)*(M+1));
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
   // init operand matrices
-  init_arrays(data);
-  symmat = (DATA_TYPE *) malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
-  BENCHMARK_CPU(correlation(data, mean, stddev, symmat));
+  symmat = (DATA_TYPE *) bench_malloc((M + 1) * (M + 1) * sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_arrays(data),
+                      correlation(data, mean, stddev, symmat));
   // prevent dead-code elimination
-  DCE_PREVENT(symmat, (M+1)*(N+1));
+  DCE_PREVENT(symmat, (M+1)*(M+1));
 #endif
 
   int fail = 0;
@@ -242,11 +369,11 @@ int main() {
 #endif
 
   // release memory
-  free(data);
-  free(mean);
-  free(stddev);
-  free(symmat_GPU);
-  free(symmat);
+  bench_free(data);
+  bench_free(mean);
+  bench_free(stddev);
+  bench_free(symmat_GPU);
+  bench_free(symmat);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -20,25 +20,41 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
 /* Problem size */
-#define M SIZE
-#define N SIZE
+#define M BENCH_DIM(M)
+#define N BENCH_DIM(N)
 
 #define sqrt_of_array_cell(x, j) sqrt(x[j])
 
 #define FLOAT_N 3214212.01
 #define EPS 0.005
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+/** Columns per tile and rows per chunk of the symmetric product of SYRK */
+#ifndef SYRK_TILE
+#define SYRK_TILE 32
+#endif
+#ifndef SYRK_DEPTH
+#define SYRK_DEPTH 512
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (2.0 * M * N + M + (double)M * (M + 1) * N)
+#define KERNEL_BYTES                                                           \
+  ((2.0 * (N + 1) + (M + 1)) * (M + 1) * sizeof(DATA_TYPE))
 
 void init_arrays(DATA_TYPE *data) {
   int i, j;
 
-  for (i = 1; i < (M + 1); i++) {
-    for (j = 1; j < (N + 1); j++) {
-      data[i * (N + 1) + j] = ((DATA_TYPE)i * j) / M;
+  for (i = 1; i < (N + 1); i++) {
+    for (j = 1; j < (M + 1); j++) {
+      // the covariances sum N products of two columns
+      data[i * (M + 1) + j] = BENCH_INPUT(((ACC_TYPE)i * j) / M,
+                                          N * sqrtf(N));
     }
   }
 }
@@ -48,9 +64,9 @@ int compareResults(DATA_TYPE *symmat, DATA_TYPE *symmat_outputFromGpu) {
   fail = 0;
 
   for (i = 1; i < (M + 1); i++) {
-    for (j = 1; j < (N + 1); j++) {
-      if (percentDiff(symmat[i * (N + 1) + j],
-                      symmat_outputFromGpu[i * (N + 1) + j]) >
+    for (j = 1; j < (M + 1); j++) {
+      if (percentDiff(symmat[i * (M + 1) + j],
+                      symmat_outputFromGpu[i * (M + 1) + j]) >
           ERROR_THRESHOLD) {
         fail++;
       }
@@ -64,11 +80,11 @@ void covariance(DATA_TYPE *data, DATA_TYPE *symmat, DATA_TYPE *mean) {
 
   /* Determine mean of column vectors of input data matrix */
   for (j = 1; j < (M + 1); j++) {
-    mean[j] = 0.0;
+    ACC_TYPE acc = 0;
     for (i = 1; i < (N + 1); i++) {
-      mean[j] += data[i * (M + 1) + j];
+      acc += data[i * (M + 1) + j];
     }
-    mean[j] /= FLOAT_N;
+    mean[j] = acc / FLOAT_N;
   }
 
   /* Center the column vectors. */
@@ -81,11 +97,11 @@ void covariance(DATA_TYPE *data, DATA_TYPE *symmat, DATA_TYPE *mean) {
   /* Calculate the m * m covariance matrix. */
   for (j1 = 1; j1 < (M + 1); j1++) {
     for (j2 = j1; j2 < (M + 1); j2++) {
-      symmat[j1 * (M + 1) + j2] = 0.0;
+      ACC_TYPE acc = 0;
       for (i = 1; i < N + 1; i++) {
-        symmat[j1 * (M + 1) + j2] +=
-            data[i * (M + 1) + j1] * data[i * (M + 1) + j2];
+        acc += data[i * (M + 1) + j1] * data[i * (M + 1) + j2];
       }
+      symmat[j1 * (M + 1) + j2] = acc;
       symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
     }
   }
@@ -95,69 +111,175 @@ void covariance_OMP(DATA_TYPE *data, DATA_TYPE *symmat, DATA_TYPE *mean) {
 
   /* Determine mean of column vectors of input data matrix */
 
-  #pragma omp target data \
-    map(to: data[:(M + 1) * (N + 1)]) \
-    map(alloc: mean[:(M + 1)]) \
-    map(tofrom: symmat[:(M + 1) * (N + 1)]) device(OMP_DEVICE_ID)
-  {
-    #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  bench_phase_start();
+  #pragma omp target enter data map(to: data[:(M + 1) * (N + 1)], symmat[:(M + 1) * (M + 1)]) map(alloc: mean[:(M + 1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, ((M + 1) * (N + 1) + (M + 1) * (M + 1)) *
+                       sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j = 1; j < (M + 1); j++) {
+    ACC_TYPE acc = 0;
+    for (int i = 1; i < (N + 1); i++) {
+      acc += data[i * (M + 1) + j];
+    }
+    mean[j] = acc / FLOAT_N;
+  }
+
+  /* Center the column vectors. */
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (int i = 1; i < (N + 1); i++) {
     for (int j = 1; j < (M + 1); j++) {
-      mean[j] = 0.0;
-      for (int i = 1; i < (N + 1); i++) {
-        mean[j] += data[i * (M + 1) + j];
+      data[i * (M + 1) + j] -= mean[j];
+    }
+  }
+
+  /* Calculate the m * m covariance matrix. */
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j1 = 1; j1 < (M + 1); j1++) {
+    for (int j2 = j1; j2 < (M + 1); j2++) {
+      ACC_TYPE acc = 0;
+      for (int i = 1; i < N + 1; i++) {
+        acc += data[i * (M + 1) + j1] * data[i * (M + 1) + j2];
       }
-      mean[j] /= FLOAT_N;
+      symmat[j1 * (M + 1) + j2] = acc;
+      symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
     }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: symmat[:(M + 1) * (M + 1)]) map(release: data[:(M + 1) * (N + 1)], mean[:(M + 1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (M + 1) * (M + 1) * sizeof(DATA_TYPE));
+}
 
-    /* Center the column vectors. */
-    #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+#ifdef SYRK
+/**
+ * @brief Covariance with single-pass statistics and a blocked SYRK
+ *
+ * One streaming Welford pass gives the mean and the variance of each column,
+ * which is the diagonal of the covariance matrix. The centered data is
+ * written transposed to dataT, so that the strict upper triangle of the
+ * symmetric product reads contiguous rows, by tiles of SYRK_TILE x SYRK_TILE
+ * columns over chunks of SYRK_DEPTH samples. The lower triangle is mirrored
+ * afterwards.
+ */
+void covariance_syrk(DATA_TYPE *data, DATA_TYPE *symmat, DATA_TYPE *mean,
+                     DATA_TYPE *dataT) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: data[:(M + 1) * (N + 1)]) map(alloc: symmat[:(M + 1) * (M + 1)], mean[:(M + 1)], dataT[:(M + 1) * (N + 1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (M + 1) * (N + 1) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  // Welford: running mean mu and sum of squared deviations m2
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j = 1; j < (M + 1); j++) {
+    ACC_TYPE mu = 0, m2 = 0;
     for (int i = 1; i < (N + 1); i++) {
-      for (int j = 1; j < (M + 1); j++) {
-        data[i * (M + 1) + j] -= mean[j];
+      DATA_TYPE delta = data[i * (M + 1) + j] - mu;
+      mu += delta / i;
+      m2 += delta * (data[i * (M + 1) + j] - mu);
+    }
+
+    // the reference divides by FLOAT_N rather than by N, so its deviations
+    // are taken around a shifted mean
+    mean[j] = mu * N / FLOAT_N;
+    DATA_TYPE shift = mu - mean[j];
+    symmat[j * (M + 1) + j] = m2 + N * shift * shift;
+  }
+
+  /* Center and transpose the column vectors, by tiles */
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (int ii = 1; ii < (N + 1); ii += SYRK_TILE) {
+    for (int jj = 1; jj < (M + 1); jj += SYRK_TILE) {
+      for (int j = jj; j < jj + SYRK_TILE && j < (M + 1); j++) {
+        for (int i = ii; i < ii + SYRK_TILE && i < (N + 1); i++) {
+          dataT[j * (N + 1) + i] = data[i * (M + 1) + j] - mean[j];
+        }
       }
     }
+  }
+
+  /* Strict upper triangle of the m * m covariance matrix, by tiles */
+  #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+  for (int jj1 = 1; jj1 < (M + 1); jj1 += SYRK_TILE) {
+    for (int jj2 = 1; jj2 < (M + 1); jj2 += SYRK_TILE) {
+      if (jj2 < jj1) {
+        continue;
+      }
+      int j1_end = jj1 + SYRK_TILE < (M + 1) ? jj1 + SYRK_TILE : (M + 1);
+      int j2_end = jj2 + SYRK_TILE < (M + 1) ? jj2 + SYRK_TILE : (M + 1);
 
-    /* Calculate the m * m covariance matrix. */
-    #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
-    for (int j1 = 1; j1 < (M + 1); j1++) {
-      for (int j2 = j1; j2 < (M + 1); j2++) {
-        symmat[j1 * (M + 1) + j2] = 0.0;
-        for (int i = 1; i < N + 1; i++) {
-          symmat[j1 * (M + 1) + j2] +=
-              data[i * (M + 1) + j1] * data[i * (M + 1) + j2];
+      for (int j1 = jj1; j1 < j1_end; j1++) {
+        for (int j2 = j1 + 1 > jj2 ? j1 + 1 : jj2; j2 < j2_end; j2++) {
+          symmat[j1 * (M + 1) + j2] = 0.0;
+        }
+      }
+
+      for (int ii = 1; ii < (N + 1); ii += SYRK_DEPTH) {
+        int i_end = ii + SYRK_DEPTH < (N + 1) ? ii + SYRK_DEPTH : (N + 1);
+        for (int j1 = jj1; j1 < j1_end; j1++) {
+          for (int j2 = j1 + 1 > jj2 ? j1 + 1 : jj2; j2 < j2_end; j2++) {
+            ACC_TYPE acc = 0;
+            for (int i = ii; i < i_end; i++) {
+              acc += dataT[j1 * (N + 1) + i] * dataT[j2 * (N + 1) + i];
+            }
+            symmat[j1 * (M + 1) + j2] += acc;
+          }
         }
-        symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
       }
     }
   }
+
+  /* Mirror the lower triangle */
+  #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  for (int j1 = 1; j1 < (M + 1); j1++) {
+    for (int j2 = j1 + 1; j2 < (M + 1); j2++) {
+      symmat[j2 * (M + 1) + j1] = symmat[j1 * (M + 1) + j2];
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: symmat[:(M + 1) * (M + 1)]) map(release: data[:(M + 1) * (N + 1)], mean[:(M + 1)], dataT[:(M + 1) * (N + 1)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, (M + 1) * (M + 1) * sizeof(DATA_TYPE));
 }
+#endif
 
 int main() {
   SALUTE("Covariance Computation");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate common memory
   DATA_TYPE *data = NULL;
   DATA_TYPE *data_OMP = NULL;
   DATA_TYPE *symmat = NULL;
   DATA_TYPE *symmat_OMP = NULL;
-  DATA_TYPE *mean = (DATA_TYPE *)calloc((M + 1), sizeof(DATA_TYPE));
+  DATA_TYPE *mean = (DATA_TYPE *)bench_calloc((M + 1), sizeof(DATA_TYPE));
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  symmat_OMP = (DATA_TYPE *)calloc((M + 1) * (M + 1), sizeof(DATA_TYPE));
-  data_OMP = (DATA_TYPE *)calloc((M + 1) * (N + 1), sizeof(DATA_TYPE));
-  init_arrays(data_OMP);
-  BENCHMARK_OMP(covariance_OMP(data_OMP, symmat_OMP, mean));
+  symmat_OMP = (DATA_TYPE *)bench_calloc((M + 1) * (M + 1), sizeof(DATA_TYPE));
+  data_OMP = (DATA_TYPE *)bench_calloc((M + 1) * (N + 1), sizeof(DATA_TYPE));
+#ifdef SYRK
+  DATA_TYPE *dataT =
+      (DATA_TYPE *)bench_malloc((M + 1) * (N + 1) * sizeof(DATA_TYPE));
+  BENCHMARK_OMP_SETUP(init_arrays(data_OMP),
+                      covariance_syrk(data_OMP, symmat_OMP, mean, dataT));
+  bench_free(dataT);
+#else
+  BENCHMARK_OMP_SETUP(init_arrays(data_OMP),
+                      covariance_OMP(data_OMP, symmat_OMP, mean));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(symmat_OMP, (M+1)*(M+1));
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  symmat = (DATA_TYPE *)calloc((M + 1) * (M + 1), sizeof(DATA_TYPE));
-  data = (DATA_TYPE *)calloc((M + 1) * (N + 1), sizeof(DATA_TYPE));
-  init_arrays(data);
-  BENCHMARK_CPU(covariance(data, symmat, mean));
+  symmat = (DATA_TYPE *)bench_calloc((M + 1) * (M + 1), sizeof(DATA_TYPE));
+  data = (DATA_TYPE *)bench_calloc((M + 1) * (N + 1), sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_arrays(data), covariance(data, symmat, mean));
   // prevent dead-code elimination
   DCE_PREVENT(symmat, (M+1)*(M+1));
 #endif
@@ -170,11 +292,11 @@ int main() {
 #endif
 
   // release memory
-  free(data);
-  free(data_OMP);
-  free(symmat);
-  free(symmat_OMP);
-  free(mean);
+  bench_free(data);
+  bench_free(data_OMP);
+  bench_free(symmat);
+  bench_free(symmat_OMP);
+  bench_free(mean);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
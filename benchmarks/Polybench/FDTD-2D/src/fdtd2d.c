@@ -16,18 +16,40 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <string.h>
+#include <sched.h>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
 #define tmax 500
-#define NX SIZE
-#define NY SIZE
+#define NX BENCH_DIM(NX)
+#define NY BENCH_DIM(NY)
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#if defined(TILED) && defined(RUN_OMP_GPU)
+#error "The TILED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Timesteps advanced per tile by the TILED variant */
+#ifndef FDTD_TIME_TILE
+#define FDTD_TIME_TILE 16
+#endif
+
+/** Rows of each band of a tile in the TILED variant */
+#ifndef FDTD_ROW_TILE
+#define FDTD_ROW_TILE 16
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS                                                           \
+  (tmax * (3.0 * (NX - 1) * NY + 3.0 * NX * (NY - 1) + 5.0 * NX * NY))
+#define KERNEL_BYTES                                                           \
+  ((2.0 * (NX * (NY + 1) + (NX + 1) * NY + NX * NY) + tmax) * sizeof(DATA_TYPE))
 
 void init_arrays(DATA_TYPE *_fict_, DATA_TYPE *ex, DATA_TYPE *ey,
                  DATA_TYPE *hz) {
@@ -56,6 +78,22 @@ void init_array_hz(DATA_TYPE *hz) {
   }
 }
 
+/**
+ * @brief Restores the initial state of all the arrays updated by the kernel
+ *
+ * NOTE: it seems the init_arrays does not overwrite all memory positions
+ * on ex and ey. In turn, that seems to affect the final output and generate
+ * errors. Since I dont know the algorithm, this is a quick fix that resets
+ * the arrays with 0s, the then initializes everything again
+ */
+void reset_arrays(DATA_TYPE *_fict_, DATA_TYPE *ex, DATA_TYPE *ey,
+                  DATA_TYPE *hz) {
+  memset(_fict_, 0, tmax * sizeof(DATA_TYPE));
+  memset(ex, 0, NX * (NY + 1) * sizeof(DATA_TYPE));
+  memset(ey, 0, (NX + 1) * NY * sizeof(DATA_TYPE));
+  init_arrays(_fict_, ex, ey, hz);
+}
+
 int compareResults(DATA_TYPE *hz1, DATA_TYPE *hz2) {
   int i, j, fail;
   fail = 0;
@@ -108,81 +146,170 @@ void runFdtd_OMP(DATA_TYPE *_fict_, DATA_TYPE *ex, DATA_TYPE *ey,
                  DATA_TYPE *hz) {
   int t, i, j;
   
-  #pragma omp target data  map(to : _fict_[ : tmax], ex[ : (NX *(NY + 1))], ey[ : ((NX + 1) * NY)]) map(tofrom : hz[ : NX *NY]) device(OMP_DEVICE_ID)
-  {
-    for (t = 0; t < tmax; t++) {
-      #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+  bench_phase_start();
+  #pragma omp target enter data map(to: _fict_[:tmax], ex[:(NX * (NY + 1))], ey[:((NX + 1) * NY)], hz[:NX * NY]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (tmax + NX * (NY + 1) + (NX + 1) * NY + NX * NY) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  for (t = 0; t < tmax; t++) {
+    #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+    for (j = 0; j < NY; j++) {
+      ey[0 * NY + j] = _fict_[t];
+    }
+
+    #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+    for (i = 1; i < NX; i++) {
       for (j = 0; j < NY; j++) {
-        ey[0 * NY + j] = _fict_[t];
+        ey[i * NY + j] =
+            ey[i * NY + j] - 0.5 * (hz[i * NY + j] - hz[(i - 1) * NY + j]);
       }
+    }
 
-      #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
-      for (i = 1; i < NX; i++) {
-        for (j = 0; j < NY; j++) {
-          ey[i * NY + j] =
-              ey[i * NY + j] - 0.5 * (hz[i * NY + j] - hz[(i - 1) * NY + j]);
-        }
+    #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+    for (i = 0; i < NX; i++) {
+      for (j = 1; j < NY; j++) {
+        ex[i * (NY + 1) + j] = ex[i * (NY + 1) + j] -
+                               0.5 * (hz[i * NY + j] - hz[i * NY + (j - 1)]);
+      }
+    }
+    
+    #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
+    for (i = 0; i < NX; i++) {
+      for (j = 0; j < NY; j++) {
+        hz[i * NY + j] =
+            hz[i * NY + j] -
+            0.7 * (ex[i * (NY + 1) + (j + 1)] - ex[i * (NY + 1) + j] +
+                   ey[(i + 1) * NY + j] - ey[i * NY + j]);
       }
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: hz[:NX * NY]) map(release: _fict_[:tmax], ex[:(NX * (NY + 1))], ey[:((NX + 1) * NY)]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, NX * NY * sizeof(DATA_TYPE));
+}
+
+#ifdef TILED
+/**
+ * @brief Time-skewed FDTD, advancing FDTD_TIME_TILE timesteps per tile
+ *
+ * A tile sweeps bands of FDTD_ROW_TILE rows from the top of the grid. Within
+ * a band, timestep s of the tile updates ex and ey on the rows shifted up by
+ * s, then hz one row further up: ey[i] reads hz[i - 1] and hz[i] reads
+ * ey[i + 1], so a band only reads rows that the band above has left at the
+ * right timestep. The rows of a band stay in cache for all the timesteps of
+ * the tile.
+ *
+ * The bands are dealt to the threads in turn and run as a wavefront: a band
+ * starts a timestep once the band above has finished it, which each band
+ * publishes in done, so as many bands as threads advance together, one
+ * timestep apart. The threads only meet at a barrier at the end of a tile.
+ */
+void runFdtd_tiled(DATA_TYPE *_fict_, DATA_TYPE *ex, DATA_TYPE *ey,
+                   DATA_TYPE *hz) {
+  int bands = (NX + FDTD_TIME_TILE + FDTD_ROW_TILE - 1) / FDTD_ROW_TILE;
+  // timesteps completed by each band
+  int *done = (int *)bench_calloc(bands, sizeof(int));
 
-      #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
-      for (i = 0; i < NX; i++) {
-        for (j = 1; j < NY; j++) {
-          ex[i * (NY + 1) + j] = ex[i * (NY + 1) + j] -
-                                 0.5 * (hz[i * NY + j] - hz[i * NY + (j - 1)]);
+  #pragma omp parallel
+  for (int t0 = 0; t0 < tmax; t0 += FDTD_TIME_TILE) {
+    int steps = tmax - t0 < FDTD_TIME_TILE ? tmax - t0 : FDTD_TIME_TILE;
+    int tile_bands = (NX + steps + FDTD_ROW_TILE - 1) / FDTD_ROW_TILE;
+
+    #pragma omp for schedule(static, 1)
+    for (int b = 0; b < tile_bands; b++) {
+      int lo = b * FDTD_ROW_TILE;
+
+      for (int s = 0; s < steps; s++) {
+        int t = t0 + s;
+        // rows of hz at this step, clipped to the grid. ex and ey are one row
+        // below, except that the first band always starts at row 0
+        int h_lo = lo - s > 0 ? lo - s : 0;
+        int h_hi = lo + FDTD_ROW_TILE - s;
+        int e_lo = lo == 0 || lo - s + 1 < 0 ? 0 : lo - s + 1;
+        int e_hi = h_hi + 1 < NX ? h_hi + 1 : NX;
+        h_hi = h_hi < NX ? h_hi : NX;
+
+        for (int above = 0; b > 0 && above <= t;) {
+          #pragma omp atomic read seq_cst
+          above = done[b - 1];
+          if (above <= t)
+            sched_yield();
         }
-      }
-      
-      #pragma omp target teams distribute parallel for collapse(2) device(OMP_DEVICE_ID)
-      for (i = 0; i < NX; i++) {
-        for (j = 0; j < NY; j++) {
-          hz[i * NY + j] =
-              hz[i * NY + j] -
-              0.7 * (ex[i * (NY + 1) + (j + 1)] - ex[i * (NY + 1) + j] +
-                     ey[(i + 1) * NY + j] - ey[i * NY + j]);
+
+        for (int i = e_lo; i < e_hi; i++) {
+          if (i == 0) {
+            for (int j = 0; j < NY; j++) {
+              ey[j] = _fict_[t];
+            }
+          } else {
+            for (int j = 0; j < NY; j++) {
+              ey[i * NY + j] = ey[i * NY + j] -
+                               0.5 * (hz[i * NY + j] - hz[(i - 1) * NY + j]);
+            }
+          }
+          for (int j = 1; j < NY; j++) {
+            ex[i * (NY + 1) + j] =
+                ex[i * (NY + 1) + j] -
+                0.5 * (hz[i * NY + j] - hz[i * NY + (j - 1)]);
+          }
+        }
+
+        for (int i = h_lo; i < h_hi; i++) {
+          for (int j = 0; j < NY; j++) {
+            hz[i * NY + j] =
+                hz[i * NY + j] -
+                0.7 * (ex[i * (NY + 1) + (j + 1)] - ex[i * (NY + 1) + j] +
+                       ey[(i + 1) * NY + j] - ey[i * NY + j]);
+          }
         }
+
+        #pragma omp atomic write seq_cst
+        done[b] = t + 1;
       }
     }
   }
+
+  bench_free(done);
 }
+#endif
 
 int main() {
   SALUTE("2-D Finite Different Time Domain Kernel");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
-  DATA_TYPE *_fict_ = (DATA_TYPE *)calloc(tmax, sizeof(DATA_TYPE));
-  DATA_TYPE *ex = (DATA_TYPE *)calloc(NX * (NY + 1), sizeof(DATA_TYPE));
-  DATA_TYPE *ey = (DATA_TYPE *)calloc((NX + 1) * NY, sizeof(DATA_TYPE));
+  DATA_TYPE *_fict_ = (DATA_TYPE *)bench_calloc(tmax, sizeof(DATA_TYPE));
+  DATA_TYPE *ex = (DATA_TYPE *)bench_calloc(NX * (NY + 1), sizeof(DATA_TYPE));
+  DATA_TYPE *ey = (DATA_TYPE *)bench_calloc((NX + 1) * NY, sizeof(DATA_TYPE));
   DATA_TYPE *hz = NULL;
   DATA_TYPE *hz_outputFromGpu = NULL;
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
   // allocate
-  hz_outputFromGpu = (DATA_TYPE *) malloc(NX * NY * sizeof(DATA_TYPE));
-  // init arrays
-  init_arrays(_fict_, ex, ey, hz_outputFromGpu);
-  // benchmark
-  BENCHMARK_OMP(runFdtd_OMP(_fict_, ex, ey, hz_outputFromGpu));
+  hz_outputFromGpu = (DATA_TYPE *) bench_malloc(NX * NY * sizeof(DATA_TYPE));
+  // benchmark, restoring the arrays before each iteration
+#ifdef TILED
+  BENCHMARK_OMP_SETUP(reset_arrays(_fict_, ex, ey, hz_outputFromGpu),
+                      runFdtd_tiled(_fict_, ex, ey, hz_outputFromGpu));
+#else
+  BENCHMARK_OMP_SETUP(reset_arrays(_fict_, ex, ey, hz_outputFromGpu),
+                      runFdtd_OMP(_fict_, ex, ey, hz_outputFromGpu));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(hz_outputFromGpu, NX*NY);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  // reset memory for common/shared arrays
-  // NOTE: it seems the init_arrays does not overwrite all memory positions
-  // on ex and ey. In turn, that seems to affect the final output and generate
-  // errors. Since I dont know the algorithm, this is a quick fix that resets
-  // the arrays with 0s, the then initializes everything again
-  memset(_fict_, 0, tmax * sizeof(DATA_TYPE));
-  memset(ex, 0, NX * (NY + 1) * sizeof(DATA_TYPE));
-  memset(ey, 0, (NX + 1) * NY * sizeof(DATA_TYPE));
   // allocate
-  hz = (DATA_TYPE *) malloc(NX * NY * sizeof(DATA_TYPE));
-  // init arrays
-  init_arrays(_fict_, ex, ey, hz);
-  // benchmark
-  BENCHMARK_CPU(runFdtd(_fict_, ex, ey, hz));
+  hz = (DATA_TYPE *) bench_malloc(NX * NY * sizeof(DATA_TYPE));
+  // benchmark, restoring the arrays before each iteration
+  BENCHMARK_CPU_SETUP(reset_arrays(_fict_, ex, ey, hz),
+                      runFdtd(_fict_, ex, ey, hz));
   // prevent dead-code elimination
   DCE_PREVENT(hz, NX*NY);
 #endif
@@ -195,11 +322,11 @@ int main() {
 #endif
 
   // release memory
-  free(_fict_);
-  free(ex);
-  free(ey);
-  free(hz);
-  free(hz_outputFromGpu);
+  bench_free(_fict_);
+  bench_free(ex);
+  bench_free(ey);
+  bench_free(hz);
+  bench_free(hz_outputFromGpu);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -21,31 +21,40 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define NI SIZE
-#define NJ SIZE
-#define NK SIZE
+#define NI BENCH_DIM(NI)
+#define NJ BENCH_DIM(NJ)
+#define NK BENCH_DIM(NK)
 
 /* Declared constant values for ALPHA and BETA (same as values in PolyBench 2.0)
  */
 #define ALPHA 32412.0f
 #define BETA 2123.0f
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksGemm.h"
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS ((double)NI * NJ * (3 * NK + 1))
+#define KERNEL_BYTES                                                           \
+  (((double)NI * NK + NK * NJ + 2 * NI * NJ) * sizeof(DATA_TYPE))
 
 void init(DATA_TYPE *A, DATA_TYPE *B) {
   int i, j;
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NK; j++) {
-      A[i * NK + j] = ((DATA_TYPE)i * j) / NI;
+      A[i * NK + j] = BENCH_INPUT(((ACC_TYPE)i * j) / NI, NK);
     }
   }
 
   for (i = 0; i < NK; i++) {
     for (j = 0; j < NJ; j++) {
-      B[i * NJ + j] = ((DATA_TYPE)i * j + 1) / NJ;
+      B[i * NJ + j] = BENCH_INPUT(((ACC_TYPE)i * j + 1) / NJ,
+                                  (ACC_TYPE)NK * NK);
     }
   }
 }
@@ -55,7 +64,7 @@ void init_C(DATA_TYPE *C) {
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NJ; j++) {
-      C[i * NJ + j] = ((DATA_TYPE)i * j + 2) / NJ;
+      C[i * NJ + j] = BENCH_INPUT(((ACC_TYPE)i * j + 2) / NJ, NI);
     }
   }
 }
@@ -81,34 +90,86 @@ void gemm(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
 
   for (i = 0; i < NI; i++) {
     for (j = 0; j < NJ; j++) {
-      C[i * NJ + j] *= BETA;
-
+      ACC_TYPE acc = C[i * NJ + j] * BETA;
       for (k = 0; k < NK; ++k) {
-        C[i * NJ + j] += ALPHA * A[i * NK + k] * B[k * NJ + j];
+        acc += ALPHA * A[i * NK + k] * B[k * NJ + j];
       }
+      C[i * NJ + j] = acc;
     }
   }
 }
 
-void gemm_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+/**
+ * @brief Maps A, B and C to the device
+ */
+void gemm_enter(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:NI*NK], B[:NK*NJ], C[:NI*NJ]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   (NI * NK + NK * NJ + NI * NJ) * sizeof(DATA_TYPE));
+}
+
+/**
+ * @brief C = alpha.A.B + beta.C on the device, where A, B and C are present
+ */
+void gemm_kernel(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  bench_phase_start();
   #pragma omp target map(to : A[ : NI *NK], B[ : NK *NJ]) map(tofrom : C[ : NI *NJ]) device(OMP_DEVICE_ID)
   #pragma omp teams distribute parallel for
   for (int i = 0; i < NI; i++) {
     for (int j = 0; j < NJ; j++) {
-      C[i * NJ + j] *= BETA;
+      ACC_TYPE acc = C[i * NJ + j] * BETA;
       for (int k = 0; k < NK; ++k) {
-        C[i * NJ + j] += ALPHA * A[i * NK + k] * B[k * NJ + j];
+        acc += ALPHA * A[i * NK + k] * B[k * NJ + j];
       }
+      C[i * NJ + j] = acc;
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+}
+
+/**
+ * @brief Copies C back to the host and releases the device data
+ */
+void gemm_exit(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  bench_phase_start();
+  #pragma omp target exit data map(from: C[:NI*NJ]) map(release: A[:NI*NK], B[:NK*NJ]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, NI * NJ * sizeof(DATA_TYPE));
+}
+
+void gemm_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  gemm_enter(A, B, C);
+  gemm_kernel(A, B, C);
+  gemm_exit(A, B, C);
+}
+
+/**
+ * @brief init_C on the device, where C is present, so that the RESIDENT
+ * iterations start from the same C without copying it
+ */
+void init_C_device(DATA_TYPE *C) {
+  #pragma omp target teams distribute parallel for map(tofrom: C[:NI*NJ]) device(OMP_DEVICE_ID)
+  for (int i = 0; i < NI; i++) {
+    for (int j = 0; j < NJ; j++) {
+      C[i * NJ + j] = BENCH_INPUT(((ACC_TYPE)i * j + 2) / NJ, NI);
+    }
+  }
+}
+
+/**
+ * @brief Cache-blocked and register-tiled version of gemm_OMP, for the CPU
+ */
+void gemm_blocked(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  bench_gemm(0, 0, NI, NJ, NK, ALPHA, A, NK, B, NJ, BETA, C, NJ);
 }
 
 int main(int argc, char *argv[]) {
   SALUTE("Matrix-multiply C=alpha.A.B+beta.C");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory for common arrays
-  DATA_TYPE *A = (DATA_TYPE *)malloc(NI * NK * sizeof(DATA_TYPE));
-  DATA_TYPE *B = (DATA_TYPE *)malloc(NK * NJ * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(NI * NK * sizeof(DATA_TYPE));
+  DATA_TYPE *B = (DATA_TYPE *)bench_malloc(NK * NJ * sizeof(DATA_TYPE));
   DATA_TYPE *C = NULL;
   DATA_TYPE *C_OMP = NULL;
 
@@ -117,18 +178,23 @@ int main(int argc, char *argv[]) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  C_OMP = (DATA_TYPE *) calloc(NI * NJ, sizeof(DATA_TYPE));
-  init_C(C_OMP);
-  BENCHMARK_OMP(gemm_OMP(A, B, C_OMP));
+  C_OMP = (DATA_TYPE *) bench_calloc(NI * NJ, sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP_SETUP(init_C(C_OMP), gemm_blocked(A, B, C_OMP));
+#elif defined(RESIDENT)
+  BENCHMARK_OMP_RESIDENT(gemm_enter(A, B, C_OMP), init_C_device(C_OMP),
+                         gemm_kernel(A, B, C_OMP), gemm_exit(A, B, C_OMP));
+#else
+  BENCHMARK_OMP_SETUP(init_C(C_OMP), gemm_OMP(A, B, C_OMP));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(C_OMP, NI*NJ);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  C = (DATA_TYPE *) calloc(NI * NJ, sizeof(DATA_TYPE));
-  init_C(C);
-  BENCHMARK_CPU(gemm(A, B, C));
+  C = (DATA_TYPE *) bench_calloc(NI * NJ, sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_C(C), gemm(A, B, C));
   // prevent dead-code elimination
   DCE_PREVENT(C, NI*NJ);
 #endif
@@ -141,10 +207,10 @@ int main(int argc, char *argv[]) {
 #endif
   
   // release memory
-  free(A);
-  free(B);
-  free(C);
-  free(C_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(C);
+  bench_free(C_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -22,47 +22,64 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define N SIZE
+#define N BENCH_DIM(N)
 
 /* Declared constant values for ALPHA and BETA (same as values in PolyBench 2.0)
  */
 #define ALPHA 43532.0f
 #define BETA 12313.0f
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksSimd.h"
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (4.0 * N * N + 3.0 * N)
+#define KERNEL_BYTES ((2.0 * N * N + 3 * N) * sizeof(DATA_TYPE))
 
 void gesummv(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *x, DATA_TYPE *y,
              DATA_TYPE *tmp) {
   int i, j;
 
   for (i = 0; i < N; i++) {
-    tmp[i] = 0;
-    y[i] = 0;
+    ACC_TYPE t = 0, acc = 0;
     for (j = 0; j < N; j++) {
-      tmp[i] = A[i * N + j] * x[j] + tmp[i];
-      y[i] = B[i * N + j] * x[j] + y[i];
+      t = A[i * N + j] * x[j] + t;
+      acc = B[i * N + j] * x[j] + acc;
     }
 
-    y[i] = ALPHA * tmp[i] + BETA * y[i];
+    tmp[i] = t;
+    y[i] = ALPHA * t + BETA * acc;
   }
 }
 
 void gesummv_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *x, DATA_TYPE *y,
                  DATA_TYPE *tmp) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:N*N], B[:N*N], x[:N], tmp[:N], y[:N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (2 * N * N + 3 * N) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target map(to : A[ : N *N], B[ : N *N], x[ : N], tmp[ : N]) map(tofrom : y[ : N]) device(OMP_DEVICE_ID)
   #pragma omp teams distribute parallel for
   for (int i = 0; i < N; i++) {
-    tmp[i] = 0;
-    y[i] = 0;
+    ACC_TYPE t = 0, acc = 0;
     for (int j = 0; j < N; j++) {
-      tmp[i] = A[i * N + j] * x[j] + tmp[i];
-      y[i] = B[i * N + j] * x[j] + y[i];
+      t = A[i * N + j] * x[j] + t;
+      acc = B[i * N + j] * x[j] + acc;
     }
 
-    y[i] = ALPHA * tmp[i] + BETA * y[i];
+    tmp[i] = t;
+    y[i] = ALPHA * t + BETA * acc;
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: y[:N]) map(release: A[:N*N], B[:N*N], x[:N], tmp[:N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, N * sizeof(DATA_TYPE));
 }
 
 void init(DATA_TYPE *A, DATA_TYPE *x) {
@@ -72,7 +89,7 @@ void init(DATA_TYPE *A, DATA_TYPE *x) {
     x[i] = ((DATA_TYPE)i) / N;
 
     for (j = 0; j < N; j++) {
-      A[i * N + j] = ((DATA_TYPE)i * j) / N;
+      A[i * N + j] = BENCH_INPUT(((ACC_TYPE)i * j) / N, (ACC_TYPE)N * N);
     }
   }
 }
@@ -90,14 +107,26 @@ int compareResults(DATA_TYPE *y, DATA_TYPE *y_outputFromGpu) {
   return fail;
 }
 
+#ifdef SIMD
+void gesummv_simd(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *x, DATA_TYPE *y,
+                  DATA_TYPE *tmp) {
+  #pragma omp parallel for
+  for (int i = 0; i < N; i++) {
+    tmp[i] = bench_simd.dot(&A[i * N], x, N);
+    y[i] = ALPHA * tmp[i] + BETA * bench_simd.dot(&B[i * N], x, N);
+  }
+}
+#endif
+
 int main(int argc, char *argv[]) {
   SALUTE("Scalar, Vector and Matrix Multiplication");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory for common arrays
-  DATA_TYPE *A = (DATA_TYPE *)malloc(N * N * sizeof(DATA_TYPE));
-  DATA_TYPE *B = (DATA_TYPE *)malloc(N * N * sizeof(DATA_TYPE));
-  DATA_TYPE *x = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
-  DATA_TYPE *tmp = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(N * N * sizeof(DATA_TYPE));
+  DATA_TYPE *B = (DATA_TYPE *)bench_malloc(N * N * sizeof(DATA_TYPE));
+  DATA_TYPE *x = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *tmp = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
   DATA_TYPE *y = NULL;
   DATA_TYPE *y_OMP = NULL;
   
@@ -106,15 +135,19 @@ int main(int argc, char *argv[]) {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  y_OMP = (DATA_TYPE *)calloc(N, sizeof(DATA_TYPE));
+  y_OMP = (DATA_TYPE *)bench_calloc(N, sizeof(DATA_TYPE));
+#ifdef SIMD
+  BENCHMARK_SIMD(gesummv_simd(A, B, x, y_OMP, tmp));
+#else
   BENCHMARK_OMP(gesummv_OMP(A, B, x, y_OMP, tmp));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(y_OMP, N);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  y = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
+  y = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
   BENCHMARK_CPU(gesummv(A, B, x, y, tmp));
   // prevent dead-code elimination
   DCE_PREVENT(y, N);
@@ -128,12 +161,12 @@ int main(int argc, char *argv[]) {
 #endif
 
   // release memory
-  free(A);
-  free(B);
-  free(x);
-  free(tmp);
-  free(y);
-  free(y_OMP);
-
-  return fail;
+  bench_free(A);
+  bench_free(B);
+  bench_free(x);
+  bench_free(tmp);
+  bench_free(y);
+  bench_free(y_OMP);
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
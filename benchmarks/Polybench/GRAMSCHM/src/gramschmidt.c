@@ -22,17 +22,29 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
 /* Problem size */
-#define M SIZE
-#define N SIZE
+#define M BENCH_DIM(M)
+#define N BENCH_DIM(N)
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksGemm.h"
+
+/** Columns orthogonalized together by the BLOCKED variant */
+#ifndef GS_PANEL
+#define GS_PANEL 32
+#endif
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (3.0 * M * N + 2.0 * M * N * (N - 1))
+#define KERNEL_BYTES ((3.0 * M + N) * N * sizeof(DATA_TYPE))
 
 void gramschmidt(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
   int i, j, k;
-  DATA_TYPE nrm;
+  ACC_TYPE nrm;
   for (k = 0; k < N; k++) {
     nrm = 0;
     for (i = 0; i < M; i++) {
@@ -45,10 +57,11 @@ void gramschmidt(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
     }
 
     for (j = k + 1; j < N; j++) {
-      R[k * N + j] = 0;
+      ACC_TYPE acc = 0;
       for (i = 0; i < M; i++) {
-        R[k * N + j] += Q[i * N + k] * A[i * N + j];
+        acc += Q[i * N + k] * A[i * N + j];
       }
+      R[k * N + j] = acc;
       for (i = 0; i < M; i++) {
         A[i * N + j] = A[i * N + j] - Q[i * N + k] * R[k * N + j];
       }
@@ -58,43 +71,189 @@ void gramschmidt(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
 
 void gramschmidt_OMP(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
   int i, j, k;
-  DATA_TYPE nrm;
-
-  #pragma omp target data map(to: R[:M*N], Q[:M*N]) map(tofrom: A[:M*N]) device(OMP_DEVICE_ID)
-  {
-    for (k = 0; k < N; k++) {
-      // CPU
-      nrm = 0;
-      #pragma omp target update from(A[:M*N])
+  ACC_TYPE nrm;
+
+  bench_phase_start();
+  #pragma omp target enter data map(to: R[:N*N], Q[:M*N], A[:M*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (2 * M + N) * N * sizeof(DATA_TYPE));
+
+  for (k = 0; k < N; k++) {
+    bench_phase_start();
+    #pragma omp target update from(A[:M*N])
+    bench_phase_stop(BENCH_PHASE_D2H, M * N * sizeof(DATA_TYPE));
+
+    // CPU
+    bench_phase_start();
+    nrm = 0;
+    for (i = 0; i < M; i++) {
+      nrm += A[i * N + k] * A[i * N + k];
+    }
+    R[k * N + k] = sqrt(nrm);
+
+    for (i = 0; i < M; i++) {
+      Q[i * N + k] = A[i * N + k] / R[k * N + k];
+    }
+    bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+    bench_phase_start();
+    #pragma omp target update to(Q[:M*N])
+    bench_phase_stop(BENCH_PHASE_H2D, M * N * sizeof(DATA_TYPE));
+
+    bench_phase_start();
+    #pragma omp target teams distribute parallel for private(i)
+    for (j = k + 1; j < N; j++) {
+      ACC_TYPE acc = 0;
       for (i = 0; i < M; i++) {
-        nrm += A[i * N + k] * A[i * N + k];
+        acc += Q[i * N + k] * A[i * N + j];
       }
-      R[k * N + k] = sqrt(nrm);
-      
+      R[k * N + j] = acc;
       for (i = 0; i < M; i++) {
-        Q[i * N + k] = A[i * N + k] / R[k * N + k];
+        A[i * N + j] = A[i * N + j] - Q[i * N + k] * R[k * N + j];
+      }
+    }
+    bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+  }
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: A[:M*N]) map(release: R[:N*N], Q[:M*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, M * N * sizeof(DATA_TYPE));
+}
+
+#ifdef RESIDENT
+/**
+ * @brief Keeps A, Q and R on the device for the whole factorization. The norm
+ * and the normalization of each column run there as well, so only the norm
+ * crosses the host/device boundary per column
+ */
+void gramschmidt_resident(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
+  bench_phase_start();
+  #pragma omp target enter data map(to: R[:N*N], Q[:M*N], A[:M*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (2 * M + N) * N * sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  for (int k = 0; k < N; k++) {
+    ACC_TYPE nrm = 0;
+    #pragma omp target teams distribute parallel for reduction(+ : nrm) map(tofrom : nrm) device(OMP_DEVICE_ID)
+    for (int i = 0; i < M; i++) {
+      nrm += A[i * N + k] * A[i * N + k];
+    }
+    DATA_TYPE r_kk = sqrt(nrm);
+
+    #pragma omp target teams distribute parallel for firstprivate(r_kk) device(OMP_DEVICE_ID)
+    for (int i = 0; i < M; i++) {
+      Q[i * N + k] = A[i * N + k] / r_kk;
+      if (i == 0) {
+        R[k * N + k] = r_kk;
+      }
+    }
+
+    #pragma omp target teams distribute parallel for device(OMP_DEVICE_ID)
+    for (int j = k + 1; j < N; j++) {
+      ACC_TYPE acc = 0;
+      for (int i = 0; i < M; i++) {
+        acc += Q[i * N + k] * A[i * N + j];
+      }
+      R[k * N + j] = acc;
+      for (int i = 0; i < M; i++) {
+        A[i * N + j] = A[i * N + j] - Q[i * N + k] * R[k * N + j];
+      }
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: A[:M*N]) map(release: R[:N*N], Q[:M*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, M * N * sizeof(DATA_TYPE));
+}
+#endif
+
+#ifdef BLOCKED
+/**
+ * @brief Classical Gram-Schmidt with reorthogonalization (CGS2), by panels of
+ * GS_PANEL columns
+ *
+ * Each panel is first projected out of the previous columns of Q with two
+ * matrix multiplies, twice, then its own columns are orthogonalized one at a
+ * time, again with two classical projections each. A is left with the
+ * residuals before normalization, like the modified Gram-Schmidt reference.
+ */
+void gramschmidt_blocked(DATA_TYPE *A, DATA_TYPE *R, DATA_TYPE *Q) {
+  DATA_TYPE *S = (DATA_TYPE *)malloc(N * GS_PANEL * sizeof(DATA_TYPE));
+  ACC_TYPE s[GS_PANEL];
+
+  for (int k0 = 0; k0 < N; k0 += GS_PANEL) {
+    int nb = BENCH_GEMM_MIN(GS_PANEL, N - k0);
+
+    for (int pass = 0; k0 > 0 && pass < 2; pass++) {
+      // S = Q[:, :k0]^T A[:, k0:k0+nb], then A[:, k0:k0+nb] -= Q[:, :k0] S
+      bench_gemm(1, 0, k0, nb, M, 1, Q, N, A + k0, N, 0, S, GS_PANEL);
+      bench_gemm(0, 0, M, nb, k0, -1, Q, N, S, GS_PANEL, 1, A + k0, N);
+      for (int j = 0; j < k0; j++) {
+        for (int c = 0; c < nb; c++) {
+          DATA_TYPE r = pass ? R[j * N + k0 + c] : 0;
+          R[j * N + k0 + c] = r + S[j * GS_PANEL + c];
+        }
       }
-      #pragma omp target update to(Q[:M*N])
-      #pragma omp target teams distribute parallel for private(i)
-      for (j = k + 1; j < N; j++) {
-        R[k * N + j] = 0;
-        for (i = 0; i < M; i++) {
-          R[k * N + j] += Q[i * N + k] * A[i * N + j];
+    }
+
+    for (int k = k0; k < k0 + nb; k++) {
+      int nk = k - k0;
+
+      for (int pass = 0; nk > 0 && pass < 2; pass++) {
+        for (int c = 0; c < nk; c++) {
+          s[c] = 0;
         }
-        for (i = 0; i < M; i++) {
-          A[i * N + j] = A[i * N + j] - Q[i * N + k] * R[k * N + j];
+
+        #pragma omp parallel for reduction(+ : s[:nk])
+        for (int i = 0; i < M; i++) {
+          for (int c = 0; c < nk; c++) {
+            s[c] += Q[i * N + k0 + c] * A[i * N + k];
+          }
         }
+
+        #pragma omp parallel for
+        for (int i = 0; i < M; i++) {
+          ACC_TYPE v = 0;
+          for (int c = 0; c < nk; c++) {
+            v += Q[i * N + k0 + c] * s[c];
+          }
+          A[i * N + k] -= v;
+        }
+
+        for (int c = 0; c < nk; c++) {
+          R[(k0 + c) * N + k] = (pass ? R[(k0 + c) * N + k] : 0) + s[c];
+        }
+      }
+
+      ACC_TYPE nrm = 0;
+      #pragma omp parallel for reduction(+ : nrm)
+      for (int i = 0; i < M; i++) {
+        nrm += A[i * N + k] * A[i * N + k];
+      }
+      R[k * N + k] = sqrt(nrm);
+
+      #pragma omp parallel for
+      for (int i = 0; i < M; i++) {
+        Q[i * N + k] = A[i * N + k] / R[k * N + k];
       }
     }
   }
+
+  free(S);
 }
+#endif
 
+/**
+ * A full rank input, a periodic pattern plus the identity. A rank-one input
+ * leaves every column after the first with a residual made of rounding
+ * noise, which only a bit-identical implementation could reproduce
+ */
 void init_array(DATA_TYPE *A) {
   int i, j;
 
   for (i = 0; i < M; i++) {
     for (j = 0; j < N; j++) {
-      A[i * N + j] = ((DATA_TYPE)(i + 1) * (j + 1)) / (M + 1);
+      A[i * N + j] = ((DATA_TYPE)((i * 7 + j * 13) % 101)) / 101 + (i == j);
     }
   }
 }
@@ -116,28 +275,35 @@ int compareResults(DATA_TYPE *A, DATA_TYPE *A_outputFromGpu) {
 
 int main(int argc, char *argv[]) {
   SALUTE("Gram-Schmidt decomposition");
+  // beyond M columns the residuals are rounding noise as well
+  bench_dims_require(N <= M, "N <= M");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory
   DATA_TYPE *A = NULL;
   DATA_TYPE *A_OMP = NULL;
-  DATA_TYPE *R = (DATA_TYPE *)malloc(M * N * sizeof(DATA_TYPE));
-  DATA_TYPE *Q = (DATA_TYPE *)malloc(M * N * sizeof(DATA_TYPE));
+  DATA_TYPE *R = (DATA_TYPE *)bench_malloc(N * N * sizeof(DATA_TYPE));
+  DATA_TYPE *Q = (DATA_TYPE *)bench_malloc(M * N * sizeof(DATA_TYPE));
 
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  A_OMP = (DATA_TYPE *) malloc(M * N * sizeof(DATA_TYPE));
-  init_array(A_OMP);
-  BENCHMARK_OMP(gramschmidt_OMP(A_OMP, R, Q));
+  A_OMP = (DATA_TYPE *) bench_malloc(M * N * sizeof(DATA_TYPE));
+#if defined(BLOCKED)
+  BENCHMARK_OMP_SETUP(init_array(A_OMP), gramschmidt_blocked(A_OMP, R, Q));
+#elif defined(RESIDENT)
+  BENCHMARK_OMP_SETUP(init_array(A_OMP), gramschmidt_resident(A_OMP, R, Q));
+#else
+  BENCHMARK_OMP_SETUP(init_array(A_OMP), gramschmidt_OMP(A_OMP, R, Q));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(A_OMP, M*N);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  A = (DATA_TYPE *) malloc(M * N * sizeof(DATA_TYPE));
-  init_array(A);
-  BENCHMARK_CPU(gramschmidt(A, R, Q));
+  A = (DATA_TYPE *) bench_malloc(M * N * sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_array(A), gramschmidt(A, R, Q));
   // prevent dead-code elimination
   DCE_PREVENT(A, M*N);
 #endif
@@ -150,10 +316,10 @@ int main(int argc, char *argv[]) {
 #endif
 
   // release memory
-  free(A);
-  free(A_OMP);
-  free(R);
-  free(Q);
+  bench_free(A);
+  bench_free(A_OMP);
+  bench_free(R);
+  bench_free(Q);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
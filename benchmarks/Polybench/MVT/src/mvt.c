@@ -21,11 +21,18 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define N SIZE
+#define N BENCH_DIM(N)
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksSimd.h"
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (4.0 * N * N)
+#define KERNEL_BYTES (((double)N * N + 4 * N) * sizeof(DATA_TYPE))
 
 void init_common_arrays(DATA_TYPE *A, DATA_TYPE *y1, DATA_TYPE *y2) {
   int i, j;
@@ -34,7 +41,7 @@ void init_common_arrays(DATA_TYPE *A, DATA_TYPE *y1, DATA_TYPE *y2) {
     y1[i] = ((DATA_TYPE)i + 3) / N;
     y2[i] = ((DATA_TYPE)i + 4) / N;
     for (j = 0; j < N; j++) {
-      A[i * N + j] = ((DATA_TYPE)i * j) / N;
+      A[i * N + j] = BENCH_INPUT(((ACC_TYPE)i * j) / N, (ACC_TYPE)N * N);
     }
   }
 }
@@ -53,37 +60,55 @@ void runMvt(DATA_TYPE *a, DATA_TYPE *x1, DATA_TYPE *x2, DATA_TYPE *y1,
   int i, j;
 
   for (i = 0; i < N; i++) {
+    ACC_TYPE acc = x1[i];
     for (j = 0; j < N; j++) {
-      x1[i] = x1[i] + a[i * N + j] * y1[j];
+      acc = acc + a[i * N + j] * y1[j];
     }
+    x1[i] = acc;
   }
 
   for (i = 0; i < N; i++) {
+    ACC_TYPE acc = x2[i];
     for (j = 0; j < N; j++) {
-      x2[i] = x2[i] + a[j * N + i] * y2[j];
+      acc = acc + a[j * N + i] * y2[j];
     }
+    x2[i] = acc;
   }
 }
 
 void runMvt_OMP(DATA_TYPE *a, DATA_TYPE *x1, DATA_TYPE *x2, DATA_TYPE *y1,
                 DATA_TYPE *y2) {
   int i, j;
+  bench_phase_start();
+  #pragma omp target enter data map(to: a[:N*N], y1[:N], y2[:N], x1[:N], x2[:N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (N * N + 4 * N) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target teams map(to: a[:N*N], y1[:N], y2[:N]) map(tofrom: x1[:N], x2[:N]) device(OMP_DEVICE_ID)                                                    
   {
     #pragma omp distribute parallel for private(j)
     for (i = 0; i < N; i++) {
+      ACC_TYPE acc = x1[i];
       for (j = 0; j < N; j++) {
-        x1[i] = x1[i] + a[i * N + j] * y1[j];
+        acc = acc + a[i * N + j] * y1[j];
       }
+      x1[i] = acc;
     }
 
     #pragma omp distribute parallel for private(j)
     for (i = 0; i < N; i++) {
+      ACC_TYPE acc = x2[i];
       for (j = 0; j < N; j++) {
-        x2[i] = x2[i] + a[j * N + i] * y2[j];
+        acc = acc + a[j * N + i] * y2[j];
       }
+      x2[i] = acc;
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: x1[:N], x2[:N]) map(release: a[:N*N], y1[:N], y2[:N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, 2 * N * sizeof(DATA_TYPE));
 }
 
 int compareResults(DATA_TYPE *x1, DATA_TYPE *x1_outputFromGpu, DATA_TYPE *x2,
@@ -106,27 +131,56 @@ int compareResults(DATA_TYPE *x1, DATA_TYPE *x1_outputFromGpu, DATA_TYPE *x2,
   return fail;
 }
 
+#ifdef SIMD
+void runMvt_simd(DATA_TYPE *a, DATA_TYPE *x1, DATA_TYPE *x2, DATA_TYPE *y1,
+                 DATA_TYPE *y2) {
+  #pragma omp parallel
+  {
+    #pragma omp for
+    for (int i = 0; i < N; i++) {
+      x1[i] += bench_simd.dot(&a[i * N], y1, N);
+    }
+
+    // x2 += A^T y2 as axpy updates along the rows of A, each thread owning
+    // slices of x2
+    #pragma omp for
+    for (int i = 0; i < N; i += BENCH_SIMD_SLICE) {
+      int n = BENCH_SIMD_MIN(BENCH_SIMD_SLICE, N - i);
+      for (int j = 0; j < N; j++) {
+        bench_simd.axpy(&x2[i], y2[j], &a[j * N + i], n);
+      }
+    }
+  }
+}
+#endif
+
 int main() {
   SALUTE("Matrix Vector Product and Transpose");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // Declare arrays and allocate memory for common arrays
-  DATA_TYPE *a = (DATA_TYPE *)malloc(N * N * sizeof(DATA_TYPE));
+  DATA_TYPE *a = (DATA_TYPE *)bench_malloc(N * N * sizeof(DATA_TYPE));
   DATA_TYPE *x1 = NULL;
   DATA_TYPE *x2 = NULL;
   DATA_TYPE *x1_OMP = NULL;
   DATA_TYPE *x2_OMP = NULL;
-  DATA_TYPE *y_1 = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
-  DATA_TYPE *y_2 = (DATA_TYPE *)malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *y_1 = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *y_2 = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
 
   // Initialize common memory
   init_common_arrays(a, y_1, y_2);
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  x1_OMP = (DATA_TYPE *) malloc(N * sizeof(DATA_TYPE));
-  x2_OMP = (DATA_TYPE *) malloc(N * sizeof(DATA_TYPE));
-  init_vector_x(x1_OMP, x2_OMP);
-  BENCHMARK_OMP(runMvt_OMP(a, x1_OMP, x2_OMP, y_1, y_2));
+  x1_OMP = (DATA_TYPE *) bench_malloc(N * sizeof(DATA_TYPE));
+  x2_OMP = (DATA_TYPE *) bench_malloc(N * sizeof(DATA_TYPE));
+#ifdef SIMD
+  BENCHMARK_SIMD_SETUP(init_vector_x(x1_OMP, x2_OMP),
+                       runMvt_simd(a, x1_OMP, x2_OMP, y_1, y_2));
+#else
+  BENCHMARK_OMP_SETUP(init_vector_x(x1_OMP, x2_OMP),
+                      runMvt_OMP(a, x1_OMP, x2_OMP, y_1, y_2));
+#endif
   // prevent dead-code elimination
   DCE_PREVENT(x1_OMP, N);
   DCE_PREVENT(x2_OMP, N);
@@ -134,10 +188,9 @@ int main() {
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  x1 = (DATA_TYPE *) malloc(N * sizeof(DATA_TYPE));
-  x2 = (DATA_TYPE *) malloc(N * sizeof(DATA_TYPE));
-  init_vector_x(x1, x2);
-  BENCHMARK_CPU(runMvt(a, x1, x2, y_1, y_2));
+  x1 = (DATA_TYPE *) bench_malloc(N * sizeof(DATA_TYPE));
+  x2 = (DATA_TYPE *) bench_malloc(N * sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_vector_x(x1, x2), runMvt(a, x1, x2, y_1, y_2));
   // prevent dead-code elimination
   DCE_PREVENT(x1, N);
   DCE_PREVENT(x2, N);
@@ -151,13 +204,13 @@ int main() {
 #endif
 
   // Release memory
-  free(a);
-  free(x1);
-  free(x2);
-  free(x1_OMP);
-  free(x2_OMP);
-  free(y_1);
-  free(y_2);
-
-  return fail;
+  bench_free(a);
+  bench_free(x1);
+  bench_free(x2);
+  bench_free(x1_OMP);
+  bench_free(x2_OMP);
+  bench_free(y_1);
+  bench_free(y_2);
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
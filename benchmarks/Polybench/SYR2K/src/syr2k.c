@@ -20,25 +20,33 @@
 #endif
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 
-#define N SIZE
-#define M SIZE
+#define N BENCH_DIM(N)
+#define M BENCH_DIM(M)
 
 /* Declared constant values for ALPHA and BETA (same as values in PolyBench 2.0)
  */
 #define ALPHA 12435
 #define BETA 4546
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksGemm.h"
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS (6.0 * N * N * M + (double)N * N)
+#define KERNEL_BYTES ((2.0 * N * M + 2.0 * N * N) * sizeof(DATA_TYPE))
 
 void init_arrays(DATA_TYPE *A, DATA_TYPE *B) {
   int i, j;
 
   for (i = 0; i < N; i++) {
     for (j = 0; j < M; j++) {
-      A[i * N + j] = ((DATA_TYPE)i * j) / N;
-      B[i * N + j] = ((DATA_TYPE)i * j + 1) / N;
+      // each of A.B^T and B.A^T sums M products of the two
+      A[i * M + j] = BENCH_INPUT(((ACC_TYPE)i * j) / N, M * sqrtf(M));
+      B[i * M + j] = BENCH_INPUT(((ACC_TYPE)i * j + 1) / N, M * sqrtf(M));
     }
   }
 }
@@ -48,7 +56,7 @@ void init_C_array(DATA_TYPE *C) {
 
   for (i = 0; i < N; i++) {
     for (j = 0; j < N; j++) {
-      C[i * N + j] = ((DATA_TYPE)i * j + 2) / N;
+      C[i * N + j] = BENCH_INPUT(((ACC_TYPE)i * j + 2) / N, N);
     }
   }
 }
@@ -64,10 +72,12 @@ void syr2k(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
 
   for (i = 0; i < N; i++) {
     for (j = 0; j < N; j++) {
+      ACC_TYPE acc = C[i * N + j];
       for (k = 0; k < M; k++) {
-        C[i * N + j] += ALPHA * A[i * M + k] * B[j * M + k];
-        C[i * N + j] += ALPHA * B[i * M + k] * A[j * M + k];
+        acc += ALPHA * A[i * M + k] * B[j * M + k];
+        acc += ALPHA * B[i * M + k] * A[j * M + k];
       }
+      C[i * N + j] = acc;
     }
   }
 }
@@ -79,16 +89,28 @@ void syr2k_OMP(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
     }
   }
 
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:N*M], B[:N*M], C[:N*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (2 * N * M + N * N) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
   #pragma omp target teams map(to : A[ : N *M], B[ : N *M]) map(tofrom : C[ : N *N]) device(OMP_DEVICE_ID)
   #pragma omp distribute parallel for collapse(2)
   for (int i = 0; i < N; i++) {
     for (int j = 0; j < N; j++) {
+      ACC_TYPE acc = C[i * N + j];
       for (int k = 0; k < M; k++) {
-        C[i * N + j] += ALPHA * A[i * M + k] * B[j * M + k];
-        C[i * N + j] += ALPHA * B[i * M + k] * A[j * M + k];
+        acc += ALPHA * A[i * M + k] * B[j * M + k];
+        acc += ALPHA * B[i * M + k] * A[j * M + k];
       }
+      C[i * N + j] = acc;
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: C[:N*N]) map(release: A[:N*M], B[:N*M]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, N * N * sizeof(DATA_TYPE));
 }
 
 int compareResults(DATA_TYPE *C, DATA_TYPE *C_OMP) {
@@ -106,12 +128,22 @@ int compareResults(DATA_TYPE *C, DATA_TYPE *C_OMP) {
   return fail;
 }
 
+/**
+ * @brief Cache-blocked and register-tiled version of syr2k_OMP, for the CPU.
+ * C = ALPHA.A.B^T + ALPHA.B.A^T + BETA.C, as two rank-k updates
+ */
+void syr2k_blocked(DATA_TYPE *A, DATA_TYPE *B, DATA_TYPE *C) {
+  bench_gemm(0, 1, N, N, M, ALPHA, A, M, B, M, BETA, C, N);
+  bench_gemm(0, 1, N, N, M, ALPHA, B, M, A, M, 1, C, N);
+}
+
 int main() {
   SALUTE("Symmetric rank-2k operations");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
   
   // Declare arrays and allocate memory for common arrays
-  DATA_TYPE *A = (DATA_TYPE *)malloc(N * M * sizeof(DATA_TYPE));
-  DATA_TYPE *B = (DATA_TYPE *)malloc(N * M * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *)bench_malloc(N * M * sizeof(DATA_TYPE));
+  DATA_TYPE *B = (DATA_TYPE *)bench_malloc(N * M * sizeof(DATA_TYPE));
   DATA_TYPE *C = NULL;
   DATA_TYPE *C_OMP = NULL;
 
@@ -120,20 +152,22 @@ int main() {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  C_OMP = (DATA_TYPE *) calloc(N * M, sizeof(DATA_TYPE));
-  init_C_array(C_OMP);
-  BENCHMARK_OMP(syr2k_OMP(A, B, C_OMP));
+  C_OMP = (DATA_TYPE *) bench_calloc(N * N, sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP_SETUP(init_C_array(C_OMP), syr2k_blocked(A, B, C_OMP));
+#else
+  BENCHMARK_OMP_SETUP(init_C_array(C_OMP), syr2k_OMP(A, B, C_OMP));
+#endif
   // prevent dead-code elimination
-  DCE_PREVENT(C_OMP, N*M);
+  DCE_PREVENT(C_OMP, N*N);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  C = (DATA_TYPE *) calloc(N * M, sizeof(DATA_TYPE));
-  init_C_array(C);
-  BENCHMARK_CPU(syr2k(A, B, C));
+  C = (DATA_TYPE *) bench_calloc(N * N, sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_C_array(C), syr2k(A, B, C));
   // prevent dead-code elimination
-  DCE_PREVENT(C, N*M);
+  DCE_PREVENT(C, N*N);
 #endif
 
   // if TEST is enabled, then compare OMP results against sequential mode
@@ -143,10 +177,10 @@ int main() {
   printf("Errors on OMP (threshold %4.2lf): %d\n", ERROR_THRESHOLD, fail);
 #endif
 
-  free(A);
-  free(B);
-  free(C);
-  free(C_OMP);
+  bench_free(A);
+  bench_free(B);
+  bench_free(C);
+  bench_free(C_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
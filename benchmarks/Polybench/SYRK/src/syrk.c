@@ -10,6 +10,7 @@
 */
 
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
@@ -18,23 +19,30 @@
 #include <unistd.h>
 
 /* Problem size */
-#define N SIZE
-#define M SIZE
+#define N BENCH_DIM(N)
+#define M BENCH_DIM(M)
 
 /* Declared constant values for alpha and beta */
 /* (same as values in PolyBench 2.0) */
 #define alpha 12435
 #define beta 4546
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
+
+#include "BenchmarksGemm.h"
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of one run */
+#define KERNEL_FLOPS ((double)N * N * (3 * M + 1))
+#define KERNEL_BYTES ((N * M + 2.0 * N * N) * sizeof(DATA_TYPE))
 
 void init_array_A(DATA_TYPE *A) {
   int i, j;
 
   for (i = 0; i < N; i++) {
     for (j = 0; j < M; j++) {
-      A[i * M + j] = ((DATA_TYPE)i * j) / N;
+      // A.A^T sums M products of two elements
+      A[i * M + j] = BENCH_INPUT(((ACC_TYPE)i * j) / N, M * sqrtf(M));
     }
   }
 }
@@ -43,8 +51,8 @@ void init_array_C(DATA_TYPE *C) {
   int i, j;
 
   for (i = 0; i < N; i++) {
-    for (j = 0; j < M; j++) {
-      C[i * M + j] = ((DATA_TYPE)i * j + 2) / N;
+    for (j = 0; j < N; j++) {
+      C[i * N + j] = BENCH_INPUT(((ACC_TYPE)i * j + 2) / N, N);
     }
   }
 }
@@ -55,8 +63,8 @@ int compareResults(DATA_TYPE *C, DATA_TYPE *C_OMP) {
 
   // Compare C with D
   for (i = 0; i < N; i++) {
-    for (j = 0; j < M; j++) {
-      if (percentDiff(C[i * M + j], C_OMP[i * M + j]) > ERROR_THRESHOLD) {
+    for (j = 0; j < N; j++) {
+      if (percentDiff(C[i * N + j], C_OMP[i * N + j]) > ERROR_THRESHOLD) {
         fail++;
       }
     }
@@ -69,45 +77,68 @@ void syrk(DATA_TYPE *A, DATA_TYPE *C) {
   int i, j, k;
 
   for (i = 0; i < N; i++) {
-    for (j = 0; j < M; j++) {
-      C[i * M + j] *= beta;
+    for (j = 0; j < N; j++) {
+      C[i * N + j] *= beta;
     }
   }
 
   for (i = 0; i < N; i++) {
-    for (j = 0; j < M; j++) {
+    for (j = 0; j < N; j++) {
+      ACC_TYPE acc = C[i * N + j];
       for (k = 0; k < M; k++) {
-        C[i * N + j] += alpha * A[i * M + k] * A[j * M + k];
+        acc += alpha * A[i * M + k] * A[j * M + k];
       }
+      C[i * N + j] = acc;
     }
   }
 }
 
 void syrkOMP(DATA_TYPE *A, DATA_TYPE *C) {
-  #pragma omp target teams map(to : A[:N*M]) map(tofrom : C[:N*M]) device(OMP_DEVICE_ID)
+  bench_phase_start();
+  #pragma omp target enter data map(to: A[:N*M], C[:N*N]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (N * M + N * N) * sizeof(DATA_TYPE));
+
+  bench_phase_start();
+  #pragma omp target teams map(to : A[:N*M]) map(tofrom : C[:N*N]) device(OMP_DEVICE_ID)
   {
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < N; i++) {
-      for (int j = 0; j < M; j++) {
-        C[i * M + j] *= beta;
+      for (int j = 0; j < N; j++) {
+        C[i * N + j] *= beta;
       }
     }
     #pragma omp distribute parallel for collapse(2)
     for (int i = 0; i < N; i++) {
-      for (int j = 0; j < M; j++) {
+      for (int j = 0; j < N; j++) {
+        ACC_TYPE acc = C[i * N + j];
         for (int k = 0; k < M; k++) {
-          C[i * N + j] += alpha * A[i * M + k] * A[j * M + k];
+          acc += alpha * A[i * M + k] * A[j * M + k];
         }
+        C[i * N + j] = acc;
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: C[:N*N]) map(release: A[:N*M]) device(OMP_DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, N * N * sizeof(DATA_TYPE));
+}
+
+/**
+ * @brief Cache-blocked and register-tiled version of syrkOMP, for the CPU.
+ * C = alpha.A.A^T + beta.C, with A^T read in place by the packing
+ */
+void syrk_blocked(DATA_TYPE *A, DATA_TYPE *C) {
+  bench_gemm(0, 1, N, N, M, alpha, A, M, A, M, beta, C, N);
 }
 
 int main() {
   SALUTE("Symmetric rank-k operations");
+  bench_work(KERNEL_FLOPS, KERNEL_BYTES);
 
   // declare arrays and allocate memory for common arrays
-  DATA_TYPE *A = (DATA_TYPE *) malloc(N * M * sizeof(DATA_TYPE));
+  DATA_TYPE *A = (DATA_TYPE *) bench_malloc(N * M * sizeof(DATA_TYPE));
   DATA_TYPE *C = NULL;
   DATA_TYPE *C_OMP = NULL;
 
@@ -116,20 +147,22 @@ int main() {
 
 // run OMP on GPU or CPU if enabled
 #if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
-  C_OMP = (DATA_TYPE *) malloc(N * M * sizeof(DATA_TYPE));
-  init_array_C(C_OMP);
-  BENCHMARK_OMP(syrkOMP(A, C_OMP));
+  C_OMP = (DATA_TYPE *) bench_malloc(N * N * sizeof(DATA_TYPE));
+#ifdef BLOCKED
+  BENCHMARK_OMP_SETUP(init_array_C(C_OMP), syrk_blocked(A, C_OMP));
+#else
+  BENCHMARK_OMP_SETUP(init_array_C(C_OMP), syrkOMP(A, C_OMP));
+#endif
    // prevent dead-code elimination
-  DCE_PREVENT(C_OMP, N*M);
+  DCE_PREVENT(C_OMP, N*N);
 #endif
 
 // run sequential version if enabled
 #ifdef RUN_CPU_SEQ
-  C = (DATA_TYPE *) malloc(N * M * sizeof(DATA_TYPE));
-  init_array_C(C);
-  BENCHMARK_CPU(syrk(A, C));
+  C = (DATA_TYPE *) bench_malloc(N * N * sizeof(DATA_TYPE));
+  BENCHMARK_CPU_SETUP(init_array_C(C), syrk(A, C));
   // prevent dead-code elimination
-  DCE_PREVENT(C, N*M);
+  DCE_PREVENT(C, N*N);
 #endif
 
   int fail = 0;
@@ -140,9 +173,9 @@ int main() {
 #endif
 
   // release memory
-  free(A);
-  free(C);
-  free(C_OMP);
+  bench_free(A);
+  bench_free(C);
+  bench_free(C_OMP);
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -10,7 +10,11 @@
  *
  */
 
+// define the error threshold for the results "not matching"
+#define KERNEL_ERROR_THRESHOLD 0.05
+
 #include "BenchmarksUtil.h"
+#include "BenchmarksPrecision.h"
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
@@ -18,9 +22,6 @@
 #include <sys/time.h>
 #include <unistd.h>
 
-// define the error threshold for the results "not matching"
-#define ERROR_THRESHOLD 0.05
-
 /* Problem size. */
 #ifdef RUN_TEST
 #define SIZE 1100
@@ -39,8 +40,8 @@
 #define alpha 12435
 #define beta 4546
 
-/* Can switch DATA_TYPE between float and double */
-typedef float DATA_TYPE;
+/* Precision selected with PRECISION, see BenchmarksPrecision.h */
+typedef BENCH_REAL DATA_TYPE;
 
 DATA_TYPE A[N][M];
 DATA_TYPE C[N][M];
@@ -73,9 +74,11 @@ void syrk() {
 
   for (i = 0; i < N; i++) {
     for (j = 0; j < M; j++) {
+      ACC_TYPE acc = C[i][j];
       for (k = 0; k < M; k++) {
-        C[i][j] += alpha * A[i][k] * A[j][k];
+        acc += alpha * A[i][k] * A[j][k];
       }
+      C[i][j] = acc;
     }
   }
 }
@@ -111,15 +114,17 @@ void syrkGPU() {
 #pragma omp parallel for // collapse(2)
   for (i = 0; i < N; i++) {
     for (j = 0; j < M; j++) {
-      D[i][j] = Dinit[i][j] * beta;
+      ACC_TYPE acc = Dinit[i][j] * beta;
       for (k = 0; k < M; k++) {
-        D[i][j] += alpha * A[i][k] * A[j][k];
+        acc += alpha * A[i][k] * A[j][k];
       }
+      D[i][j] = acc;
     }
   }
 
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 }
 
 int main() {
@@ -136,8 +141,9 @@ int main() {
   syrk();
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
   fail = compareResults();
 #endif
 
-  return fail;
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
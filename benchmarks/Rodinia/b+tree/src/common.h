@@ -16,6 +16,7 @@
 #include <stdint.h>					// (in path known to compiler)			needed by uint32_t
 #include <stdbool.h>				// (in path known to compiler)			needed by true/false, bool
 #include <stdlib.h>					// (in path known to compiler)			needed by malloc
+#include "BenchmarksAlloc.h"
 
 //======================================================================================================================================================150
 //	DEFINE
@@ -33,10 +34,10 @@
 
 #define DEFAULT_ORDER 508
 
-#define malloc(size) ({                                                   \
+#define bench_malloc(size) ({                                             \
   void *_tmp;                                                             \
                                                                           \
-  if (!(_tmp = malloc(size))) {                                           \
+  if (!(_tmp = bench_malloc(size))) {                                     \
     fprintf(stderr, "Allocation failed at %s:%d!\n", __FILE__, __LINE__); \
     exit(-1);                                                             \
   }                                                                       \
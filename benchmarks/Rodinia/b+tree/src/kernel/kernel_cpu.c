@@ -27,6 +27,8 @@
 //======================================================================================================================================================150
 
 #include "../util/timer/timer.h" // (in directory provided here)
+#include "BenchmarksPhases.h"       // (in common directory)
+#include "BenchmarksAlloc.h"        // (in common directory)
 
 //========================================================================================================================================================================================================200
 //	KERNEL_CPU FUNCTION
@@ -67,10 +69,20 @@ void kernel_gpu(int cores_arg,
 
   int x = 100;
   int *A;
-  A = (int *)malloc(sizeof(int) * x);
+  A = (int *)bench_malloc(sizeof(int) * x);
 
 // process number of querries
 
+  bench_phase_start();
+#pragma omp target enter data map(                                             \
+    to : keys[ : count], knodes[ : knodes_elem], records[ : records_elem],     \
+    offset[ : count], ans[ : count], currKnode[ : count])
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   count * (sizeof(int) + 2 * sizeof(long) + sizeof(record)) +
+                       knodes_elem * sizeof(knode) +
+                       records_elem * sizeof(record));
+
+  bench_phase_start();
 #pragma omp target map(                                                        \
     to : keys[ : count],                                                       \
                knodes[ : knodes_elem], records[ : records_elem])               \
@@ -117,6 +129,15 @@ void kernel_gpu(int cores_arg,
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(                                              \
+    from : offset[ : count], ans[ : count], currKnode[ : count])               \
+    map(release : keys[ : count], knodes[ : knodes_elem],                      \
+        records[ : records_elem])
+  bench_phase_stop(BENCH_PHASE_D2H,
+                   count * (2 * sizeof(long) + sizeof(record)));
 }
 
 void kernel_cpu(int cores_arg,
@@ -154,7 +175,7 @@ void kernel_cpu(int cores_arg,
 
   int x = 100;
   int *A;
-  A = (int *)malloc(sizeof(int) * x);
+  A = (int *)bench_malloc(sizeof(int) * x);
 
   // process number of querries
 
@@ -270,7 +270,7 @@ void list_insert_item_sorted(list_t *l, list_item_t *i) {
 
 void list_insert_head(list_t *l, void *v) {
   list_item_t *i;
-  i = (list_item_t *)malloc(sizeof(*i));
+  i = (list_item_t *)bench_malloc(sizeof(*i));
   list_item_init(i, v);
   if (l->head) {
     i->next = l->head;
@@ -287,7 +287,7 @@ void list_insert_head(list_t *l, void *v) {
 void list_insert_tail(list_t *l, void *v) {
   list_item_t *i;
 
-  i = (list_item_t *)malloc(sizeof(*i));
+  i = (list_item_t *)bench_malloc(sizeof(*i));
   list_item_init(i, v);
   if (l->head) {
     l->tail->next = i;
@@ -304,7 +304,7 @@ void list_insert_tail(list_t *l, void *v) {
 void list_insert_before(list_t *l, list_item_t *next, void *v) {
   list_item_t *i;
 
-  i = (list_item_t *)malloc(sizeof(*i));
+  i = (list_item_t *)bench_malloc(sizeof(*i));
   list_item_init(i, v);
 
   /* Assume next is actually in the list! */
@@ -326,7 +326,7 @@ void list_insert_before(list_t *l, list_item_t *next, void *v) {
 void list_insert_after(list_t *l, list_item_t *pred, void *v) {
   list_item_t *i;
 
-  i = (list_item_t *)malloc(sizeof(*i));
+  i = (list_item_t *)bench_malloc(sizeof(*i));
   list_item_init(i, v);
 
   /* Assume pred is actually in the list! */
@@ -349,7 +349,7 @@ void list_insert_sorted(list_t *l, void *v) {
   list_item_t *itr;
   list_item_t *i;
 
-  i = (list_item_t *)malloc(sizeof(*i));
+  i = (list_item_t *)bench_malloc(sizeof(*i));
   list_item_init(i, v);
 
   if (l->head) {
@@ -449,7 +449,7 @@ void list_item_delete(list_item_t *li, void (*datum_delete)(void *datum)) {
     datum_delete(li->datum);
   }
 
-  free(li);
+  bench_free(li);
 }
 
 void *list_item_get_datum(list_item_t *li) { return li->datum; }
@@ -526,7 +526,7 @@ long transform_to_cuda(node *root, bool verbose) {
   gettimeofday(&one, NULL);
   long max_nodes = (long)(pow(order, log(size) / log(order / 2.0) - 1) + 1);
   malloc_size = size * sizeof(record) + max_nodes * sizeof(knode);
-  mem = (char *)malloc(malloc_size);
+  mem = (char *)bench_malloc(malloc_size);
   if (mem == NULL) {
     printf("Initial malloc error\n");
     exit(1);
@@ -632,7 +632,7 @@ list_t *findRange(node *root, int start, int end) {
   if (c == NULL)
     return NULL;
 
-  list_t *retList = (list_t *)malloc(sizeof(list_t));
+  list_t *retList = (list_t *)bench_malloc(sizeof(list_t));
   list_init(retList, NULL, NULL);
 
   int counter = 0;
@@ -881,7 +881,7 @@ int cut(int length) {
 
 /* Creates a new record to hold the value to which a key refers. */
 record *make_record(int value) {
-  record *new_record = (record *)malloc(sizeof(record));
+  record *new_record = (record *)bench_malloc(sizeof(record));
   if (new_record == NULL) {
     perror("Record creation.");
     exit(EXIT_FAILURE);
@@ -895,17 +895,17 @@ record *make_record(int value) {
  * an internal node. */
 node *make_node(void) {
   node *new_node;
-  new_node = (node *)malloc(sizeof(node));
+  new_node = (node *)bench_malloc(sizeof(node));
   if (new_node == NULL) {
     perror("Node creation.");
     exit(EXIT_FAILURE);
   }
-  new_node->keys = (int *)malloc((order - 1) * sizeof(int));
+  new_node->keys = (int *)bench_malloc((order - 1) * sizeof(int));
   if (new_node->keys == NULL) {
     perror("New node keys array.");
     exit(EXIT_FAILURE);
   }
-  new_node->pointers = (void **)malloc(order * sizeof(void *));
+  new_node->pointers = (void **)bench_malloc(order * sizeof(void *));
   if (new_node->pointers == NULL) {
     perror("New node pointers array.");
     exit(EXIT_FAILURE);
@@ -966,13 +966,13 @@ node *insert_into_leaf_after_splitting(node *root, node *leaf, int key,
 
   new_leaf = make_leaf();
 
-  temp_keys = (int *)malloc(order * sizeof(int));
+  temp_keys = (int *)bench_malloc(order * sizeof(int));
   if (temp_keys == NULL) {
     perror("Temporary keys array.");
     exit(EXIT_FAILURE);
   }
 
-  temp_pointers = (void **)malloc(order * sizeof(void *));
+  temp_pointers = (void **)bench_malloc(order * sizeof(void *));
   if (temp_pointers == NULL) {
     perror("Temporary pointers array.");
     exit(EXIT_FAILURE);
@@ -1008,8 +1008,8 @@ node *insert_into_leaf_after_splitting(node *root, node *leaf, int key,
     new_leaf->num_keys++;
   }
 
-  free(temp_pointers);
-  free(temp_keys);
+  bench_free(temp_pointers);
+  bench_free(temp_keys);
 
   new_leaf->pointers[order - 1] = leaf->pointers[order - 1];
   leaf->pointers[order - 1] = new_leaf;
@@ -1061,12 +1061,12 @@ node *insert_into_node_after_splitting(node *root, node *old_node,
 * the other half to the new.
 */
 
-  temp_pointers = (node **)malloc((order + 1) * sizeof(node *));
+  temp_pointers = (node **)bench_malloc((order + 1) * sizeof(node *));
   if (temp_pointers == NULL) {
     perror("Temporary pointers array for splitting nodes.");
     exit(EXIT_FAILURE);
   }
-  temp_keys = (int *)malloc(order * sizeof(int));
+  temp_keys = (int *)bench_malloc(order * sizeof(int));
   if (temp_keys == NULL) {
     perror("Temporary keys array for splitting nodes.");
     exit(EXIT_FAILURE);
@@ -1107,8 +1107,8 @@ node *insert_into_node_after_splitting(node *root, node *old_node,
     new_node->num_keys++;
   }
   new_node->pointers[j] = temp_pointers[i];
-  free(temp_pointers);
-  free(temp_keys);
+  bench_free(temp_pointers);
+  bench_free(temp_keys);
   new_node->parent = old_node->parent;
   for (i = 0; i <= new_node->num_keys; i++) {
     child = (node *)new_node->pointers[i];
@@ -1313,9 +1313,9 @@ node *adjust_root(node *root) {
   else
     new_root = NULL;
 
-  free(root->keys);
-  free(root->pointers);
-  free(root);
+  bench_free(root->keys);
+  bench_free(root->pointers);
+  bench_free(root);
 
   return new_root;
 }
@@ -1441,9 +1441,9 @@ node *coalesce_nodes(node *root, node *n, node *neighbor, int neighbor_index,
 
   if (!split) {
     root = delete_entry(root, n->parent, k_prime, n);
-    free(n->keys);
-    free(n->pointers);
-    free(n);
+    bench_free(n->keys);
+    bench_free(n->pointers);
+    bench_free(n);
   } else
     for (i = 0; i < n->parent->num_keys; i++)
       if (n->parent->pointers[i + 1] == n) {
@@ -1605,7 +1605,7 @@ node *deleteVal(node *root, int key) {
   key_record = find(root, key, false);
   key_leaf = find_leaf(root, key, false);
   if (key_record != NULL && key_leaf != NULL) {
-    free(key_record);
+    bench_free(key_record);
     root = delete_entry(root, key_leaf, key, key_record);
   }
   return root;
@@ -1616,13 +1616,13 @@ void destroy_tree_nodes(node *root) {
   int i;
   if (root->is_leaf)
     for (i = 0; i < root->num_keys; i++)
-      free(root->pointers[i]);
+      bench_free(root->pointers[i]);
   else
     for (i = 0; i < root->num_keys + 1; i++)
       destroy_tree_nodes((node *)root->pointers[i]);
-  free(root->pointers);
-  free(root->keys);
-  free(root);
+  bench_free(root->pointers);
+  bench_free(root->keys);
+  bench_free(root);
 }
 
 /*   */
@@ -1747,7 +1747,7 @@ int main(int argc, char **argv) {
   rewind(commandFile);
 
   // allocate memory to contain the whole file:
-  commandBuffer = (char *)malloc(sizeof(char) * lSize);
+  commandBuffer = (char *)bench_malloc(sizeof(char) * lSize);
   if (commandBuffer == NULL) {
     fputs("Command Buffer memory error", stderr);
     exit(2);
@@ -1987,29 +1987,29 @@ int main(int argc, char **argv) {
 
       // INPUT: currKnode CPU allocation
       long *currKnode_cpu;
-      currKnode_cpu = (long *)malloc(count * sizeof(long));
+      currKnode_cpu = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(currKnode_cpu, 0, count * sizeof(long));
 
       long *currKnode_gpu;
-      currKnode_gpu = (long *)malloc(count * sizeof(long));
+      currKnode_gpu = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset GPU initialization
       memset(currKnode_gpu, 0, count * sizeof(long));
 
       // INPUT: offset CPU allocation
       long *offset_cpu;
-      offset_cpu = (long *)malloc(count * sizeof(long));
+      offset_cpu = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(offset_cpu, 0, count * sizeof(long));
 
       long *offset_gpu;
-      offset_gpu = (long *)malloc(count * sizeof(long));
+      offset_gpu = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(offset_gpu, 0, count * sizeof(long));
 
       // INPUT: keys CPU allocation
       int *keys;
-      keys = (int *)malloc(count * sizeof(int));
+      keys = (int *)bench_malloc(count * sizeof(int));
       // INPUT: keys CPU initialization
       int i;
       for (i = 0; i < count; i++) {
@@ -2017,13 +2017,13 @@ int main(int argc, char **argv) {
       }
 
       // OUTPUT: ans CPU allocation
-      record *ans_cpu = (record *)malloc(sizeof(record) * count);
+      record *ans_cpu = (record *)bench_malloc(sizeof(record) * count);
       // OUTPUT: ans CPU initialization
       for (i = 0; i < count; i++) {
         ans_cpu[i].value = -1;
       }
 
-      record *ans_gpu = (record *)malloc(sizeof(record) * count);
+      record *ans_gpu = (record *)bench_malloc(sizeof(record) * count);
       // OUTPUT: ans CPU initialization
       for (i = 0; i < count; i++) {
         ans_gpu[i].value = -1;
@@ -2045,6 +2045,7 @@ int main(int argc, char **argv) {
                  currKnode_cpu, offset_cpu, keys, ans_cpu);
       t_end = rtclock();
       fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+      bench_result_emit_time(BENCH_KERNEL, "CPU", count, t_end - t_start);
 
       t_start = rtclock();
       kernel_gpu(cores_arg,
@@ -2056,6 +2057,7 @@ int main(int argc, char **argv) {
                  currKnode_gpu, offset_gpu, keys, ans_gpu);
       t_end = rtclock();
       fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+      bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, count, t_end - t_start);
 
       compareResults(offset_cpu, offset_gpu, currKnode_cpu, currKnode_gpu,
                      ans_cpu, ans_gpu, count);
@@ -2082,13 +2084,13 @@ int main(int argc, char **argv) {
       fclose(pFile);
 
       // free memory
-      free(currKnode_gpu);
-      free(currKnode_cpu);
-      free(offset_cpu);
-      free(offset_gpu);
-      free(keys);
-      free(ans_cpu);
-      free(ans_gpu);
+      bench_free(currKnode_gpu);
+      bench_free(currKnode_cpu);
+      bench_free(offset_cpu);
+      bench_free(offset_gpu);
+      bench_free(keys);
+      bench_free(ans_cpu);
+      bench_free(ans_gpu);
 
       // break out of case
       break;
@@ -2112,7 +2114,7 @@ int main(int argc, char **argv) {
       ansList = findRange(root, start, end);
       printf("%d records found\n", list_get_length(ansList));
       // list_iterator_t iter;
-      free(ansList);
+      bench_free(ansList);
       break;
     }
 
@@ -2150,33 +2152,33 @@ int main(int argc, char **argv) {
 
       // INPUT: currKnode CPU allocation
       long *currKnode;
-      currKnode = (long *)malloc(count * sizeof(long));
+      currKnode = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(currKnode, 0, count * sizeof(long));
 
       // INPUT: offset CPU allocation
       long *offset;
-      offset = (long *)malloc(count * sizeof(long));
+      offset = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(offset, 0, count * sizeof(long));
 
       // INPUT: lastKnode CPU allocation
       long *lastKnode;
-      lastKnode = (long *)malloc(count * sizeof(long));
+      lastKnode = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(lastKnode, 0, count * sizeof(long));
 
       // INPUT: offset_2 CPU allocation
       long *offset_2;
-      offset_2 = (long *)malloc(count * sizeof(long));
+      offset_2 = (long *)bench_malloc(count * sizeof(long));
       // INPUT: offset CPU initialization
       memset(offset_2, 0, count * sizeof(long));
 
       // INPUT: start, end CPU allocation
       int *start;
-      start = (int *)malloc(count * sizeof(int));
+      start = (int *)bench_malloc(count * sizeof(int));
       int *end;
-      end = (int *)malloc(count * sizeof(int));
+      end = (int *)bench_malloc(count * sizeof(int));
       // INPUT: start, end CPU initialization
       int i;
       for (i = 0; i < count; i++) {
@@ -2190,9 +2192,9 @@ int main(int argc, char **argv) {
 
       // INPUT: recstart, reclenght CPU allocation
       int *recstart;
-      recstart = (int *)malloc(count * sizeof(int));
+      recstart = (int *)bench_malloc(count * sizeof(int));
       int *reclength;
-      reclength = (int *)malloc(count * sizeof(int));
+      reclength = (int *)bench_malloc(count * sizeof(int));
       // OUTPUT: ans CPU initialization
       for (i = 0; i < count; i++) {
         recstart[i] = 0;
@@ -2231,14 +2233,14 @@ int main(int argc, char **argv) {
       fclose(pFile);
 
       // free memory
-      free(currKnode);
-      free(offset);
-      free(lastKnode);
-      free(offset_2);
-      free(start);
-      free(end);
-      free(recstart);
-      free(reclength);
+      bench_free(currKnode);
+      bench_free(offset);
+      bench_free(lastKnode);
+      bench_free(offset_2);
+      bench_free(start);
+      bench_free(end);
+      bench_free(recstart);
+      bench_free(reclength);
 
       // break out of case
       break;
@@ -2262,7 +2264,7 @@ int main(int argc, char **argv) {
   // free remaining memory and exit
   // ------------------------------------------------------------60
 
-  free(mem);
+  bench_free(mem);
   return EXIT_SUCCESS;
 }
 
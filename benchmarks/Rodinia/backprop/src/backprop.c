@@ -56,7 +56,7 @@ float *alloc_1d_dbl(n) int n;
 {
   float *new;
 
-  new = (float *)malloc((unsigned)(n * sizeof(float)));
+  new = (float *)bench_malloc((unsigned)(n * sizeof(float)));
   if (new == NULL) {
     printf("ALLOC_1D_DBL: Couldn't allocate array of floats\n");
     return (NULL);
@@ -71,7 +71,7 @@ float **alloc_2d_dbl(m, n) int m, n;
   int i;
   float **new;
 
-  new = (float **)malloc((unsigned)(m * sizeof(float *)));
+  new = (float **)bench_malloc((unsigned)(m * sizeof(float *)));
   if (new == NULL) {
     printf("ALLOC_2D_DBL: Couldn't allocate array of dbl ptrs\n");
     return (NULL);
@@ -125,7 +125,7 @@ BPNN *bpnn_internal_create(n_in, n_hidden, n_out) int n_in, n_hidden, n_out;
 {
   BPNN *newnet;
 
-  newnet = (BPNN *)malloc(sizeof(BPNN));
+  newnet = (BPNN *)bench_malloc(sizeof(BPNN));
   if (newnet == NULL) {
     printf("BPNN_CREATE: Couldn't allocate neural network\n");
     return (NULL);
@@ -158,29 +158,29 @@ void bpnn_free(net) BPNN *net;
   n1 = net->input_n;
   n2 = net->hidden_n;
 
-  free((char *)net->input_units);
-  free((char *)net->hidden_units);
-  free((char *)net->output_units);
+  bench_free((char *)net->input_units);
+  bench_free((char *)net->hidden_units);
+  bench_free((char *)net->output_units);
 
-  free((char *)net->hidden_delta);
-  free((char *)net->output_delta);
-  free((char *)net->target);
+  bench_free((char *)net->hidden_delta);
+  bench_free((char *)net->output_delta);
+  bench_free((char *)net->target);
 
   for (i = 0; i <= n1; i++) {
-    free((char *)net->input_weights[i]);
-    free((char *)net->input_prev_weights[i]);
+    bench_free((char *)net->input_weights[i]);
+    bench_free((char *)net->input_prev_weights[i]);
   }
-  free((char *)net->input_weights);
-  free((char *)net->input_prev_weights);
+  bench_free((char *)net->input_weights);
+  bench_free((char *)net->input_prev_weights);
 
   for (i = 0; i <= n2; i++) {
-    free((char *)net->hidden_weights[i]);
-    free((char *)net->hidden_prev_weights[i]);
+    bench_free((char *)net->hidden_weights[i]);
+    bench_free((char *)net->hidden_prev_weights[i]);
   }
-  free((char *)net->hidden_weights);
-  free((char *)net->hidden_prev_weights);
+  bench_free((char *)net->hidden_weights);
+  bench_free((char *)net->hidden_prev_weights);
 
-  free((char *)net);
+  bench_free((char *)net);
 }
 
 /*** Creates a new fully-connected network from scratch,
@@ -234,7 +234,7 @@ int n1, n2;
   double t_start, t_end;
   float sum;
   int j, k;
-  float *conn_gpu = (float *)malloc(sizeof(float) * ((n1 + 1) * (n2 + 1)));
+  float *conn_gpu = (float *)bench_malloc(sizeof(float) * ((n1 + 1) * (n2 + 1)));
 
   for (j = 1; j <= n2; j++) {
     for (k = 0; k <= n1; k++) {
@@ -242,12 +242,20 @@ int n1, n2;
     }
   }
 
-  float *l2_gpu = (float *)malloc(sizeof(float) * (n2 + 1));
+  float *l2_gpu = (float *)bench_malloc(sizeof(float) * (n2 + 1));
 
   /*** Set up thresholding unit ***/
   l1[0] = 1.0;
   fprintf(stdout, "Layer Forward\n");
   t_start = rtclock();
+  bench_phase_start();
+  #pragma omp target enter data                                                \
+      map(to : conn_gpu[ : (n1 + 1) * (n2 + 1)], l1[ : n1 + 1],                \
+               l2_gpu[ : n2 + 1])
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   ((n1 + 1) * (n2 + 1) + (n1 + 1) + (n2 + 1)) * sizeof(float));
+
+  bench_phase_start();
    #pragma omp target teams map(to : conn_gpu[ : (n1 + 1) * (n2 + 1)], l1[ : n1 + 1]) map(tofrom : l2_gpu[ : n2 + 1])
   {
     #pragma omp distribute parallel for private(k)
@@ -260,8 +268,15 @@ int n1, n2;
       l2_gpu[j] = (1.0 / (1.0 + exp(-sum)));
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from : l2_gpu[ : n2 + 1])                   \
+      map(release : conn_gpu[ : (n1 + 1) * (n2 + 1)], l1[ : n1 + 1])
+  bench_phase_stop(BENCH_PHASE_D2H, (n2 + 1) * sizeof(float));
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, n2, t_end - t_start);
 
   t_start = rtclock();
   for (j = 1; j <= n2; j++) {
@@ -273,6 +288,7 @@ int n1, n2;
   }
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", n2, t_end - t_start);
 
   compareResults(l2, l2_gpu, n2);
 
@@ -353,8 +369,8 @@ void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw) float *delta, *ly,
   // momentum = 0.3;
 
   // preparar dados
-  float *w_gpu = (float *)malloc(sizeof(float) * ((ndelta + 1) * (nly + 1)));
-  float *oldw_gpu = (float *)malloc(sizeof(float) * ((ndelta + 1) * (nly + 1)));
+  float *w_gpu = (float *)bench_malloc(sizeof(float) * ((ndelta + 1) * (nly + 1)));
+  float *oldw_gpu = (float *)bench_malloc(sizeof(float) * ((ndelta + 1) * (nly + 1)));
 
   for (j = 1; j <= ndelta; j++) {
     for (k = 0; k <= nly; k++) {
@@ -366,6 +382,14 @@ void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw) float *delta, *ly,
   int size = (ndelta + 1) * (nly + 1);
   fprintf(stdout, "Adjust Weights\n");
   t_start = rtclock();
+  bench_phase_start();
+#pragma omp target enter data                                                  \
+    map(to : ly[ : (nly + 1)], delta[ : (ndelta + 1)], oldw_gpu[ : size],      \
+             w_gpu[ : size])
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   ((nly + 1) + (ndelta + 1) + 2 * size) * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target teams map(to : ly[ : (nly + 1)], delta[ : (ndelta + 1)]) map(tofrom : oldw_gpu[ : size], w_gpu[ : size])
   {
 #pragma omp distribute parallel for private(k)
@@ -378,8 +402,15 @@ void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw) float *delta, *ly,
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : oldw_gpu[ : size], w_gpu[ : size])     \
+    map(release : ly[ : (nly + 1)], delta[ : (ndelta + 1)])
+  bench_phase_stop(BENCH_PHASE_D2H, 2 * size * sizeof(float));
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, ndelta, t_end - t_start);
 
   t_start = rtclock();
   for (j = 1; j <= ndelta; j++) {
@@ -391,6 +422,7 @@ void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw) float *delta, *ly,
   }
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", ndelta, t_end - t_start);
   compareResults2(w_gpu, w, oldw_gpu, oldw, ndelta, nly);
   printf("\n");
 }
@@ -474,7 +506,7 @@ char *filename;
 
   memcnt = 0;
   w = net->input_weights;
-  mem = (char *)malloc((unsigned)((n1 + 1) * (n2 + 1) * sizeof(float)));
+  mem = (char *)bench_malloc((unsigned)((n1 + 1) * (n2 + 1) * sizeof(float)));
   for (i = 0; i <= n1; i++) {
     for (j = 0; j <= n2; j++) {
       dvalue = w[i][j];
@@ -485,11 +517,11 @@ char *filename;
   // write(fd, mem, (n1+1) * (n2+1) * sizeof(float));
   fwrite(mem, (unsigned)(sizeof(float)),
          (unsigned)((n1 + 1) * (n2 + 1) * sizeof(float)), pFile);
-  free(mem);
+  bench_free(mem);
 
   memcnt = 0;
   w = net->hidden_weights;
-  mem = (char *)malloc((unsigned)((n2 + 1) * (n3 + 1) * sizeof(float)));
+  mem = (char *)bench_malloc((unsigned)((n2 + 1) * (n3 + 1) * sizeof(float)));
   for (i = 0; i <= n2; i++) {
     for (j = 0; j <= n3; j++) {
       dvalue = w[i][j];
@@ -500,7 +532,7 @@ char *filename;
   // write(fd, mem, (n2+1) * (n3+1) * sizeof(float));
   fwrite(mem, sizeof(float), (unsigned)((n2 + 1) * (n3 + 1) * sizeof(float)),
          pFile);
-  free(mem);
+  bench_free(mem);
 
   fclose(pFile);
   return;
@@ -527,7 +559,7 @@ BPNN *bpnn_read(filename) char *filename;
   printf("Reading input weights..."); // fflush(stdout);
 
   memcnt = 0;
-  mem = (char *)malloc((unsigned)((n1 + 1) * (n2 + 1) * sizeof(float)));
+  mem = (char *)bench_malloc((unsigned)((n1 + 1) * (n2 + 1) * sizeof(float)));
   read(fd, mem, (n1 + 1) * (n2 + 1) * sizeof(float));
   for (i = 0; i <= n1; i++) {
     for (j = 0; j <= n2; j++) {
@@ -535,12 +567,12 @@ BPNN *bpnn_read(filename) char *filename;
       memcnt += sizeof(float);
     }
   }
-  free(mem);
+  bench_free(mem);
 
   printf("Done\nReading hidden weights..."); // fflush(stdout);
 
   memcnt = 0;
-  mem = (char *)malloc((unsigned)((n2 + 1) * (n3 + 1) * sizeof(float)));
+  mem = (char *)bench_malloc((unsigned)((n2 + 1) * (n3 + 1) * sizeof(float)));
   read(fd, mem, (n2 + 1) * (n3 + 1) * sizeof(float));
   for (i = 0; i <= n2; i++) {
     for (j = 0; j <= n3; j++) {
@@ -548,7 +580,7 @@ BPNN *bpnn_read(filename) char *filename;
       memcnt += sizeof(float);
     }
   }
-  free(mem);
+  bench_free(mem);
   close(fd);
 
   printf("Done\n"); // fflush(stdout);
@@ -0,0 +1,337 @@
+/*
+ * csrgen.c
+ *
+ * Writes graphs in the binary CSR format of bfs_csr.h for BFS in Rodinia,
+ * either generated or converted from the text format of graphgen.
+ *
+ * Usage:
+ * csrgen [-w] [-s <seed>] [-e <edgefactor>] rmat <scale> <out.csr>
+ * csrgen [-w] [-s <seed>] [-e <edgefactor>] uniform <nodes> <out.csr>
+ * csrgen convert <in.txt> <out.csr>
+ *
+ * rmat      Kronecker graph of 2^scale nodes, drawn with the R-MAT
+ *           probabilities of Graph500 (0.57, 0.19, 0.19, 0.05) and with the
+ *           node numbers scrambled, so that the hubs are spread over the
+ *           graph. Its degrees follow a power law
+ * uniform   graph of <nodes> nodes whose edges join two nodes drawn uniformly
+ * convert   reads a text graph, and keeps its source and its weights
+ *
+ * Both generators draw edgefactor * nodes undirected edges (16 by default,
+ * as in Graph500), drop the loops and keep the duplicates. With -w every edge
+ * gets a weight between 1 and 10, as in graphgen. The source is a node with
+ * edges. Every edge is drawn from a hash of the seed and its number, so the
+ * edges are drawn twice, to count the degrees and then to place them, without
+ * holding an edge list. The file is written through a shared mapping, so the
+ * graph may be larger than memory, and for a given seed its contents do not
+ * depend on the number of threads.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bfs.h"
+#include "bfs_csr.h"
+
+#define DEFAULT_EDGEFACTOR 16
+#define MIN_WEIGHT 1
+#define MAX_WEIGHT 10
+
+typedef enum { GEN_RMAT, GEN_UNIFORM } gen_kind_t;
+
+typedef struct {
+  gen_kind_t kind;
+  int scale;      // rmat: log2 of the nodes
+  uint64_t n;     // nodes
+  uint64_t edges; // undirected edges drawn
+  uint64_t seed;
+} gen_t;
+
+/** splitmix64 finalizer, a bijective mix of the 64 bits */
+static inline uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/** Uniform double in [0, 1) from 53 bits of x */
+static inline double unit(uint64_t x) { return (x >> 11) * 0x1.0p-53; }
+
+/**
+ * @brief Bijective scrambling of the node numbers of an R-MAT graph, which
+ * would otherwise gather the hubs at the low numbers
+ */
+static inline uint64_t scramble(uint64_t v, const gen_t *g) {
+  uint64_t mask = (g->n - 1);
+  uint64_t half = g->scale / 2 + 1;
+  for (int r = 0; r < 2; r++) {
+    v = (v * ((mix64(g->seed + r) | 1) & mask)) & mask;
+    v ^= v >> half;
+  }
+  return v;
+}
+
+/**
+ * @brief Endpoints of edge e
+ */
+static inline void draw_edge(const gen_t *g, uint64_t e, uint64_t *u,
+                             uint64_t *v) {
+  uint64_t x = mix64(g->seed ^ mix64(e));
+
+  if (g->kind == GEN_UNIFORM) {
+    *u = (uint64_t)(unit(x) * g->n);
+    *v = (uint64_t)(unit(mix64(x)) * g->n);
+    return;
+  }
+
+  // one quadrant of the adjacency matrix per level
+  uint64_t a = 0, b = 0;
+  for (int l = 0; l < g->scale; l++) {
+    x = mix64(x);
+    double p = unit(x);
+    uint64_t row = p >= 0.57 + 0.19;
+    uint64_t col = (p >= 0.57 && p < 0.57 + 0.19) || p >= 0.57 + 0.19 + 0.19;
+    a = (a << 1) | row;
+    b = (b << 1) | col;
+  }
+  *u = scramble(a, g);
+  *v = scramble(b, g);
+}
+
+/**
+ * @brief Weight of the edge between u and v, the same in both directions
+ */
+static inline uint32_t edge_weight(uint64_t seed, uint64_t u, uint64_t v) {
+  uint64_t lo = u < v ? u : v, hi = u < v ? v : u;
+  uint64_t x = mix64(seed ^ mix64(lo ^ mix64(hi)));
+  return MIN_WEIGHT + (uint32_t)(x % (MAX_WEIGHT - MIN_WEIGHT + 1));
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Creates the file at path with the size given by the header, and
+ * maps it for writing
+ */
+static char *create_csr(const char *path, const bfs_csr_header_t *h) {
+  uint64_t size = bfs_csr_size(h);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, (off_t)size)) {
+    perror(path);
+    exit(1);
+  }
+  char *base =
+      (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror(path);
+    exit(1);
+  }
+  memcpy(base, h, sizeof(*h));
+  return base;
+}
+
+/**
+ * @brief Flushes and unmaps a file of create_csr
+ */
+static void close_csr(char *base, const char *path) {
+  const bfs_csr_header_t *h = (const bfs_csr_header_t *)base;
+  uint64_t size = bfs_csr_size(h);
+  printf("Wrote %llu nodes and %llu edges to \"%s\"\n",
+         (unsigned long long)h->n, (unsigned long long)h->m, path);
+  if (msync(base, size, MS_SYNC))
+    perror(path);
+  munmap(base, size);
+}
+
+/**
+ * @brief Generates the graph described by g into the file at path
+ */
+static void generate(const gen_t *g, int weighted, const char *path) {
+  uint64_t n = g->n;
+  uint64_t *cursor = (uint64_t *)calloc(n + 1, sizeof(uint64_t));
+  if (!cursor) {
+    fprintf(stderr, "Out of memory for %llu nodes\n", (unsigned long long)n);
+    exit(1);
+  }
+
+  // first draw, the degrees
+  #pragma omp parallel for schedule(static)
+  for (uint64_t e = 0; e < g->edges; e++) {
+    uint64_t u, v;
+    draw_edge(g, e, &u, &v);
+    if (u == v)
+      continue;
+    #pragma omp atomic
+    cursor[u]++;
+    #pragma omp atomic
+    cursor[v]++;
+  }
+
+  uint64_t m = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t d = cursor[i];
+    cursor[i] = m;
+    m += d;
+  }
+  cursor[n] = m;
+
+  // any node with edges as the source
+  uint64_t source = mix64(g->seed) % n;
+  for (uint64_t i = 0; i < n && cursor[source] == cursor[source + 1]; i++)
+    source = (source + 1) % n;
+
+  bfs_csr_header_t h;
+  bfs_csr_header_init(&h, n, m, source, weighted ? BFS_CSR_WEIGHTED : 0);
+  printf("Writing to file \"%s\"...\n", path);
+  char *base = create_csr(path, &h);
+  uint64_t *offsets = (uint64_t *)(base + bfs_csr_offsets_at(&h));
+  uint32_t *edges = (uint32_t *)(base + bfs_csr_edges_at(&h));
+  uint32_t *weights = (uint32_t *)(base + bfs_csr_weights_at(&h));
+  memcpy(offsets, cursor, (n + 1) * sizeof(uint64_t));
+
+  // second draw, the edges, in the order the threads claim their slots
+  #pragma omp parallel for schedule(static)
+  for (uint64_t e = 0; e < g->edges; e++) {
+    uint64_t u, v, pu, pv;
+    draw_edge(g, e, &u, &v);
+    if (u == v)
+      continue;
+    #pragma omp atomic capture
+    pu = cursor[u]++;
+    #pragma omp atomic capture
+    pv = cursor[v]++;
+    edges[pu] = (uint32_t)v;
+    edges[pv] = (uint32_t)u;
+  }
+  free(cursor);
+
+  // sorted lists make the file independent of that order
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (uint64_t u = 0; u < n; u++) {
+    uint64_t lo = offsets[u], hi = offsets[u + 1];
+    qsort(edges + lo, hi - lo, sizeof(uint32_t), cmp_u32);
+    if (weighted) {
+      for (uint64_t e = lo; e < hi; e++)
+        weights[e] = edge_weight(g->seed, u, edges[e]);
+    }
+  }
+
+  close_csr(base, path);
+}
+
+/**
+ * @brief Converts the text graph at in into the binary graph at out
+ */
+static void convert(const char *in, const char *out) {
+  Graph g;
+  if (bfs_graph_load(in, BFS_GRAPH_WEIGHTS, &g))
+    exit(1);
+
+  uint64_t m = 0;
+  for (int i = 0; i < g.n; i++)
+    m += g.nodes[i].no_of_edges;
+
+  bfs_csr_header_t h;
+  bfs_csr_header_init(&h, g.n, m, g.source, g.weights ? BFS_CSR_WEIGHTED : 0);
+  printf("Writing to file \"%s\"...\n", out);
+  char *base = create_csr(out, &h);
+  uint64_t *offsets = (uint64_t *)(base + bfs_csr_offsets_at(&h));
+  uint32_t *edges = (uint32_t *)(base + bfs_csr_edges_at(&h));
+  uint32_t *weights = (uint32_t *)(base + bfs_csr_weights_at(&h));
+
+  // the text may list the edges of the nodes in any order
+  uint64_t pos = 0;
+  for (int i = 0; i < g.n; i++) {
+    offsets[i] = pos;
+    for (int e = g.nodes[i].starting;
+         e < g.nodes[i].starting + g.nodes[i].no_of_edges; e++, pos++) {
+      edges[pos] = (uint32_t)g.edges[e];
+      if (g.weights)
+        weights[pos] = (uint32_t)g.weights[e];
+    }
+  }
+  offsets[g.n] = pos;
+
+  bfs_graph_free(&g);
+  close_csr(base, out);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-w] [-s <seed>] [-e <edgefactor>] rmat <scale> "
+          "<out.csr>\n"
+          "       %s [-w] [-s <seed>] [-e <edgefactor>] uniform <nodes> "
+          "<out.csr>\n"
+          "       %s convert <in.txt> <out.csr>\n",
+          prog, prog, prog);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  gen_t g = {GEN_RMAT, 0, 0, 0, 1};
+  uint64_t edgefactor = DEFAULT_EDGEFACTOR;
+  int weighted = 0, opt;
+
+  while ((opt = getopt(argc, argv, "ws:e:")) != -1) {
+    switch (opt) {
+    case 'w':
+      weighted = 1;
+      break;
+    case 's':
+      g.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'e':
+      edgefactor = strtoull(optarg, NULL, 10);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (argc - optind != 3)
+    usage(argv[0]);
+
+  const char *mode = argv[optind], *arg = argv[optind + 1];
+  const char *out = argv[optind + 2];
+  if (!strcmp(mode, "convert")) {
+    convert(arg, out);
+    return 0;
+  }
+
+  if (!strcmp(mode, "rmat")) {
+    g.kind = GEN_RMAT;
+    g.scale = atoi(arg);
+    if (g.scale < 1 || g.scale > 32) {
+      fprintf(stderr, "Error: scale must be between 1 and 32\n");
+      exit(1);
+    }
+    g.n = 1ULL << g.scale;
+  } else if (!strcmp(mode, "uniform")) {
+    g.kind = GEN_UNIFORM;
+    g.n = strtoull(arg, NULL, 10);
+    if (g.n < 2 || g.n > (1ULL << 32)) {
+      fprintf(stderr, "Error: nodes must be between 2 and 2^32\n");
+      exit(1);
+    }
+  } else {
+    usage(argv[0]);
+  }
+  if (edgefactor < 1) {
+    fprintf(stderr, "Error: edgefactor must be positive\n");
+    exit(1);
+  }
+  g.edges = edgefactor * g.n;
+
+  printf("Generating %s graph with %llu nodes and %llu edges...\n", mode,
+         (unsigned long long)g.n, (unsigned long long)g.edges);
+  generate(&g, weighted, out);
+  return 0;
+}
@@ -6,19 +6,13 @@
 #include <omp.h>
 #endif
 #include "BenchmarksUtil.h"
+#include "bfs.h"
 #include <sys/time.h>
 //#define NUM_THREAD 4
 #define OPEN
 
 int no_of_nodes;
 int edge_list_size;
-FILE *fp;
-
-// Structure to hold a node information
-typedef struct Node {
-  int starting;
-  int no_of_edges;
-} Node;
 
 #define bool int
 #define true 1
@@ -30,7 +24,7 @@ void BFSGraph(int argc, char **argv);
 
 void Usage(int argc, char **argv) {
 
-  fprintf(stderr, "Usage: %s <num_threads> <input_file>\n", argv[0]);
+  fprintf(stderr, "Usage: %s <num_threads> <input_file> [<queries>]\n", argv[0]);
 }
 ////////////////////////////////////////////////////////////////////////////////
 // Main Program
@@ -60,103 +54,58 @@ int compareResults(int *h_cost, int *h_cost_gpu, int no_of_nodes) {
   return fail;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// Apply BFS on a Graph using CUDA
-////////////////////////////////////////////////////////////////////////////////
-void BFSGraph(int argc, char **argv) {
-  int i;
-  char *input_f;
-  int num_omp_threads;
-
-  if (argc != 3) {
-    Usage(argc, argv);
-    exit(0);
-  }
-
-  num_omp_threads = atoi(argv[1]);
-  input_f = argv[2];
-
-  printf("Reading File\n");
-  // Read in Graph from a file
-  fp = fopen(input_f, "r");
-  if (!fp) {
-    printf("Error Reading graph file\n");
-    return;
-  }
-
-  int source = 0;
-
-  fscanf(fp, "%d", &no_of_nodes);
-
-  // allocate host memory
-  Node *h_graph_nodes = (Node *)malloc(sizeof(Node) * no_of_nodes);
-  bool *h_graph_mask = (bool *)malloc(sizeof(bool) * no_of_nodes);
-  bool *h_graph_mask_gpu = (bool *)malloc(sizeof(bool) * no_of_nodes);
-  bool *h_updating_graph_mask = (bool *)malloc(sizeof(bool) * no_of_nodes);
-  bool *h_updating_graph_mask_gpu = (bool *)malloc(sizeof(bool) * no_of_nodes);
-  bool *h_graph_visited = (bool *)malloc(sizeof(bool) * no_of_nodes);
-  bool *h_graph_visited_gpu = (bool *)malloc(sizeof(bool) * no_of_nodes);
-
-  int start, edgeno;
-  // initalize the memory
-  for (i = 0; i < no_of_nodes; i++) {
-    fscanf(fp, "%d %d", &start, &edgeno);
-    h_graph_nodes[i].starting = start;
-    h_graph_nodes[i].no_of_edges = edgeno;
-    h_graph_mask[i] = false;
-    h_graph_mask_gpu[i] = false;
-    h_updating_graph_mask[i] = false;
-    h_updating_graph_mask_gpu[i] = false;
-    h_graph_visited[i] = false;
-    h_graph_visited_gpu[i] = false;
+/**
+ * @brief Undirected edges of the component reached from the source, the edges
+ * traversed as counted by Graph500. Each one is stored in both directions
+ */
+double traversed_edges(Node *h_graph_nodes, int *h_cost, int no_of_nodes) {
+  double edges = 0;
+  for (int i = 0; i < no_of_nodes; i++) {
+    if (h_cost[i] >= 0)
+      edges += h_graph_nodes[i].no_of_edges;
   }
+  return edges / 2;
+}
 
-  // read the source node from the file
-  fscanf(fp, "%d", &source);
-  // source=0; //tesing code line
+////////////////////////////////////////////////////////////////////////////////
+// Apply BFS on a Graph with OpenMP offloading. h_cost_gpu holds -1 for every
+// node but the source (0) and receives the level of each node reached. The
+// levels run top-down and bottom-up are added to levels[0] and levels[1], to
+// be reported outside of the timed region
+////////////////////////////////////////////////////////////////////////////////
+void bfs_omp(Node *h_graph_nodes, int *h_graph_edges, int no_of_nodes,
+             int edge_list_size, int source, int *h_cost_gpu, int *levels) {
+#ifdef DIROPT
+  bfs_diropt(h_graph_nodes, h_graph_edges, no_of_nodes, edge_list_size, source,
+             h_cost_gpu, levels);
+#else
+  bool *h_graph_mask_gpu = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+  bool *h_updating_graph_mask_gpu = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+  bool *h_graph_visited_gpu = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+  int i, tid;
+  bool stop;
 
   // set the source node as true in the mask
-  h_graph_mask[source] = true;
   h_graph_mask_gpu[source] = true;
-  h_graph_visited[source] = true;
   h_graph_visited_gpu[source] = true;
 
-  fscanf(fp, "%d", &edge_list_size);
-
-  int id, cost;
-  int *h_graph_edges = (int *)malloc(sizeof(int) * edge_list_size);
-  for (i = 0; i < edge_list_size; i++) {
-    fscanf(fp, "%d", &id);
-    fscanf(fp, "%d", &cost);
-    h_graph_edges[i] = id;
-  }
-
-  if (fp)
-    fclose(fp);
-
-  // allocate mem for the result on host side
-  int *h_cost = (int *)malloc(sizeof(int) * no_of_nodes);
-  int *h_cost_gpu = (int *)malloc(sizeof(int) * no_of_nodes);
-  for (i = 0; i < no_of_nodes; i++) {
-    h_cost[i] = -1;
-    h_cost_gpu[i] = -1;
-  }
-  h_cost[source] = 0;
-  h_cost_gpu[source] = 0;
-
-  printf("Start traversing the tree\n");
-
-  int k = 0, tid;
-
-  bool stop;
-  double t_start, t_end;
-
-  t_start = rtclock();
-  // GPU
   do {
     // if no thread changes this value then the loop stops
     stop = false;
 
+    // as in Rodinia, the graph, the masks and the costs are mapped again at
+    // every level (see bfs_diropt.c for a device-resident traversal)
+    bench_phase_start();
+#pragma omp target enter data map(                                             \
+    to : h_graph_nodes[ : no_of_nodes], h_graph_edges[ : edge_list_size],      \
+    h_graph_visited_gpu[ : no_of_nodes], h_graph_mask_gpu[ : no_of_nodes],     \
+    h_cost_gpu[ : no_of_nodes], h_updating_graph_mask_gpu[ : no_of_nodes])
+    bench_phase_stop(BENCH_PHASE_H2D,
+                     no_of_nodes * (sizeof(Node) + sizeof(int) +
+                                    3 * sizeof(bool)) +
+                         edge_list_size * sizeof(int));
+
+    bench_phase_start();
 #pragma omp target map(                                                        \
     to : h_graph_nodes                                                         \
     [ : no_of_nodes],                                                          \
@@ -184,6 +133,16 @@ void BFSGraph(int argc, char **argv) {
         }
       }
     }
+    bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+    bench_phase_start();
+#pragma omp target exit data map(                                              \
+    from : h_graph_mask_gpu[ : no_of_nodes], h_cost_gpu[ : no_of_nodes],       \
+    h_updating_graph_mask_gpu[ : no_of_nodes])                                 \
+    map(release : h_graph_nodes[ : no_of_nodes],                               \
+        h_graph_edges[ : edge_list_size], h_graph_visited_gpu[ : no_of_nodes])
+    bench_phase_stop(BENCH_PHASE_D2H,
+                     no_of_nodes * (sizeof(int) + 2 * sizeof(bool)));
 
     for (tid = 0; tid < no_of_nodes; tid++) {
       if (h_updating_graph_mask_gpu[tid] == true) {
@@ -193,10 +152,161 @@ void BFSGraph(int argc, char **argv) {
         h_updating_graph_mask_gpu[tid] = false;
       }
     }
-    k++;
+    levels[0]++;
   } while (stop);
+
+  bench_free(h_graph_mask_gpu);
+  bench_free(h_updating_graph_mask_gpu);
+  bench_free(h_graph_visited_gpu);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Answer a batch of queries, a BFS from each of many sources, once with the
+// single-source BFS in a loop and once with the multi-source BFS
+////////////////////////////////////////////////////////////////////////////////
+void BFSQueries(Graph *graph, int queries) {
+  int n = graph->n;
+  int *sources = (int *)bench_malloc(sizeof(int) * queries);
+  int *h_cost_gpu = (int *)bench_malloc(sizeof(int) * n);
+  long *reached = (long *)bench_malloc(sizeof(long) * queries);
+  long *dist = (long *)bench_malloc(sizeof(long) * queries);
+  long *reached_ms = (long *)bench_malloc(sizeof(long) * queries);
+  long *dist_ms = (long *)bench_malloc(sizeof(long) * queries);
+  double edges = 0, t_loop = 0, t_start, t_end;
+  int levels[2] = {0, 0};
+
+  // spread over the nodes, starting from the source of the file
+  for (int q = 0; q < queries; q++)
+    sources[q] = (int)((graph->source + 2654435761L * q) % n);
+
+  printf("Answering %d queries\n", queries);
+
+  // one search per source, timed without the resets and the reductions
+  for (int q = 0; q < queries; q++) {
+    for (int i = 0; i < n; i++)
+      h_cost_gpu[i] = -1;
+    h_cost_gpu[sources[q]] = 0;
+
+    t_start = rtclock();
+    bfs_omp(graph->nodes, graph->edges, n, graph->m, sources[q], h_cost_gpu,
+            levels);
+    t_loop += rtclock() - t_start;
+
+    reached[q] = dist[q] = 0;
+    for (int i = 0; i < n; i++) {
+      if (h_cost_gpu[i] >= 0) {
+        reached[q]++;
+        dist[q] += h_cost_gpu[i];
+      }
+    }
+    edges += traversed_edges(graph->nodes, h_cost_gpu, n);
+  }
+  fprintf(stdout, "Loop Runtime: %0.6lfs\n", t_loop);
+  printf("BFS levels: %d top-down, %d bottom-up\n", levels[0], levels[1]);
+  bench_work_edges(edges);
+  bench_work_queries(queries);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME " loop", n, t_loop);
+
+  t_start = rtclock();
+  bfs_msbfs(graph->nodes, graph->edges, n, graph->m, sources, queries,
+            reached_ms, dist_ms);
+  t_end = rtclock();
+  fprintf(stdout, "MS-BFS Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME " msbfs", n,
+                         t_end - t_start);
+  printf("MS-BFS speedup over the loop: %0.2lfx\n",
+         t_loop / (t_end - t_start));
+
+  int fail = 0;
+  for (int q = 0; q < queries; q++) {
+    if (reached[q] != reached_ms[q] || dist[q] != dist_ms[q])
+      fail++;
+  }
+  printf("Non-Matching Loop-MS-BFS Queries: %d\n", fail);
+
+  bench_free(sources);
+  bench_free(h_cost_gpu);
+  bench_free(reached);
+  bench_free(dist);
+  bench_free(reached_ms);
+  bench_free(dist_ms);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Apply BFS on a Graph using CUDA
+////////////////////////////////////////////////////////////////////////////////
+void BFSGraph(int argc, char **argv) {
+  int i;
+  char *input_f;
+  int num_omp_threads;
+
+  if (argc != 3 && argc != 4) {
+    Usage(argc, argv);
+    exit(0);
+  }
+
+  num_omp_threads = atoi(argv[1]);
+  input_f = argv[2];
+
+  printf("Reading File\n");
+  // Read in Graph from a file, text or binary CSR
+  Graph graph;
+  double t_load = rtclock();
+  if (bfs_graph_load(input_f, 0, &graph))
+    return;
+  printf("Graph load: %0.6lfs\n", rtclock() - t_load);
+
+  if (argc == 4) {
+    int queries = atoi(argv[3]);
+    if (queries > 0)
+      BFSQueries(&graph, queries);
+    bfs_graph_free(&graph);
+    return;
+  }
+
+  int source = graph.source;
+  no_of_nodes = graph.n;
+  edge_list_size = graph.m;
+  Node *h_graph_nodes = graph.nodes;
+  int *h_graph_edges = graph.edges;
+
+  // allocate host memory
+  bool *h_graph_mask = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+  bool *h_updating_graph_mask = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+  bool *h_graph_visited = (bool *)bench_malloc(sizeof(bool) * no_of_nodes);
+
+  // set the source node as true in the mask
+  h_graph_mask[source] = true;
+  h_graph_visited[source] = true;
+
+  // allocate mem for the result on host side
+  int *h_cost = (int *)bench_malloc(sizeof(int) * no_of_nodes);
+  int *h_cost_gpu = (int *)bench_malloc(sizeof(int) * no_of_nodes);
+  for (i = 0; i < no_of_nodes; i++) {
+    h_cost[i] = -1;
+    h_cost_gpu[i] = -1;
+  }
+  h_cost[source] = 0;
+  h_cost_gpu[source] = 0;
+
+  printf("Start traversing the tree\n");
+
+  int k = 0, tid;
+
+  bool stop;
+  double t_start, t_end;
+  int levels[2] = {0, 0};
+
+  t_start = rtclock();
+  // GPU
+  bfs_omp(h_graph_nodes, h_graph_edges, no_of_nodes, edge_list_size, source,
+          h_cost_gpu, levels);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  printf("BFS levels: %d top-down, %d bottom-up\n", levels[0], levels[1]);
+  bench_work_edges(traversed_edges(h_graph_nodes, h_cost_gpu, no_of_nodes));
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, no_of_nodes, t_end - t_start);
 
   t_start = rtclock();
   // CPU
@@ -231,6 +341,8 @@ void BFSGraph(int argc, char **argv) {
   } while (stop);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_work_edges(traversed_edges(h_graph_nodes, h_cost, no_of_nodes));
+  bench_result_emit_time(BENCH_KERNEL, "CPU", no_of_nodes, t_end - t_start);
 
   compareResults(h_cost, h_cost_gpu, no_of_nodes);
 
@@ -242,10 +354,9 @@ void BFSGraph(int argc, char **argv) {
   printf("Result stored in result.txt\n");
 
   // cleanup memory
-  free(h_graph_nodes);
-  free(h_graph_edges);
-  free(h_graph_mask);
-  free(h_updating_graph_mask);
-  free(h_graph_visited);
-  free(h_cost);
+  bfs_graph_free(&graph);
+  bench_free(h_graph_mask);
+  bench_free(h_updating_graph_mask);
+  bench_free(h_graph_visited);
+  bench_free(h_cost);
 }
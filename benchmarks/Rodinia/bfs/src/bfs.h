@@ -0,0 +1,67 @@
+// bfs.h
+// Graph layout and loading, shared by the BFS engines and csrgen.
+
+#ifndef BFS_H
+#define BFS_H
+
+// Structure to hold a node information
+typedef struct Node {
+  int starting;
+  int no_of_edges;
+} Node;
+
+/** Load the weights of the edges too */
+#define BFS_GRAPH_WEIGHTS 0x1
+
+/**
+ * @brief A graph in the layout of Rodinia: the edges of node v are
+ * edges[nodes[v].starting] and the nodes[v].no_of_edges following ones
+ */
+typedef struct Graph {
+  int n;        // nodes
+  int m;        // edges, counting both directions
+  int source;   // node the search starts from
+  Node *nodes;
+  int *edges;   // in the mapped file for binary graphs
+  int *weights; // NULL unless loaded with BFS_GRAPH_WEIGHTS
+  void *map;    // mapped file, if any
+  size_t map_len;
+} Graph;
+
+/**
+ * @brief Loads the Rodinia text graph or the binary CSR graph (see bfs_csr.h)
+ * at path, told apart by their first bytes. Binary graphs are mapped, and
+ * their edges used in place
+ * @return 0 on success, -1 with a message on stderr otherwise
+ * @see bfs_graph.c
+ */
+int bfs_graph_load(const char *path, int flags, Graph *g);
+
+/**
+ * @brief Releases the memory of a graph loaded with bfs_graph_load
+ */
+void bfs_graph_free(Graph *g);
+
+/**
+ * @brief Direction-optimizing BFS of the n nodes and m edges of an undirected
+ * graph from source, offloaded with OpenMP. cost holds -1 for every node but
+ * the source (0) and receives the level of each node reached. The levels run
+ * top-down and bottom-up are added to levels[0] and levels[1]
+ * @see bfs_diropt.c
+ */
+void bfs_diropt(const Node *nodes, const int *edges, int n, int m, int source,
+                int *cost, int *levels);
+
+/** Sources searched together by bfs_msbfs, one bit of a mask each */
+#define BFS_BATCH 64
+
+/**
+ * @brief Multi-source BFS of the q sources of an undirected graph, BFS_BATCH
+ * at a time, offloaded with OpenMP. For each source, reached receives the
+ * number of nodes reached, itself included, and dist the sum of their levels
+ * @see bfs_msbfs.c
+ */
+void bfs_msbfs(const Node *nodes, const int *edges, int n, int m,
+               const int *sources, int q, long *reached, long *dist);
+
+#endif
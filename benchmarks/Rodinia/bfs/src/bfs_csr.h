@@ -0,0 +1,95 @@
+// bfs_csr.h
+// Binary CSR file format of the BFS graphs.
+//
+// The text graphs of Rodinia take millions of fscanf calls to read, far longer
+// than the traversal of a million-node graph. The binary format is the
+// compressed sparse row layout of the graph, preceded by a header, so that
+// the loader maps the file and uses the edges in place:
+//
+//   header    bfs_csr_header_t, 64 bytes
+//   offsets   n + 1 uint64_t, the edges of node v are edges[offsets[v]] to
+//             edges[offsets[v + 1] - 1]
+//   edges     m uint32_t, the destination of every edge
+//   weights   m uint32_t, only when BFS_CSR_WEIGHTED is set in flags
+//
+// The graphs are undirected, every edge is stored in both directions, and the
+// integers are in the byte order of the host that wrote the file. Files end
+// in .csr and are written by inputGen/csrgen, which also converts the text
+// graphs.
+
+#ifndef BFS_CSR_H
+#define BFS_CSR_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** First bytes of every file */
+#define BFS_CSR_MAGIC "BFSCSR\r\n"
+
+#define BFS_CSR_VERSION 1
+
+/** The file holds the weights of the edges after them */
+#define BFS_CSR_WEIGHTED 0x1u
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t n;      // nodes
+  uint64_t m;      // edges, counting both directions
+  uint64_t source; // node the search starts from
+  uint64_t reserved[3];
+} bfs_csr_header_t;
+
+/**
+ * @brief Fills a header for n nodes and m edges
+ */
+static inline void bfs_csr_header_init(bfs_csr_header_t *h, uint64_t n,
+                                       uint64_t m, uint64_t source,
+                                       uint32_t flags) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, BFS_CSR_MAGIC, sizeof(h->magic));
+  h->version = BFS_CSR_VERSION;
+  h->flags = flags;
+  h->n = n;
+  h->m = m;
+  h->source = source;
+}
+
+/**
+ * @brief Byte offsets of the sections in the file
+ */
+static inline uint64_t bfs_csr_offsets_at(const bfs_csr_header_t *h) {
+  (void)h;
+  return sizeof(bfs_csr_header_t);
+}
+
+static inline uint64_t bfs_csr_edges_at(const bfs_csr_header_t *h) {
+  return bfs_csr_offsets_at(h) + (h->n + 1) * sizeof(uint64_t);
+}
+
+static inline uint64_t bfs_csr_weights_at(const bfs_csr_header_t *h) {
+  return bfs_csr_edges_at(h) + h->m * sizeof(uint32_t);
+}
+
+/**
+ * @brief Size of the file described by a header
+ */
+static inline uint64_t bfs_csr_size(const bfs_csr_header_t *h) {
+  return bfs_csr_weights_at(h) +
+         ((h->flags & BFS_CSR_WEIGHTED) ? h->m * sizeof(uint32_t) : 0);
+}
+
+/**
+ * @brief Whether the header starts a file of size bytes that this version
+ * reads
+ */
+static inline int bfs_csr_valid(const bfs_csr_header_t *h, uint64_t size) {
+  return size >= sizeof(*h) &&
+         !memcmp(h->magic, BFS_CSR_MAGIC, sizeof(h->magic)) &&
+         h->version == BFS_CSR_VERSION && h->n > 0 && h->source < h->n &&
+         h->n < UINT64_MAX / 16 && h->m < UINT64_MAX / 16 &&
+         bfs_csr_size(h) == size;
+}
+
+#endif
@@ -0,0 +1,239 @@
+// bfs_diropt.c
+// Direction-optimizing breadth-first search, offloaded with OpenMP.
+//
+// This is the DIROPT variant of bfs, selected with VARIANT=DIROPT. Where the
+// Rodinia version scans every node at every level, twice, this engine keeps
+// the frontier as a queue of nodes and switches between two kinds of steps
+// (Beamer, Asanovic and Patterson, "Direction-Optimizing Breadth-First
+// Search", SC'12):
+//
+//   top-down   the nodes of the queue claim their unvisited neighbours with
+//              an atomic update of the visited bitmap, and append them to the
+//              queue of the next level
+//   bottom-up  every unvisited node looks for a parent in the bitmap of the
+//              frontier, and stops at the first one found. Each iteration
+//              owns a word of 32 nodes of the bitmaps, so no atomics are needed
+//
+// Top-down pays for the edges of the frontier, bottom-up for those of the
+// unvisited nodes until they find a parent, so the engine goes bottom-up when
+// the frontier grows past 1/BFS_ALPHA of the unexplored edges, and back when
+// it shrinks below 1/BFS_BETA of the nodes. The graph, the costs, the bitmaps
+// and the queues stay on the device for the whole traversal; between levels
+// only the size of the frontier and its edge count come back to the host.
+
+#include <stdlib.h>
+
+#include "BenchmarksAlloc.h"
+#include "BenchmarksPhases.h"
+#include "bfs.h"
+
+/** Bottom-up once the frontier has more than 1/BFS_ALPHA of the unexplored
+ * edges */
+#ifndef BFS_ALPHA
+#define BFS_ALPHA 14
+#endif
+
+/** Top-down again once the frontier has less than 1/BFS_BETA of the nodes */
+#ifndef BFS_BETA
+#define BFS_BETA 24
+#endif
+
+/** Word and bit of node v in a bitmap */
+#define BFS_WORD(v) ((v) >> 5)
+#define BFS_BIT(v) (1u << ((v)&31))
+
+/**
+ * @brief Top-down step from the nq nodes of queue. The nodes claimed are
+ * appended to next, whose size is returned in n_next
+ * @return The edges of the nodes claimed
+ */
+static long td_step(const Node *nodes, const int *edges, int n, int m,
+                    int *cost, unsigned *visited, const int *queue, int nq,
+                    int *next, int *n_next, int level) {
+  int words = BFS_WORD(n + 31);
+  long scout = 0;
+  int count = 0;
+
+  #pragma omp target teams distribute parallel for map(to: nodes[:n], edges[:m], queue[:n]) map(tofrom: cost[:n], visited[:words], next[:n], count, scout) reduction(+ : scout)
+  for (int q = 0; q < nq; q++) {
+    int u = queue[q];
+    int end = nodes[u].starting + nodes[u].no_of_edges;
+    for (int e = nodes[u].starting; e < end; e++) {
+      int v = edges[e];
+      // a stale read only costs the atomic below
+      if (visited[BFS_WORD(v)] & BFS_BIT(v))
+        continue;
+      unsigned old;
+      #pragma omp atomic capture
+      {
+        old = visited[BFS_WORD(v)];
+        visited[BFS_WORD(v)] |= BFS_BIT(v);
+      }
+      if (old & BFS_BIT(v))
+        continue;
+
+      int pos;
+      #pragma omp atomic capture
+      pos = count++;
+      next[pos] = v;
+      cost[v] = level + 1;
+      scout += nodes[v].no_of_edges;
+    }
+  }
+
+  *n_next = count;
+  return scout;
+}
+
+/**
+ * @brief Bottom-up step from the bitmap front, which fills the bitmap next
+ * @return The number of nodes reached
+ */
+static int bu_step(const Node *nodes, const int *edges, int n, int m,
+                   int *cost, unsigned *visited, const unsigned *front,
+                   unsigned *next, int level) {
+  int words = BFS_WORD(n + 31);
+  int awake = 0;
+
+  #pragma omp target teams distribute parallel for map(to: nodes[:n], edges[:m], front[:words]) map(tofrom: cost[:n], visited[:words], next[:words]) reduction(+ : awake)
+  for (int w = 0; w < words; w++) {
+    unsigned found = 0;
+    for (int b = 0; b < 32; b++) {
+      int v = w * 32 + b;
+      if (v >= n || (visited[w] & (1u << b)))
+        continue;
+      int end = nodes[v].starting + nodes[v].no_of_edges;
+      for (int e = nodes[v].starting; e < end; e++) {
+        int u = edges[e];
+        if (front[BFS_WORD(u)] & BFS_BIT(u)) {
+          cost[v] = level + 1;
+          found |= 1u << b;
+          awake++;
+          break;
+        }
+      }
+    }
+    visited[w] |= found;
+    next[w] = found;
+  }
+
+  return awake;
+}
+
+/**
+ * @brief Sets the bits of the nq nodes of queue in the bitmap front
+ */
+static void queue_to_bitmap(const int *queue, int nq, unsigned *front, int n) {
+  int words = BFS_WORD(n + 31);
+
+  #pragma omp target teams distribute parallel for map(tofrom: front[:words])
+  for (int w = 0; w < words; w++) {
+    front[w] = 0;
+  }
+
+  #pragma omp target teams distribute parallel for map(to: queue[:n]) map(tofrom: front[:words])
+  for (int q = 0; q < nq; q++) {
+    int u = queue[q];
+    #pragma omp atomic update
+    front[BFS_WORD(u)] |= BFS_BIT(u);
+  }
+}
+
+/**
+ * @brief Fills queue with the nodes of the bitmap front
+ * @return The number of nodes in the queue
+ */
+static int bitmap_to_queue(const unsigned *front, int *queue, int n) {
+  int words = BFS_WORD(n + 31);
+  int count = 0;
+
+  #pragma omp target teams distribute parallel for map(to: front[:words]) map(tofrom: queue[:n], count)
+  for (int w = 0; w < words; w++) {
+    unsigned bits = front[w];
+    if (!bits)
+      continue;
+    int k = 0;
+    for (int b = 0; b < 32; b++)
+      k += (bits >> b) & 1;
+    int pos;
+    #pragma omp atomic capture
+    {
+      pos = count;
+      count += k;
+    }
+    for (int b = 0; b < 32; b++)
+      if (bits & (1u << b))
+        queue[pos++] = w * 32 + b;
+  }
+
+  return count;
+}
+
+void bfs_diropt(const Node *nodes, const int *edges, int n, int m, int source,
+                int *cost, int *levels) {
+  int words = BFS_WORD(n + 31);
+  unsigned *visited = (unsigned *)bench_malloc(words * sizeof(unsigned));
+  unsigned *front = (unsigned *)bench_malloc(words * sizeof(unsigned));
+  unsigned *next_front = (unsigned *)bench_malloc(words * sizeof(unsigned));
+  int *queue = (int *)bench_malloc(n * sizeof(int));
+  int *next = (int *)bench_malloc(n * sizeof(int));
+
+  bench_phase_start();
+  #pragma omp target enter data map(to: nodes[:n], edges[:m], cost[:n]) map(alloc: visited[:words], front[:words], next_front[:words], queue[:n], next[:n])
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   n * (sizeof(Node) + sizeof(int)) + m * sizeof(int));
+
+  bench_phase_start();
+  #pragma omp target teams distribute parallel for map(tofrom: visited[:words])
+  for (int w = 0; w < words; w++) {
+    visited[w] = 0;
+  }
+  #pragma omp target map(tofrom: visited[:words], queue[:n])
+  {
+    visited[BFS_WORD(source)] = BFS_BIT(source);
+    queue[0] = source;
+  }
+
+  long edges_to_check = m;
+  long scout = nodes[source].no_of_edges;
+  int nq = 1, level = 0, td_levels = 0, bu_levels = 0;
+  while (nq > 0) {
+    if (scout > edges_to_check / BFS_ALPHA) {
+      queue_to_bitmap(queue, nq, front, n);
+      int awake = nq, old_awake;
+      do {
+        old_awake = awake;
+        awake = bu_step(nodes, edges, n, m, cost, visited, front, next_front,
+                        level++);
+        unsigned *tmp = front;
+        front = next_front;
+        next_front = tmp;
+        bu_levels++;
+      } while (awake >= old_awake || awake > n / BFS_BETA);
+      nq = bitmap_to_queue(front, queue, n);
+      scout = 1;
+    } else {
+      edges_to_check -= scout;
+      scout = td_step(nodes, edges, n, m, cost, visited, queue, nq, next, &nq,
+                      level++);
+      int *tmp = queue;
+      queue = next;
+      next = tmp;
+      td_levels++;
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from: cost[:n]) map(release: nodes[:n], edges[:m], visited[:words], front[:words], next_front[:words], queue[:n], next[:n])
+  bench_phase_stop(BENCH_PHASE_D2H, n * sizeof(int));
+
+  levels[0] += td_levels;
+  levels[1] += bu_levels;
+
+  bench_free(visited);
+  bench_free(front);
+  bench_free(next_front);
+  bench_free(queue);
+  bench_free(next);
+}
@@ -0,0 +1,208 @@
+// bfs_graph.c
+// Loading of the BFS graphs, from the text format of Rodinia or from the
+// binary CSR format of bfs_csr.h.
+//
+// Both files are mapped. The text is parsed in place, without stdio, and the
+// binary edges are used where they lie in the mapping, which is populated up
+// front so that the first traversal does not fault them in. Only the node
+// array is built, from the offsets, since the engines read the starting edge
+// and the degree of each node side by side.
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BenchmarksAlloc.h"
+#include "bfs.h"
+#include "bfs_csr.h"
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+/**
+ * @brief Next non-negative integer of the text between *p and end, which is
+ * advanced past it
+ * @return 0 on success, -1 at the end of the text, on another character or
+ * past INT_MAX
+ */
+static int next_int(const char **p, const char *end, long *v) {
+  const char *s = *p;
+  while (s < end && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n'))
+    s++;
+  if (s == end || *s < '0' || *s > '9')
+    return -1;
+
+  long x = 0;
+  while (s < end && *s >= '0' && *s <= '9') {
+    x = 10 * x + (*s++ - '0');
+    if (x > INT_MAX)
+      return -1;
+  }
+  *p = s;
+  *v = x;
+  return 0;
+}
+
+/**
+ * @brief Parses the Rodinia text graph of len bytes at text: the number of
+ * nodes, the starting edge and degree of each node, the source, the number of
+ * edges, and the destination and weight of each edge
+ */
+static int parse_text(const char *text, size_t len, int flags, Graph *g,
+                      const char *path) {
+  const char *p = text, *end = text + len;
+  long n, m, source, start, degree, id, weight;
+
+  if (next_int(&p, end, &n) || n < 1)
+    goto bad;
+  g->n = (int)n;
+  g->nodes = (Node *)bench_malloc(n * sizeof(Node));
+  if (!g->nodes)
+    goto oom;
+  for (long i = 0; i < n; i++) {
+    if (next_int(&p, end, &start) || next_int(&p, end, &degree))
+      goto bad;
+    g->nodes[i].starting = (int)start;
+    g->nodes[i].no_of_edges = (int)degree;
+  }
+
+  if (next_int(&p, end, &source) || source >= n || next_int(&p, end, &m))
+    goto bad;
+  g->source = (int)source;
+  g->m = (int)m;
+  g->edges = (int *)bench_malloc(m * sizeof(int));
+  if (flags & BFS_GRAPH_WEIGHTS)
+    g->weights = (int *)bench_malloc(m * sizeof(int));
+  if (!g->edges || ((flags & BFS_GRAPH_WEIGHTS) && !g->weights))
+    goto oom;
+  for (long e = 0; e < m; e++) {
+    if (next_int(&p, end, &id) || id >= n || next_int(&p, end, &weight))
+      goto bad;
+    g->edges[e] = (int)id;
+    if (g->weights)
+      g->weights[e] = (int)weight;
+  }
+
+  for (long i = 0; i < n; i++) {
+    if ((long)g->nodes[i].starting + g->nodes[i].no_of_edges > m)
+      goto bad;
+  }
+  return 0;
+
+bad:
+  fprintf(stderr, "Malformed graph file %s near byte %ld\n", path,
+          (long)(p - text));
+  return -1;
+oom:
+  fprintf(stderr, "Out of memory loading %s\n", path);
+  return -1;
+}
+
+/**
+ * @brief Checks the binary CSR graph mapped at base and builds its nodes. The
+ * edges and the weights stay in the mapping
+ */
+static int load_csr(const char *base, size_t len, int flags, Graph *g,
+                    const char *path) {
+  const bfs_csr_header_t *h = (const bfs_csr_header_t *)base;
+
+  if (!bfs_csr_valid(h, len)) {
+    fprintf(stderr, "Invalid or truncated CSR graph %s\n", path);
+    return -1;
+  }
+  if (h->n > INT_MAX || h->m > INT_MAX) {
+    fprintf(stderr, "CSR graph %s has more than %d nodes or edges\n", path,
+            INT_MAX);
+    return -1;
+  }
+
+  long n = (long)h->n, m = (long)h->m;
+  const uint64_t *offsets = (const uint64_t *)(base + bfs_csr_offsets_at(h));
+  const uint32_t *edges = (const uint32_t *)(base + bfs_csr_edges_at(h));
+  g->n = (int)n;
+  g->m = (int)m;
+  g->source = (int)h->source;
+  g->edges = (int *)edges;
+  if ((flags & BFS_GRAPH_WEIGHTS) && (h->flags & BFS_CSR_WEIGHTED))
+    g->weights = (int *)(base + bfs_csr_weights_at(h));
+
+  g->nodes = (Node *)bench_malloc(n * sizeof(Node));
+  if (!g->nodes) {
+    fprintf(stderr, "Out of memory loading %s\n", path);
+    return -1;
+  }
+
+  // the offsets must rise to m, and the edges stay below n
+  long bad = offsets[0] != 0 || offsets[n] != (uint64_t)m;
+  #pragma omp parallel for reduction(+ : bad)
+  for (long i = 0; i < n; i++) {
+    bad += offsets[i] > offsets[i + 1];
+    g->nodes[i].starting = (int)offsets[i];
+    g->nodes[i].no_of_edges = (int)(offsets[i + 1] - offsets[i]);
+  }
+  #pragma omp parallel for reduction(+ : bad)
+  for (long e = 0; e < m; e++) {
+    bad += edges[e] >= (uint32_t)n;
+  }
+  if (bad) {
+    fprintf(stderr, "Corrupted CSR graph %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+int bfs_graph_load(const char *path, int flags, Graph *g) {
+  struct stat st;
+  int ret = -1;
+
+  memset(g, 0, sizeof(*g));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) || st.st_size == 0) {
+    fprintf(stderr, "Error reading graph file %s\n", path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+
+  size_t len = (size_t)st.st_size;
+  char *base = (char *)mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                            fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Error mapping graph file %s\n", path);
+    return -1;
+  }
+
+  if (len >= sizeof(bfs_csr_header_t) &&
+      !memcmp(base, BFS_CSR_MAGIC, sizeof(((bfs_csr_header_t *)0)->magic))) {
+    g->map = base;
+    g->map_len = len;
+    ret = load_csr(base, len, flags, g, path);
+  } else {
+    // the text is only needed while parsing
+    madvise(base, len, MADV_SEQUENTIAL);
+    ret = parse_text(base, len, flags, g, path);
+    munmap(base, len);
+  }
+
+  if (ret)
+    bfs_graph_free(g);
+  return ret;
+}
+
+void bfs_graph_free(Graph *g) {
+  bench_free(g->nodes);
+  if (g->map) {
+    munmap(g->map, g->map_len);
+  } else {
+    bench_free(g->edges);
+    bench_free(g->weights);
+  }
+  memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,181 @@
+// bfs_msbfs.c
+// Multi-source breadth-first search of batches of sources, offloaded with
+// OpenMP.
+//
+// This is the batched mode of bfs, run when a number of queries follows the
+// graph on the command line. Running one search per source reads the whole
+// graph once per source. This engine runs the searches of up to BFS_BATCH
+// sources together (Then et al., "The More the Merrier: Efficient
+// Multi-Source Graph Traversal", VLDB 2014): every node holds one bit per
+// source of the batch in three 64-bit masks, the sources that have seen it,
+// that reach it at the current level, and that reach it at the next one.
+//
+// A level is a step of the searches of the whole batch, in either direction,
+// as in bfs_diropt.c. While the frontier is small, its nodes push the bits of
+// their sources to the neighbours that have not seen them, with an atomic OR.
+// Once its edges pass 1/MSBFS_ALPHA of the graph, every node ORs the masks of
+// its neighbours instead, keeps the bits of the sources that have not seen it
+// yet, and stops reading its edges once it has all of them; nodes that every
+// source has seen are skipped. Either way, the searches of a batch share each
+// read of an edge. The graph stays on the device for every batch; between
+// levels only the edge count of the frontier comes back to the host.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BenchmarksAlloc.h"
+#include "BenchmarksPhases.h"
+#include "bfs.h"
+
+/** Bottom-up once the frontier has more than 1/MSBFS_ALPHA of the edges */
+#ifndef MSBFS_ALPHA
+#define MSBFS_ALPHA 14
+#endif
+
+/**
+ * @brief Top-down step of a batch: the nodes of the current level visit push
+ * the bits of their sources to the neighbours that have not seen them, into
+ * next
+ */
+static void msbfs_top_down(const Node *nodes, const int *edges, int n, int m,
+                           const uint64_t *seen, const uint64_t *visit,
+                           uint64_t *next) {
+  #pragma omp target teams distribute parallel for map(tofrom: next[:n])
+  for (int v = 0; v < n; v++) {
+    next[v] = 0;
+  }
+
+  #pragma omp target teams distribute parallel for map(to: nodes[:n], edges[:m], seen[:n], visit[:n]) map(tofrom: next[:n])
+  for (int v = 0; v < n; v++) {
+    uint64_t bits = visit[v];
+    if (!bits)
+      continue;
+    int end = nodes[v].starting + nodes[v].no_of_edges;
+    for (int e = nodes[v].starting; e < end; e++) {
+      int u = edges[e];
+      uint64_t d = bits & ~seen[u];
+      if (d) {
+        #pragma omp atomic update
+        next[u] |= d;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Bottom-up step of a batch of k sources: every node ORs the masks of
+ * the current level visit of its neighbours into next, and stops once it has
+ * the bits of all the sources that have not seen it
+ */
+static void msbfs_bottom_up(const Node *nodes, const int *edges, int n, int m,
+                            int k, const uint64_t *seen,
+                            const uint64_t *visit, uint64_t *next) {
+  uint64_t all = k == 64 ? ~0ULL : (1ULL << k) - 1;
+
+  #pragma omp target teams distribute parallel for map(to: nodes[:n], edges[:m], seen[:n], visit[:n]) map(tofrom: next[:n])
+  for (int v = 0; v < n; v++) {
+    uint64_t unseen = all & ~seen[v];
+    uint64_t found = 0;
+    if (unseen) {
+      int end = nodes[v].starting + nodes[v].no_of_edges;
+      for (int e = nodes[v].starting; e < end && found != unseen; e++)
+        found |= visit[edges[e]] & unseen;
+    }
+    next[v] = found;
+  }
+}
+
+/**
+ * @brief Marks the nodes of the next level seen, from the bits of next that
+ * they had not seen yet, and counts them for their sources
+ * @return The edges of the nodes of the next level, 0 when it is empty
+ */
+static long msbfs_settle(const Node *nodes, int n, int k, uint64_t *seen,
+                         uint64_t *next, int level, long *reached,
+                         long *dist) {
+  long scout = 0;
+
+  #pragma omp target teams distribute parallel for map(to: nodes[:n]) map(tofrom: seen[:n], next[:n]) reduction(+ : scout, reached[:k], dist[:k])
+  for (int v = 0; v < n; v++) {
+    uint64_t found = next[v] & ~seen[v];
+    next[v] = found;
+    if (!found)
+      continue;
+
+    seen[v] |= found;
+    // isolated nodes still end the search of their sources
+    scout += nodes[v].no_of_edges + 1;
+    for (uint64_t bits = found; bits; bits &= bits - 1) {
+      int s = __builtin_ctzll(bits);
+      reached[s]++;
+      dist[s] += level + 1;
+    }
+  }
+
+  return scout;
+}
+
+void bfs_msbfs(const Node *nodes, const int *edges, int n, int m,
+               const int *sources, int q, long *reached, long *dist) {
+  uint64_t *seen = (uint64_t *)bench_malloc(n * sizeof(uint64_t));
+  uint64_t *visit = (uint64_t *)bench_malloc(n * sizeof(uint64_t));
+  uint64_t *next = (uint64_t *)bench_malloc(n * sizeof(uint64_t));
+  int td_levels = 0, bu_levels = 0;
+
+  bench_phase_start();
+  #pragma omp target enter data map(to: nodes[:n], edges[:m]) map(alloc: seen[:n], visit[:n], next[:n])
+  bench_phase_stop(BENCH_PHASE_H2D, n * sizeof(Node) + m * sizeof(int));
+
+  bench_phase_start();
+  for (int b = 0; b < q; b += BFS_BATCH) {
+    int k = q - b < BFS_BATCH ? q - b : BFS_BATCH;
+    const int *batch = sources + b;
+    long *b_reached = reached + b, *b_dist = dist + b;
+
+    #pragma omp target teams distribute parallel for map(tofrom: seen[:n], visit[:n])
+    for (int v = 0; v < n; v++) {
+      seen[v] = 0;
+      visit[v] = 0;
+    }
+    // sources repeated in a batch each get their own bit
+    #pragma omp target map(to: batch[:k]) map(tofrom: seen[:n], visit[:n])
+    for (int s = 0; s < k; s++) {
+      seen[batch[s]] |= 1ULL << s;
+      visit[batch[s]] |= 1ULL << s;
+    }
+    for (int s = 0; s < k; s++) {
+      b_reached[s] = 1;
+      b_dist[s] = 0;
+    }
+
+    long scout = 0;
+    for (int s = 0; s < k; s++)
+      scout += nodes[batch[s]].no_of_edges + 1;
+    for (int level = 0; scout > 0; level++) {
+      if (scout > m / MSBFS_ALPHA) {
+        msbfs_bottom_up(nodes, edges, n, m, k, seen, visit, next);
+        bu_levels++;
+      } else {
+        msbfs_top_down(nodes, edges, n, m, seen, visit, next);
+        td_levels++;
+      }
+      scout = msbfs_settle(nodes, n, k, seen, next, level, b_reached, b_dist);
+      uint64_t *tmp = visit;
+      visit = next;
+      next = tmp;
+    }
+  }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(release: nodes[:n], edges[:m], seen[:n], visit[:n], next[:n])
+  bench_phase_stop(BENCH_PHASE_D2H, 0);
+
+  printf("MS-BFS: %d batches, %d levels top-down, %d bottom-up\n",
+         (q + BFS_BATCH - 1) / BFS_BATCH, td_levels, bu_levels);
+
+  bench_free(seen);
+  bench_free(visit);
+  bench_free(next);
+}
@@ -0,0 +1,317 @@
+/*
+ * hotspotgen.c
+ *
+ * Writes temperature and power grids in the binary format of hotspot_grid.h
+ * for HotSpot in Rodinia, either generated or converted from the text grids.
+ *
+ * Usage:
+ * hotspotgen [-f] [-s <seed>] [-p <watts>] [-u <units>] floorplan <rows>
+ *            <cols> <temp_out> <power_out>
+ * hotspotgen [-f] convert <rows> <cols> <in.txt> <out>
+ *
+ * floorplan  grids of rows x cols cells of a synthetic chip. The chip is cut
+ *            in two, across its longer side at a random point between 30%
+ *            and 70%, and so on for each half, until it holds 2^units
+ *            functional units (6 by default, 64 units). Each unit dissipates
+ *            a density of power drawn over a range of 1 to 32, and the
+ *            power of the cells is scaled so that the chip dissipates watts
+ *            (40 W by default, as in the grids of Rodinia). The initial
+ *            temperature of a cell rises with the density of its unit, from
+ *            323 K to 343 K, the range of the grids of Rodinia
+ * convert    reads a text grid of rows x cols values, one per line, such as
+ *            the temp_* and power_* inputs
+ *
+ * With -f the values are written as floats, which the loader widens, so that
+ * a grid takes half the disk. A chip of a given seed is the same at every
+ * size, and its total power does not depend on the size, as the step of the
+ * simulation follows the area of the cells. The cells are drawn from a hash
+ * of the seed and their position, and the files are written through shared
+ * mappings, so the grids may be larger than memory, and for a given seed
+ * their contents do not depend on the number of threads.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "hotspot_grid.h"
+
+#define DEFAULT_UNITS 6
+#define DEFAULT_WATTS 40.0
+#define MAX_UNITS 16
+
+/** Range of the initial temperatures */
+#define MIN_TEMP 323.0
+#define MAX_TEMP 343.0
+
+/** Ratio of the highest density of power of a unit to the lowest */
+#define DENSITY_RANGE 32.0
+
+typedef struct {
+  uint64_t rows, cols;
+  uint64_t seed;
+  int units;       // log2 of the functional units
+  double *split;   // cut of each inner node of the floorplan, in [0.3, 0.7)
+  double *density; // density of power of each unit, in [1, DENSITY_RANGE)
+} chip_t;
+
+/** splitmix64 finalizer, a bijective mix of the 64 bits */
+static inline uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/** Uniform double in [0, 1) from 53 bits of x */
+static inline double unit(uint64_t x) { return (x >> 11) * 0x1.0p-53; }
+
+/**
+ * @brief Draws the cuts and the densities of the floorplan of a chip
+ */
+static void chip_init(chip_t *c) {
+  int n = 1 << c->units;
+  c->split = (double *)malloc(n * sizeof(double));
+  c->density = (double *)malloc(n * sizeof(double));
+  if (!c->split || !c->density) {
+    fprintf(stderr, "Out of memory for %d units\n", n);
+    exit(1);
+  }
+
+  // the nodes of the tree of cuts are numbered from 1, as in a heap
+  for (int i = 1; i < n; i++)
+    c->split[i] = 0.3 + 0.4 * unit(mix64(c->seed * 2 * n + i));
+  for (int i = 0; i < n; i++)
+    c->density[i] = pow(DENSITY_RANGE, unit(mix64(c->seed * 2 * n + n + i)));
+}
+
+/**
+ * @brief Functional unit of the cell of row r and column col, found by
+ * following the cuts from the whole chip to the unit that holds the center
+ * of the cell
+ */
+static inline int chip_unit(const chip_t *c, uint64_t r, uint64_t col) {
+  double y = (r + 0.5) / c->rows, x = (col + 0.5) / c->cols;
+  double y0 = 0, y1 = 1, x0 = 0, x1 = 1;
+  int node = 1;
+
+  for (int d = 0; d < c->units; d++) {
+    double s = c->split[node];
+    node *= 2;
+    // the sides are in units of the chip, which is square
+    if (x1 - x0 >= y1 - y0) {
+      double cut = x0 + s * (x1 - x0);
+      if (x < cut) {
+        x1 = cut;
+      } else {
+        x0 = cut;
+        node++;
+      }
+    } else {
+      double cut = y0 + s * (y1 - y0);
+      if (y < cut) {
+        y1 = cut;
+      } else {
+        y0 = cut;
+        node++;
+      }
+    }
+  }
+  return node - (1 << c->units);
+}
+
+/**
+ * @brief Creates the file at path with the size given by the header, and
+ * maps it for writing
+ */
+static char *create_grid(const char *path, const hotspot_grid_header_t *h) {
+  uint64_t size = hotspot_grid_size(h);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, (off_t)size)) {
+    perror(path);
+    exit(1);
+  }
+  char *base =
+      (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror(path);
+    exit(1);
+  }
+  memcpy(base, h, sizeof(*h));
+  return base;
+}
+
+/**
+ * @brief Flushes and unmaps a file of create_grid
+ */
+static void close_grid(char *base, const char *path) {
+  const hotspot_grid_header_t *h = (const hotspot_grid_header_t *)base;
+  uint64_t size = hotspot_grid_size(h);
+  printf("Wrote a %llux%llu grid to \"%s\"\n", (unsigned long long)h->rows,
+         (unsigned long long)h->cols, path);
+  if (msync(base, size, MS_SYNC))
+    perror(path);
+  munmap(base, size);
+}
+
+/**
+ * @brief Stores value i of a grid of type
+ */
+static inline void put(char *values, uint32_t type, uint64_t i, double v) {
+  if (type == HOTSPOT_GRID_F32)
+    ((float *)values)[i] = (float)v;
+  else
+    ((double *)values)[i] = v;
+}
+
+/**
+ * @brief Generates the grids of the chip c into the files at temp_out and
+ * power_out
+ */
+static void floorplan(const chip_t *c, double watts, uint32_t type,
+                      const char *temp_out, const char *power_out) {
+  int n = 1 << c->units;
+  double lo = DENSITY_RANGE, hi = 1.0, total = 0;
+
+  // the power of the cells is the density of their unit, scaled to watts
+  #pragma omp parallel for schedule(static) reduction(+ : total)
+  for (uint64_t r = 0; r < c->rows; r++) {
+    for (uint64_t col = 0; col < c->cols; col++)
+      total += c->density[chip_unit(c, r, col)];
+  }
+  for (int i = 0; i < n; i++) {
+    lo = c->density[i] < lo ? c->density[i] : lo;
+    hi = c->density[i] > hi ? c->density[i] : hi;
+  }
+  double scale = watts / total;
+  double rise = hi > lo ? (MAX_TEMP - MIN_TEMP) / (hi - lo) : 0;
+
+  hotspot_grid_header_t h;
+  hotspot_grid_header_init(&h, c->rows, c->cols, type);
+  printf("Writing to files \"%s\" and \"%s\"...\n", temp_out, power_out);
+  char *temp = create_grid(temp_out, &h);
+  char *power = create_grid(power_out, &h);
+  char *tv = temp + hotspot_grid_values_at(&h);
+  char *pv = power + hotspot_grid_values_at(&h);
+
+  #pragma omp parallel for schedule(static)
+  for (uint64_t r = 0; r < c->rows; r++) {
+    for (uint64_t col = 0; col < c->cols; col++) {
+      double d = c->density[chip_unit(c, r, col)];
+      put(tv, type, r * c->cols + col, MIN_TEMP + (d - lo) * rise);
+      put(pv, type, r * c->cols + col, d * scale);
+    }
+  }
+
+  close_grid(temp, temp_out);
+  close_grid(power, power_out);
+}
+
+/**
+ * @brief Converts the text grid of rows x cols values at in into the binary
+ * grid at out
+ */
+static void convert(uint64_t rows, uint64_t cols, uint32_t type,
+                    const char *in, const char *out) {
+  FILE *fp = fopen(in, "r");
+  if (!fp) {
+    perror(in);
+    exit(1);
+  }
+
+  hotspot_grid_header_t h;
+  hotspot_grid_header_init(&h, rows, cols, type);
+  printf("Writing to file \"%s\"...\n", out);
+  char *base = create_grid(out, &h);
+  char *values = base + hotspot_grid_values_at(&h);
+
+  for (uint64_t i = 0; i < rows * cols; i++) {
+    double v;
+    if (fscanf(fp, "%lf", &v) != 1) {
+      fprintf(stderr, "Error: %s holds less than %llu values\n", in,
+              (unsigned long long)(rows * cols));
+      unlink(out);
+      exit(1);
+    }
+    put(values, type, i, v);
+  }
+  fclose(fp);
+
+  close_grid(base, out);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-f] [-s <seed>] [-p <watts>] [-u <units>] floorplan "
+          "<rows> <cols> <temp_out> <power_out>\n"
+          "       %s [-f] convert <rows> <cols> <in.txt> <out>\n",
+          prog, prog);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  chip_t c = {0, 0, 1, DEFAULT_UNITS, NULL, NULL};
+  double watts = DEFAULT_WATTS;
+  uint32_t type = HOTSPOT_GRID_F64;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "fs:p:u:")) != -1) {
+    switch (opt) {
+    case 'f':
+      type = HOTSPOT_GRID_F32;
+      break;
+    case 's':
+      c.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'p':
+      watts = atof(optarg);
+      break;
+    case 'u':
+      c.units = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (argc - optind != 5)
+    usage(argv[0]);
+
+  const char *mode = argv[optind];
+  c.rows = strtoull(argv[optind + 1], NULL, 10);
+  c.cols = strtoull(argv[optind + 2], NULL, 10);
+  if (c.rows < 1 || c.cols < 1 || c.rows >= (1ULL << 31) ||
+      c.cols >= (1ULL << 31)) {
+    fprintf(stderr, "Error: rows and cols must be between 1 and 2^31 - 1\n");
+    exit(1);
+  }
+
+  if (!strcmp(mode, "convert")) {
+    convert(c.rows, c.cols, type, argv[optind + 3], argv[optind + 4]);
+    return 0;
+  }
+  if (strcmp(mode, "floorplan"))
+    usage(argv[0]);
+  if (c.units < 0 || c.units > MAX_UNITS) {
+    fprintf(stderr, "Error: units must be between 0 and %d\n", MAX_UNITS);
+    exit(1);
+  }
+  if (!(watts > 0)) {
+    fprintf(stderr, "Error: watts must be positive\n");
+    exit(1);
+  }
+
+  printf("Generating a %llux%llu chip of %d units and %g W...\n",
+         (unsigned long long)c.rows, (unsigned long long)c.cols, 1 << c.units,
+         watts);
+  chip_init(&c);
+  floorplan(&c, watts, type, argv[optind + 3], argv[optind + 4]);
+  free(c.split);
+  free(c.density);
+  return 0;
+}
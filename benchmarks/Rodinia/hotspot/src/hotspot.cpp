@@ -1,10 +1,20 @@
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 #include "BenchmarksUtil.h"
+#include "hotspot_grid.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
 
 #define STR_SIZE 256
 
@@ -23,107 +33,203 @@
 #define OPEN
 //#define NUM_THREAD 4
 
+#if defined(TILED) && defined(RUN_OMP_GPU)
+#error "The TILED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Cells on each side of a tile in the TILED variant */
+#ifndef HOTSPOT_TILE
+#define HOTSPOT_TILE 256
+#endif
+
+/** Timesteps advanced per tile by the TILED variant */
+#ifndef HOTSPOT_TIME_TILE
+#define HOTSPOT_TIME_TILE 16
+#endif
+
 /* chip parameters	*/
 double t_chip = 0.0005;
 double chip_height = 0.016;
 double chip_width = 0.016;
 /* ambient temperature, assuming no package at all	*/
+#define AMB_TEMP 80.0
 
 int num_omp_threads;
 
+/* Coefficients of the update of a cell: step / Cap, and the inverses of the
+ * thermal resistances
+ */
+typedef struct {
+  double c, rx, ry, rz;
+} hotspot_coef_t;
+
+#pragma omp declare target
+/* New temperature of a cell at t, from its neighbours n, s, e and w and its
+ * power p. On the sides of the chip the missing neighbours are the cell
+ * itself, which gives the edge and corner cases of single_iteration_cpu
+ */
+static inline double hotspot_cell(double t, double n, double s, double e,
+                                  double w, double p, hotspot_coef_t k) {
+  return t + k.c * (p + (n + s - 2.0 * t) * k.ry + (e + w - 2.0 * t) * k.rx +
+                    (AMB_TEMP - t) * k.rz);
+}
+#pragma omp end declare target
+
 /* Single iteration of the transient solver in the grid model.
  * advances the solution of the discretized difference equations
- * by one time step
+ * by one time step, from temp into result. The first and last rows and
+ * columns are peeled off the loop over the inner cells, which has no branch
  */
-void single_iteration_gpu(double *result, double *temp, double *power, int row,
-                          int col, double Cap, double Rx, double Ry, double Rz,
-                          double step) {
-  double delta;
-  int r, c;
-  double amb_temp = 80.0;
+void single_iteration_gpu(double *result, const double *temp,
+                          const double *power, int row, int col,
+                          hotspot_coef_t k) {
+  int last = (row - 1) * col;
+
+  #pragma omp target teams distribute parallel for
+  for (int r = 1; r < row - 1; r++) {
+    const double *t = temp + r * col, *p = power + r * col;
+    double *out = result + r * col;
+    int e = col > 1 ? 1 : 0, w = col > 1 ? col - 2 : 0;
+
+    /*	Edge 4	*/
+    out[0] = hotspot_cell(t[0], t[-col], t[col], t[e], t[0], p[0], k);
+    /*	Inside the chip	*/
+    for (int c = 1; c < col - 1; c++) {
+      out[c] = hotspot_cell(t[c], t[c - col], t[c + col], t[c + 1], t[c - 1],
+                            p[c], k);
+    }
+    /*	Edge 2	*/
+    if (col > 1)
+      out[col - 1] = hotspot_cell(t[col - 1], t[-1], t[2 * col - 1],
+                                  t[col - 1], t[w], p[col - 1], k);
+  }
 
-#pragma omp target teams distribute parallel for collapse(2)
-  for (r = 0; r < row; r++) {
-    for (c = 0; c < col; c++) {
-      /*	Corner 1	*/
-      if ((r == 0) && (c == 0)) {
-        delta = (step / Cap) *
-          (power[0] + (temp[1] - temp[0]) / Rx +
-           (temp[col] - temp[0]) / Ry + (amb_temp - temp[0]) / Rz);
-      } /*	Corner 2	*/
-      else if ((r == 0) && (c == col - 1)) {
-        delta = (step / Cap) *
-          (power[c] + (temp[c - 1] - temp[c]) / Rx +
-           (temp[c + col] - temp[c]) / Ry + (amb_temp - temp[c]) / Rz);
-      } /*	Corner 3	*/
-      else if ((r == row - 1) && (c == col - 1)) {
-        delta = (step / Cap) *
-          (power[r * col + c] +
-           (temp[r * col + c - 1] - temp[r * col + c]) / Rx +
-           (temp[(r - 1) * col + c] - temp[r * col + c]) / Ry +
-           (amb_temp - temp[r * col + c]) / Rz);
-      } /*	Corner 4	*/
-      else if ((r == row - 1) && (c == 0)) {
-        delta = (step / Cap) *
-          (power[r * col] + (temp[r * col + 1] - temp[r * col]) / Rx +
-           (temp[(r - 1) * col] - temp[r * col]) / Ry +
-           (amb_temp - temp[r * col]) / Rz);
-      } /*	Edge 1	*/
-      else if (r == 0) {
-        delta = (step / Cap) *
-          (power[c] + (temp[c + 1] + temp[c - 1] - 2.0 * temp[c]) / Rx +
-           (temp[col + c] - temp[c]) / Ry + (amb_temp - temp[c]) / Rz);
-      } /*	Edge 2	*/
-      else if (c == col - 1) {
-        delta = (step / Cap) *
-          (power[r * col + c] +
-           (temp[(r + 1) * col + c] + temp[(r - 1) * col + c] -
-            2.0 * temp[r * col + c]) /
-           Ry +
-           (temp[r * col + c - 1] - temp[r * col + c]) / Rx +
-           (amb_temp - temp[r * col + c]) / Rz);
-      } /*	Edge 3	*/
-      else if (r == row - 1) {
-        delta = (step / Cap) *
-          (power[r * col + c] +
-           (temp[r * col + c + 1] + temp[r * col + c - 1] -
-            2.0 * temp[r * col + c]) /
-           Rx +
-           (temp[(r - 1) * col + c] - temp[r * col + c]) / Ry +
-           (amb_temp - temp[r * col + c]) / Rz);
-      } /*	Edge 4	*/
-      else if (c == 0) {
-        delta = (step / Cap) * (power[r * col] +
-                                (temp[(r + 1) * col] + temp[(r - 1) * col] -
-                                 2.0 * temp[r * col]) /
-                                Ry +
-                                (temp[r * col + 1] - temp[r * col]) / Rx +
-                                (amb_temp - temp[r * col]) / Rz);
-      } /*	Inside the chip	*/
-      else {
-        delta = (step / Cap) *
-          (power[r * col + c] +
-           (temp[(r + 1) * col + c] + temp[(r - 1) * col + c] -
-            2.0 * temp[r * col + c]) /
-           Ry +
-           (temp[r * col + c + 1] + temp[r * col + c - 1] -
-            2.0 * temp[r * col + c]) /
-           Rx +
-           (amb_temp - temp[r * col + c]) / Rz);
+  /*	Edges 1 and 3, with the corners	*/
+  #pragma omp target teams distribute parallel for
+  for (int c = 0; c < col; c++) {
+    int e = c < col - 1 ? c + 1 : c, w = c > 0 ? c - 1 : c;
+    int s = row > 1 ? col : 0;
+    result[c] = hotspot_cell(temp[c], temp[c], temp[c + s], temp[e], temp[w],
+                             power[c], k);
+    if (row > 1)
+      result[last + c] =
+          hotspot_cell(temp[last + c], temp[last + c - col], temp[last + c],
+                       temp[last + e], temp[last + w], power[last + c], k);
+  }
+}
+
+#ifdef TILED
+/* Temporal blocking of the transient solver, on the CPU: each tile of
+ * HOTSPOT_TILE x HOTSPOT_TILE cells advances HOTSPOT_TIME_TILE iterations in
+ * a buffer of its own before the next tile. The buffer holds the tile and a
+ * halo as wide as the iterations, and each iteration updates one cell less
+ * on each side of the halo, so that the last one leaves the tile exact (the
+ * pyramids of the CUDA version of Rodinia). The halo is computed by both
+ * neighbouring tiles, and in exchange the grid only moves between memory and
+ * cache once every HOTSPOT_TIME_TILE iterations. The result of each block of
+ * iterations goes to the other grid, and the two grids swap roles.
+ * Returns the grid that holds the last iteration, temp or result
+ */
+double *hotspot_tiled(double *result, double *temp, const double *power,
+                      int row, int col, hotspot_coef_t k, int num_iterations) {
+  const int B = HOTSPOT_TILE, H = HOTSPOT_TIME_TILE;
+  int tiles_r = (row + B - 1) / B, tiles_c = (col + B - 1) / B;
+  double *src = temp, *dst = result;
+  size_t len = (size_t)(B + 2 * H) * (B + 2 * H);
+#ifdef _OPENMP
+  int threads = omp_get_max_threads();
+#else
+  int threads = 1;
+#endif
+  // two buffers per thread, allocated outside of the parallel region
+  double *bufs = (double *)bench_malloc(2 * threads * len * sizeof(double));
+
+  #pragma omp parallel num_threads(threads)
+  {
+    // iteration s of a tile reads buf[s % 2] and writes buf[(s + 1) % 2]
+#ifdef _OPENMP
+    double *own = bufs + 2 * len * omp_get_thread_num();
+#else
+    double *own = bufs;
+#endif
+    double *buf[2] = {own, own + len};
+
+    for (int t0 = 0; t0 < num_iterations; t0 += H) {
+      int steps = num_iterations - t0 < H ? num_iterations - t0 : H;
+
+      #pragma omp for collapse(2) schedule(static)
+      for (int tr = 0; tr < tiles_r; tr++) {
+        for (int tc = 0; tc < tiles_c; tc++) {
+          // the tile, and its halo clipped to the chip
+          int r_lo = tr * B, r_hi = r_lo + B < row ? r_lo + B : row;
+          int c_lo = tc * B, c_hi = c_lo + B < col ? c_lo + B : col;
+          int r0 = r_lo - steps > 0 ? r_lo - steps : 0;
+          int r1 = r_hi + steps < row ? r_hi + steps : row;
+          int c0 = c_lo - steps > 0 ? c_lo - steps : 0;
+          int c1 = c_hi + steps < col ? c_hi + steps : col;
+          int w = c1 - c0;
+
+          for (int r = r0; r < r1; r++) {
+            for (int c = c0; c < c1; c++) {
+              buf[0][(r - r0) * w + c - c0] = src[r * col + c];
+            }
+          }
+
+          for (int s = 0; s < steps; s++) {
+            const double *in = buf[s % 2];
+            double *out = buf[(s + 1) % 2];
+            // cells still exact after this iteration
+            int ur0 = r0 == 0 ? 0 : r0 + s + 1;
+            int ur1 = r1 == row ? row : r1 - s - 1;
+            int uc0 = c0 == 0 ? 0 : c0 + s + 1;
+            int uc1 = c1 == col ? col : c1 - s - 1;
+            // inner columns, without the first and last of the chip
+            int ic0 = uc0 > 0 ? uc0 : 1, ic1 = uc1 < col ? uc1 : col - 1;
+
+            for (int r = ur0; r < ur1; r++) {
+              int l = (r - r0) * w - c0;
+              int n = r > 0 ? l - w : l, so = r < row - 1 ? l + w : l;
+              const double *p = power + r * col;
+
+              if (uc0 == 0)
+                out[l] = hotspot_cell(in[l], in[n], in[so],
+                                      in[l + (col > 1)], in[l], p[0], k);
+              #pragma omp simd
+              for (int c = ic0; c < ic1; c++) {
+                out[l + c] = hotspot_cell(in[l + c], in[n + c], in[so + c],
+                                          in[l + c + 1], in[l + c - 1], p[c],
+                                          k);
+              }
+              if (uc1 == col && col > 1)
+                out[l + col - 1] = hotspot_cell(
+                    in[l + col - 1], in[n + col - 1], in[so + col - 1],
+                    in[l + col - 1], in[l + col - 2], p[col - 1], k);
+            }
+          }
+
+          const double *in = buf[steps % 2];
+          for (int r = r_lo; r < r_hi; r++) {
+            for (int c = c_lo; c < c_hi; c++) {
+              dst[r * col + c] = in[(r - r0) * w + c - c0];
+            }
+          }
+        }
       }
 
-      /*	Update Temperatures	*/
-      result[r * col + c] = temp[r * col + c] + delta;
+      // the implicit barrier of the loop ends the block of iterations
+      #pragma omp single
+      {
+        double *tmp = src;
+        src = dst;
+        dst = tmp;
+      }
     }
   }
 
-  #pragma omp target teams distribute parallel for collapse(2)
-  for (r = 0; r < row; r++) {
-    for (c = 0; c < col; c++) {
-      temp[r * col + c] = result[r * col + c];
-    }
-  }
+  bench_free(bufs);
+  return src;
 }
+#endif
 
 void single_iteration_cpu(double *result, double *temp, double *power, int row,
                           int col, double Cap, double Rx, double Ry, double Rz,
@@ -251,15 +357,44 @@ void compute_tran_temp(double *result, int num_iterations, double *temp,
     }
   }
   else {
-    #pragma omp target data map(to : power[0 : row *col], temp[0 : row *col]) map(tofrom : result[0 : row *col])
-    {
-      for (int i = 0; i < num_iterations; i++) {
+    hotspot_coef_t k = {step / Cap, 1.0 / Rx, 1.0 / Ry, 1.0 / Rz};
+    double *src = temp;
+
+#ifdef TILED
+    bench_phase_start();
+    src = hotspot_tiled(result, temp, power, row, col, k, num_iterations);
+    bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+#else
+    double *dst = result;
+
+    bench_phase_start();
+    #pragma omp target enter data                                              \
+        map(to : power[0 : row *col], temp[0 : row *col])                      \
+        map(alloc : result[0 : row *col])
+    bench_phase_stop(BENCH_PHASE_H2D, 2 * row * col * sizeof(double));
+
+    // the two grids swap roles at every iteration, instead of a copy
+    bench_phase_start();
+    for (int i = 0; i < num_iterations; i++) {
 #ifdef VERBOSE
-        fprintf(stdout, "iteration %d\n", i++);
+      fprintf(stdout, "iteration %d\n", i++);
 #endif
-        single_iteration_gpu(result, temp, power, row, col, Cap, Rx, Ry, Rz, step);
-      }
+      single_iteration_gpu(dst, src, power, row, col, k);
+      double *tmp = src;
+      src = dst;
+      dst = tmp;
     }
+    bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+    bench_phase_start();
+    #pragma omp target exit data map(from : src[0 : row *col])                 \
+        map(release : power[0 : row *col], dst[0 : row *col])
+    bench_phase_stop(BENCH_PHASE_D2H, row * col * sizeof(double));
+#endif
+
+    // the last iteration is expected in result
+    if (src != result)
+      memcpy(result, src, row * col * sizeof(double));
   }
   
 
@@ -268,16 +403,66 @@ void compute_tran_temp(double *result, int num_iterations, double *temp,
 #endif
 }
 
-void fatal(char *s) {
+void fatal(const char *s) {
   fprintf(stderr, "error: %s\n", s);
   exit(1);
 }
 
+/* Reads the binary grid of hotspot_grid.h that starts with the header h
+ * from the file open at fd. The file is mapped, and its values are copied,
+ * or widened from floats, by the threads that run the kernel on their rows
+ */
+void read_grid(double *vect, int grid_rows, int grid_cols, int fd,
+               const hotspot_grid_header_t *h, size_t len, char *file) {
+  if (!hotspot_grid_valid(h, len))
+    fatal("invalid or truncated binary grid");
+  if (h->rows != (uint64_t)grid_rows || h->cols != (uint64_t)grid_cols) {
+    fprintf(stderr, "error: %s holds a %llux%llu grid, not %dx%d\n", file,
+            (unsigned long long)h->rows, (unsigned long long)h->cols,
+            grid_rows, grid_cols);
+    exit(1);
+  }
+
+  char *base =
+      (char *)mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  if (base == MAP_FAILED)
+    fatal("file could not be mapped");
+
+  long n = (long)grid_rows * grid_cols;
+  if (h->type == HOTSPOT_GRID_F32) {
+    const float *v = (const float *)(base + hotspot_grid_values_at(h));
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++)
+      vect[i] = v[i];
+  } else {
+    const double *v = (const double *)(base + hotspot_grid_values_at(h));
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++)
+      vect[i] = v[i];
+  }
+
+  munmap(base, len);
+}
+
+/* Reads the grid in file, binary or text, into vect */
 void read_input(double *vect, int grid_rows, int grid_cols, char *file) {
   int i, index;
   FILE *fp;
   char str[STR_SIZE];
   double val;
+  hotspot_grid_header_t h;
+  struct stat st;
+
+  int fd = open(file, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st))
+    fatal("file could not be opened for reading");
+  if (pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+      !memcmp(h.magic, HOTSPOT_GRID_MAGIC, sizeof(h.magic))) {
+    read_grid(vect, grid_rows, grid_cols, fd, &h, (size_t)st.st_size, file);
+    close(fd);
+    return;
+  }
+  close(fd);
 
   fp = fopen(file, "r");
   if (!fp)
@@ -347,11 +532,11 @@ int main(int argc, char **argv) {
     usage(argc, argv);
 
   /* allocate memory for the temperature and power arrays	*/
-  temp_cpu = (double *)calloc(grid_rows * grid_cols, sizeof(double));
-  temp_gpu = (double *)calloc(grid_rows * grid_cols, sizeof(double));
-  power = (double *)calloc(grid_rows * grid_cols, sizeof(double));
-  result_cpu = (double *)calloc(grid_rows * grid_cols, sizeof(double));
-  result_gpu = (double *)calloc(grid_rows * grid_cols, sizeof(double));
+  temp_cpu = (double *)bench_calloc(grid_rows * grid_cols, sizeof(double));
+  temp_gpu = (double *)bench_calloc(grid_rows * grid_cols, sizeof(double));
+  power = (double *)bench_calloc(grid_rows * grid_cols, sizeof(double));
+  result_cpu = (double *)bench_calloc(grid_rows * grid_cols, sizeof(double));
+  result_gpu = (double *)bench_calloc(grid_rows * grid_cols, sizeof(double));
 
   if (!temp_cpu || !temp_gpu || !power)
     fatal("unable to allocate memory");
@@ -359,23 +544,28 @@ int main(int argc, char **argv) {
   /* read initial temperatures and input power	*/
   tfile = argv[5];
   pfile = argv[6];
+  t_start = rtclock();
   read_input(temp_cpu, grid_rows, grid_cols, tfile);
-  read_input(temp_gpu, grid_rows, grid_cols, tfile);
+  memcpy(temp_gpu, temp_cpu, (size_t)grid_rows * grid_cols * sizeof(double));
   read_input(power, grid_rows, grid_cols, pfile);
+  printf("Input load: %0.6lfs\n", rtclock() - t_start);
 
   printf("<< Start computing the transient temperature >>\n");
+  bench_work_iterations(sim_time);
 
   t_start = rtclock();
   compute_tran_temp(result_cpu, sim_time, temp_cpu, power, grid_rows, grid_cols,
                     0);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", grid_rows, t_end - t_start);
 
   t_start = rtclock();
   compute_tran_temp(result_gpu, sim_time, temp_gpu, power, grid_rows, grid_cols,
                     1);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, grid_rows, t_end - t_start);
 
   compareResults(result_cpu, result_gpu, grid_rows, grid_cols);
 
@@ -391,9 +581,9 @@ int main(int argc, char **argv) {
     fprintf(stdout, "%d\t%g\n", i, temp[i]);
 #endif
   /* cleanup	*/
-  free(temp_gpu);
-  free(temp_cpu);
-  free(power);
+  bench_free(temp_gpu);
+  bench_free(temp_cpu);
+  bench_free(power);
 
   return 0;
 }
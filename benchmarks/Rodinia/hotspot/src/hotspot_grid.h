@@ -0,0 +1,96 @@
+// hotspot_grid.h
+// Binary file format of the HotSpot temperature and power grids.
+//
+// The text grids of Rodinia hold one value per line, read with an fgets and
+// an sscanf per cell, which takes longer than the simulation of a large grid,
+// and the ones shipped stop at 512 x 512. The binary format is the grid as
+// it lies in memory, preceded by a header, so that the loader maps the file
+// and copies or widens the values at the speed of memory:
+//
+//   header    hotspot_grid_header_t, 64 bytes
+//   values    rows * cols doubles, or floats with HOTSPOT_GRID_F32, row by
+//             row, the cell of row r and column c at r * cols + c
+//
+// The values are in the byte order of the host that wrote the file. A
+// temperature and a power file make an input. Both are written by
+// inputGen/hotspotgen, which also converts the text grids.
+
+#ifndef HOTSPOT_GRID_H
+#define HOTSPOT_GRID_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** First bytes of every file */
+#define HOTSPOT_GRID_MAGIC "HSGRID\r\n"
+
+#define HOTSPOT_GRID_VERSION 1
+
+/** Types of the values */
+#define HOTSPOT_GRID_F64 0u
+#define HOTSPOT_GRID_F32 1u
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t type;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t reserved[4];
+} hotspot_grid_header_t;
+
+/**
+ * @brief Fills a header for a grid of rows x cols values of type
+ */
+static inline void hotspot_grid_header_init(hotspot_grid_header_t *h,
+                                            uint64_t rows, uint64_t cols,
+                                            uint32_t type) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, HOTSPOT_GRID_MAGIC, sizeof(h->magic));
+  h->version = HOTSPOT_GRID_VERSION;
+  h->type = type;
+  h->rows = rows;
+  h->cols = cols;
+}
+
+/**
+ * @brief Size of a value of the grid
+ */
+static inline uint64_t hotspot_grid_value_size(const hotspot_grid_header_t *h) {
+  return h->type == HOTSPOT_GRID_F32 ? sizeof(float) : sizeof(double);
+}
+
+/**
+ * @brief Byte offset of the values in the file
+ */
+static inline uint64_t hotspot_grid_values_at(const hotspot_grid_header_t *h) {
+  (void)h;
+  return sizeof(hotspot_grid_header_t);
+}
+
+/**
+ * @brief Size of the file described by a header
+ */
+static inline uint64_t hotspot_grid_size(const hotspot_grid_header_t *h) {
+  return hotspot_grid_values_at(h) +
+         h->rows * h->cols * hotspot_grid_value_size(h);
+}
+
+/**
+ * @brief Whether the header starts a file of size bytes that this version
+ * reads. The number of cells is bounded before hotspot_grid_size multiplies
+ * it, so that a crafted header cannot wrap the size around
+ */
+static inline int hotspot_grid_valid(const hotspot_grid_header_t *h,
+                                     uint64_t size) {
+  return size >= sizeof(*h) &&
+         !memcmp(h->magic, HOTSPOT_GRID_MAGIC, sizeof(h->magic)) &&
+         h->version == HOTSPOT_GRID_VERSION &&
+         (h->type == HOTSPOT_GRID_F64 || h->type == HOTSPOT_GRID_F32) &&
+         h->rows > 0 && h->cols > 0 && h->rows < (1ULL << 31) &&
+         h->cols < (1ULL << 31) &&
+         h->rows <= (UINT64_MAX - sizeof(*h)) / sizeof(double) / h->cols &&
+         hotspot_grid_size(h) == size;
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <time.h>
 
 #include "common.h"
+#include "BenchmarksAlloc.h"
 
 void stopwatch_start(stopwatch *sw) {
   if (sw == NULL)
@@ -50,7 +51,7 @@ func_ret_t create_matrix_from_file(float **mp, const char *filename,
 
   fscanf(fp, "%d\n", &size);
 
-  m = (float *)malloc(sizeof(float) * size * size);
+  m = (float *)bench_malloc(sizeof(float) * size * size);
   if (m == NULL) {
     fclose(fp);
     return RET_FAILURE;
@@ -76,13 +77,13 @@ func_ret_t create_matrix_from_random(float **mp, int size) {
 
   srand(time(NULL));
 
-  l = (float *)malloc(size * size * sizeof(float));
+  l = (float *)bench_malloc(size * size * sizeof(float));
   if (l == NULL)
     return RET_FAILURE;
 
-  u = (float *)malloc(size * size * sizeof(float));
+  u = (float *)bench_malloc(size * size * sizeof(float));
   if (u == NULL) {
-    free(l);
+    bench_free(l);
     return RET_FAILURE;
   }
 
@@ -115,8 +116,8 @@ func_ret_t create_matrix_from_random(float **mp, int size) {
     }
   }
 
-  free(l);
-  free(u);
+  bench_free(l);
+  bench_free(u);
 
   *mp = m;
 
@@ -134,7 +135,7 @@ void matrix_multiply(float *inputa, float *inputb, float *output, int size) {
 
 func_ret_t lud_verify(float *m, float *lu, int matrix_dim) {
   int i, j, k;
-  float *tmp = (float *)malloc(matrix_dim * matrix_dim * sizeof(float));
+  float *tmp = (float *)bench_malloc(matrix_dim * matrix_dim * sizeof(float));
   func_ret_t rc = RET_SUCCESS;
   
   for (i = 0; i < matrix_dim; i++)
@@ -181,13 +182,13 @@ func_ret_t lud_verify(float *m, float *lu, int matrix_dim) {
       rc = RET_FAILURE;
     }
   }
-  free(tmp);
+  bench_free(tmp);
   return rc;
 }
 
 void matrix_duplicate(float *src, float **dst, int matrix_dim) {
   int s = matrix_dim * matrix_dim * sizeof(float);
-  float *p = (float *)malloc(s);
+  float *p = (float *)bench_malloc(s);
   memcpy(p, src, s);
   *dst = p;
 }
@@ -218,7 +219,7 @@ func_ret_t create_matrix(float **mp, int size) {
     coe[j] = coe_i;
   }
 
-  m = (float *)malloc(sizeof(float) * size * size);
+  m = (float *)bench_malloc(sizeof(float) * size * size);
   if (m == NULL) {
     return RET_FAILURE;
   }
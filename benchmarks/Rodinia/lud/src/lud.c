@@ -126,11 +126,13 @@ int main(int argc, char *argv[]) {
   lud_omp_cpu(m_cpu, matrix_dim);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", matrix_dim, t_end - t_start);
 
   t_start = rtclock();
   lud_omp_gpu(m_gpu, matrix_dim);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, matrix_dim, t_end - t_start);
 
   stopwatch_stop(&sw);
   printf("Time consumed(ms): %lf\n", 1000 * get_interval_by_sec(&sw));
@@ -141,11 +143,11 @@ int main(int argc, char *argv[]) {
     printf(">>>Verify<<<<\n");
     lud_verify(mm, m_cpu, matrix_dim);
     lud_verify(mm, m_gpu, matrix_dim);
-    free(mm);
+    bench_free(mm);
   }
 
-  free(m_cpu);
-  free(m_gpu);
+  bench_free(m_cpu);
+  bench_free(m_gpu);
 
   return EXIT_SUCCESS;
 } /* ----------  end of function main  ---------- */
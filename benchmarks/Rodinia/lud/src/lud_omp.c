@@ -3,6 +3,8 @@
 #include <omp.h>
 #endif
 
+#include "BenchmarksPhases.h"
+
 void lud_omp_cpu(float *a, int size) {
   int i, j, k;
   float sum;
@@ -28,24 +30,31 @@ void lud_omp_gpu(float *a, int size) {
   int i, j, k;
   float sum;
 
-  #pragma omp target data map(tofrom : a[0 : size *size])
-  {
-    for (i = 0; i < size; i++) {
-      #pragma omp target teams distribute parallel for
-      for (j = i; j < size; j++) {
-        sum = a[i * size + j];
-        for (k = 0; k < i; k++)
-          sum -= a[i * size + k] * a[k * size + j];
-        a[i * size + j] = sum;
-      }
-
-      #pragma omp target teams distribute parallel for
-      for (j = i + 1; j < size; j++) {
-        sum = a[j * size + i];
-        for (k = 0; k < i; k++)
-          sum -= a[j * size + k] * a[k * size + i];
-        a[j * size + i] = sum / a[i * size + i];
-      }
+  bench_phase_start();
+  #pragma omp target enter data map(to : a[0 : size *size])
+  bench_phase_stop(BENCH_PHASE_H2D, size * size * sizeof(float));
+
+  bench_phase_start();
+  for (i = 0; i < size; i++) {
+    #pragma omp target teams distribute parallel for
+    for (j = i; j < size; j++) {
+      sum = a[i * size + j];
+      for (k = 0; k < i; k++)
+        sum -= a[i * size + k] * a[k * size + j];
+      a[i * size + j] = sum;
+    }
+
+    #pragma omp target teams distribute parallel for
+    for (j = i + 1; j < size; j++) {
+      sum = a[j * size + i];
+      for (k = 0; k < i; k++)
+        sum -= a[j * size + k] * a[k * size + i];
+      a[j * size + i] = sum / a[i * size + i];
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+  #pragma omp target exit data map(from : a[0 : size *size])
+  bench_phase_stop(BENCH_PHASE_D2H, size * size * sizeof(float));
 }
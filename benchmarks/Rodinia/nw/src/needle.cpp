@@ -160,6 +160,12 @@ void init(int *input_itemsets_cpu, int *input_itemsets_gpu, int *referrence_cpu,
 void runTest_GPU(int max_cols, int max_rows, int *input_itemsets,
                  int *referrence, int penalty) {
   int index, i, idx;
+  bench_phase_start();
+#pragma omp target enter data map(to : referrence[0 : max_rows *max_cols],     \
+                                         input_itemsets[0 : max_rows *max_cols])
+  bench_phase_stop(BENCH_PHASE_H2D, 2 * max_rows * max_cols * sizeof(int));
+
+  bench_phase_start();
 #pragma omp target map(to : referrence[0 : max_rows *max_cols])                \
   map(tofrom : input_itemsets[0 : max_rows *max_cols]) //device(DEVICE_ID)
   {
@@ -207,6 +213,12 @@ void runTest_GPU(int max_cols, int max_rows, int *input_itemsets,
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : input_itemsets[0 : max_rows *max_cols]) \
+                                 map(release : referrence[0 : max_rows *max_cols])
+  bench_phase_stop(BENCH_PHASE_D2H, max_rows * max_cols * sizeof(int));
 }
 
 void runTest_CPU(int max_cols, int max_rows, int *input_itemsets,
@@ -350,11 +362,11 @@ int main(int argc, char **argv) {
   max_rows = max_rows + 1;
   max_cols = max_cols + 1;
 
-  input_itemsets_cpu = (int *)malloc(max_rows * max_cols * sizeof(int));
-  input_itemsets_gpu = (int *)malloc(max_rows * max_cols * sizeof(int));
+  input_itemsets_cpu = (int *)bench_malloc(max_rows * max_cols * sizeof(int));
+  input_itemsets_gpu = (int *)bench_malloc(max_rows * max_cols * sizeof(int));
 
-  referrence_cpu = (int *)malloc(max_rows * max_cols * sizeof(int));
-  referrence_gpu = (int *)malloc(max_rows * max_cols * sizeof(int));
+  referrence_cpu = (int *)bench_malloc(max_rows * max_cols * sizeof(int));
+  referrence_gpu = (int *)bench_malloc(max_rows * max_cols * sizeof(int));
 
   if (!input_itemsets_cpu)
     fprintf(stderr, "error: can not allocate memory");
@@ -368,18 +380,20 @@ int main(int argc, char **argv) {
   runTest(input_itemsets_cpu, referrence_cpu, max_rows, max_cols, penalty, 0);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", max_rows, t_end - t_start);
 
   t_start = rtclock();
   runTest(input_itemsets_gpu, referrence_gpu, max_rows, max_cols, penalty, 1);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, max_rows, t_end - t_start);
 
   compareResults(input_itemsets_cpu, input_itemsets_gpu, max_rows, max_cols);
 
-  free(input_itemsets_cpu);
-  free(input_itemsets_gpu);
-  free(referrence_cpu);
-  free(referrence_gpu);
+  bench_free(input_itemsets_cpu);
+  bench_free(input_itemsets_gpu);
+  bench_free(referrence_cpu);
+  bench_free(referrence_gpu);
 
   return EXIT_SUCCESS;
 }
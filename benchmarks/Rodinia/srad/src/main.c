@@ -164,7 +164,7 @@ int main(int argc, char *argv[]) {
   image_ori_cols = 458;
   image_ori_elem = image_ori_rows * image_ori_cols;
 
-  image_ori = (fp *)malloc(sizeof(fp) * image_ori_elem);
+  image_ori = (fp *)bench_malloc(sizeof(fp) * image_ori_elem);
 
   read_graphics("../input/image.pgm", image_ori, image_ori_rows, image_ori_cols,
                 1);
@@ -177,8 +177,8 @@ int main(int argc, char *argv[]) {
 
   Ne = Nr * Nc;
 
-  image = (fp *)malloc(sizeof(fp) * Ne);
-  image_cpu = (fp *)malloc(sizeof(fp) * Ne);
+  image = (fp *)bench_malloc(sizeof(fp) * Ne);
+  image_cpu = (fp *)bench_malloc(sizeof(fp) * Ne);
 
   resize(image_ori, image_ori_rows, image_ori_cols, image, image_cpu, Nr, Nc,
          1);
@@ -198,19 +198,19 @@ int main(int argc, char *argv[]) {
   NeROI = (r2 - r1 + 1) * (c2 - c1 + 1); // number of elements in ROI, ROI size
 
   // allocate variables for surrounding pixels
-  iN = malloc(sizeof(int *) * Nr); // north surrounding element
-  iS = malloc(sizeof(int *) * Nr); // south surrounding element
-  jW = malloc(sizeof(int *) * Nc); // west surrounding element
-  jE = malloc(sizeof(int *) * Nc); // east surrounding element
+  iN = bench_malloc(sizeof(int *) * Nr); // north surrounding element
+  iS = bench_malloc(sizeof(int *) * Nr); // south surrounding element
+  jW = bench_malloc(sizeof(int *) * Nc); // west surrounding element
+  jE = bench_malloc(sizeof(int *) * Nc); // east surrounding element
 
   // allocate variables for directional derivatives
-  dN = malloc(sizeof(fp) * Ne); // north direction derivative
-  dS = malloc(sizeof(fp) * Ne); // south direction derivative
-  dW = malloc(sizeof(fp) * Ne); // west direction derivative
-  dE = malloc(sizeof(fp) * Ne); // east direction derivative
+  dN = bench_malloc(sizeof(fp) * Ne); // north direction derivative
+  dS = bench_malloc(sizeof(fp) * Ne); // south direction derivative
+  dW = bench_malloc(sizeof(fp) * Ne); // west direction derivative
+  dE = bench_malloc(sizeof(fp) * Ne); // east direction derivative
 
   // allocate variable for diffusion coefficient
-  c = malloc(sizeof(fp) * Ne); // diffusion coefficient
+  c = bench_malloc(sizeof(fp) * Ne); // diffusion coefficient
 
   // N/S/W/E indices of surrounding pixels (every element of IMAGE)
   // #pragma omp parallel
@@ -351,100 +351,104 @@ int main(int argc, char *argv[]) {
 
   // GPU
   t_start = rtclock();
-#pragma omp target data map(                                            \
-                            to : iN[ : Nr], iS[ : Nr],                  \
-                            jW[ : Nc], jE[ : Nc]) map(                  \
-                                                      tofrom : dN[ : Ne], \
-                                                      dS[ : Ne],        \
-                                                      dW[ : Ne],        \
-                                                      dE[ : Ne],        \
-                                                      c[ : Ne], image[ : Ne])
-
-  {
-    for (iter = 0; iter < niter;
-         iter++) { // do for the number of iterations input parameter
-
-      // ROI statistics for entire ROI (single number for ROI)
-      sum = 0;
-      sum2 = 0;
-      for (i = r1; i <= r2; i++) {   // do for the range of rows in ROI
-        for (j = c1; j <= c2; j++) { // do for the range of columns in ROI
-          tmp = image[i + Nr * j];   // get coresponding value in IMAGE
-          sum += tmp;                // take corresponding value and add to sum
-          sum2 +=
-              tmp * tmp; // take square of corresponding value and add to sum2
-        }
+  bench_phase_start();
+#pragma omp target enter data map(                                             \
+    to : iN[ : Nr], iS[ : Nr], jW[ : Nc], jE[ : Nc], image[ : Ne])             \
+    map(alloc : dN[ : Ne], dS[ : Ne], dW[ : Ne], dE[ : Ne], c[ : Ne])
+  bench_phase_stop(BENCH_PHASE_H2D,
+                   2 * (Nr + Nc) * sizeof(int) + Ne * sizeof(fp));
+
+  bench_phase_start();
+  for (iter = 0; iter < niter;
+       iter++) { // do for the number of iterations input parameter
+
+    // ROI statistics for entire ROI (single number for ROI)
+    sum = 0;
+    sum2 = 0;
+    for (i = r1; i <= r2; i++) {   // do for the range of rows in ROI
+      for (j = c1; j <= c2; j++) { // do for the range of columns in ROI
+        tmp = image[i + Nr * j];   // get coresponding value in IMAGE
+        sum += tmp;                // take corresponding value and add to sum
+        sum2 +=
+            tmp * tmp; // take square of corresponding value and add to sum2
       }
-      meanROI = sum / NeROI; // gets mean (average) value of element in ROI
-      varROI = (sum2 / NeROI) - meanROI * meanROI; // gets variance of ROI
-      q0sqr = varROI / (meanROI * meanROI); // gets standard deviation of ROI
-
-      // directional derivatives, ICOV, diffusion coefficent
-      #pragma omp target teams distribute parallel for collapse(2)
-      for (j = 0; j < Nc; j++) {   // do for the range of columns in IMAGE
-        for (i = 0; i < Nr; i++) { // do for the range of rows in IMAGE
-          // current index/pixel
-          k = i + Nr * j; // get position of current element
-          Jc = image[k];  // get value of the current element
-
-          // directional derivates (every element of IMAGE)
-          dN[k] = image[iN[i] + Nr * j] - Jc; // north direction derivative
-          dS[k] = image[iS[i] + Nr * j] - Jc; // south direction derivative
-          dW[k] = image[i + Nr * jW[j]] - Jc; // west direction derivative
-          dE[k] = image[i + Nr * jE[j]] - Jc; // east direction derivative
-
-          // normalized discrete gradient mag squared (equ 52,53)
-          G2 = (dN[k] * dN[k] + dS[k] * dS[k] // gradient (based on derivatives)
-                + dW[k] * dW[k] + dE[k] * dE[k]) /
-               (Jc * Jc);
-
-          // normalized discrete laplacian (equ 54)
-          L = (dN[k] + dS[k] + dW[k] + dE[k]) /
-              Jc; // laplacian (based on derivatives)
-
-          // ICOV (equ 31/35)
-          num = (0.5 * G2) - ((1.0 / 16.0) *
-                              (L * L)); // num (based on gradient and laplacian)
-          den = 1 + (.25 * L);          // den (based on laplacian)
-          qsqr = num / (den * den);     // qsqr (based on num and den)
-
-          // diffusion coefficent (equ 33) (every element of IMAGE)
-          den = (qsqr - q0sqr) /
-                (q0sqr * (1 + q0sqr)); // den (based on qsqr and q0sqr)
-          c[k] = 1.0 / (1.0 + den);    // diffusion coefficient (based on den)
-
-          // saturate diffusion coefficent to 0-1 range
-          if (c[k] < 0) // if diffusion coefficient < 0
-          {
-            c[k] = 0;          // ... set to 0
-          } else if (c[k] > 1) // if diffusion coefficient > 1
-          {
-            c[k] = 1; // ... set to 1
-          }
+    }
+    meanROI = sum / NeROI; // gets mean (average) value of element in ROI
+    varROI = (sum2 / NeROI) - meanROI * meanROI; // gets variance of ROI
+    q0sqr = varROI / (meanROI * meanROI); // gets standard deviation of ROI
+
+    // directional derivatives, ICOV, diffusion coefficent
+    #pragma omp target teams distribute parallel for collapse(2)
+    for (j = 0; j < Nc; j++) {   // do for the range of columns in IMAGE
+      for (i = 0; i < Nr; i++) { // do for the range of rows in IMAGE
+        // current index/pixel
+        k = i + Nr * j; // get position of current element
+        Jc = image[k];  // get value of the current element
+
+        // directional derivates (every element of IMAGE)
+        dN[k] = image[iN[i] + Nr * j] - Jc; // north direction derivative
+        dS[k] = image[iS[i] + Nr * j] - Jc; // south direction derivative
+        dW[k] = image[i + Nr * jW[j]] - Jc; // west direction derivative
+        dE[k] = image[i + Nr * jE[j]] - Jc; // east direction derivative
+
+        // normalized discrete gradient mag squared (equ 52,53)
+        G2 = (dN[k] * dN[k] + dS[k] * dS[k] // gradient (based on derivatives)
+              + dW[k] * dW[k] + dE[k] * dE[k]) /
+             (Jc * Jc);
+
+        // normalized discrete laplacian (equ 54)
+        L = (dN[k] + dS[k] + dW[k] + dE[k]) /
+            Jc; // laplacian (based on derivatives)
+
+        // ICOV (equ 31/35)
+        num = (0.5 * G2) - ((1.0 / 16.0) *
+                            (L * L)); // num (based on gradient and laplacian)
+        den = 1 + (.25 * L);          // den (based on laplacian)
+        qsqr = num / (den * den);     // qsqr (based on num and den)
+
+        // diffusion coefficent (equ 33) (every element of IMAGE)
+        den = (qsqr - q0sqr) /
+              (q0sqr * (1 + q0sqr)); // den (based on qsqr and q0sqr)
+        c[k] = 1.0 / (1.0 + den);    // diffusion coefficient (based on den)
+
+        // saturate diffusion coefficent to 0-1 range
+        if (c[k] < 0) // if diffusion coefficient < 0
+        {
+          c[k] = 0;          // ... set to 0
+        } else if (c[k] > 1) // if diffusion coefficient > 1
+        {
+          c[k] = 1; // ... set to 1
         }
       }
+    }
 
-      #pragma omp target teams distribute parallel for collapse(2)
-      for (j = 0; j < Nc; j++) { // do for the range of columns in IMAGE
-        for (i = 0; i < Nr; i++) { // do for the range of rows in IMAGE
-          // current index
-          k = i + Nr * j; // get position of current element
+    #pragma omp target teams distribute parallel for collapse(2)
+    for (j = 0; j < Nc; j++) { // do for the range of columns in IMAGE
+      for (i = 0; i < Nr; i++) { // do for the range of rows in IMAGE
+        // current index
+        k = i + Nr * j; // get position of current element
 
-          // diffusion coefficent
-          cN = c[k];              // north diffusion coefficient
-          cS = c[iS[i] + Nr * j]; // south diffusion coefficient
-          cW = c[k];              // west diffusion coefficient
-          cE = c[i + Nr * jE[j]]; // east diffusion coefficient
+        // diffusion coefficent
+        cN = c[k];              // north diffusion coefficient
+        cS = c[iS[i] + Nr * j]; // south diffusion coefficient
+        cW = c[k];              // west diffusion coefficient
+        cE = c[i + Nr * jE[j]]; // east diffusion coefficient
 
-          // divergence (equ 58)
-          D = cN * dN[k] + cS * dS[k] + cW * dW[k] + cE * dE[k]; // divergence
+        // divergence (equ 58)
+        D = cN * dN[k] + cS * dS[k] + cW * dW[k] + cE * dE[k]; // divergence
 
-          // image update (equ 61) (every element of IMAGE)
-          image[k] = image[k] + 0.25 * lambda * D; // updates image (based on input time step and divergence)
-        }
+        // image update (equ 61) (every element of IMAGE)
+        image[k] = image[k] + 0.25 * lambda * D; // updates image (based on input time step and divergence)
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : image[ : Ne])                          \
+    map(release : iN[ : Nr], iS[ : Nr], jW[ : Nc], jE[ : Nc], dN[ : Ne],       \
+                  dS[ : Ne], dW[ : Ne], dE[ : Ne], c[ : Ne])
+  bench_phase_stop(BENCH_PHASE_D2H, Ne * sizeof(fp));
   t_end = rtclock();
   t_gpu = t_end - t_start;
 
@@ -477,17 +481,17 @@ int main(int argc, char *argv[]) {
   // 	DEALLOCATE
   //================================================================================80
 
-  free(image_ori);
+  bench_free(image_ori);
 
-  free(iN);
-  free(iS);
-  free(jW);
-  free(jE); // deallocate surrounding pixel memory
-  free(dN);
-  free(dS);
-  free(dW);
-  free(dE); // deallocate directional derivative memory
-  free(c);  // deallocate diffusion coefficient memory
+  bench_free(iN);
+  bench_free(iS);
+  bench_free(jW);
+  bench_free(jE); // deallocate surrounding pixel memory
+  bench_free(dN);
+  bench_free(dS);
+  bench_free(dW);
+  bench_free(dE); // deallocate directional derivative memory
+  bench_free(c);  // deallocate diffusion coefficient memory
 
   time10 = get_time();
 
@@ -527,12 +531,14 @@ int main(int argc, char *argv[]) {
 
   printf("\n\n");
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_gpu);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, Nr, t_gpu);
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_cpu);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", Nr, t_cpu);
 
   compareResults(image, image_cpu, Ne);
 
-  free(image);
-  free(image_cpu);
+  bench_free(image);
+  bench_free(image_cpu);
   //====================================================================================================100
   //	END OF FILE
   //====================================================================================================100
@@ -0,0 +1,186 @@
+/**
+ * peak.c: Machine balance probe for the roofline model.
+ *
+ * Measures the sustainable memory bandwidth with a STREAM-like triad
+ * (a = b + s * c) and the peak floating point throughput with independent
+ * chains of multiply-adds, on the same device and with the same compiler flags
+ * as the kernels. The achieved GB/s and GFLOP/s are the ceilings against which
+ * the Roofline lines of the other benchmarks are read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "BenchmarksUtil.h"
+
+/** Elements of each triad array */
+#define N ((size_t)SIZE * SIZE)
+/** Independent accumulator chains per work item, enough to hide FMA latency */
+#define CHAINS 16
+/** Multiply-add rounds per chain */
+#define ROUNDS 1024
+/** Work items of the compute probe */
+#define ITEMS 4096
+
+typedef double DATA_TYPE;
+
+/** Analytic FLOP count and compulsory memory traffic (bytes) of each probe */
+#define TRIAD_FLOPS (2.0 * N)
+#define TRIAD_BYTES (3.0 * N * sizeof(DATA_TYPE))
+#define FMA_FLOPS (2.0 * CHAINS * ROUNDS * ITEMS)
+#define FMA_BYTES (ITEMS * sizeof(DATA_TYPE))
+
+/**
+ * @brief Same as __BENCHMARK, for a named probe. The probe name is appended to
+ * the kernel name of the result record, and its ceiling is attached as a field
+ */
+#define PEAK_BENCHMARK(PROBE, CEILING, DEVICE, FUNC_CALL)                      \
+  {                                                                            \
+    bench_run_t __run;                                                         \
+    for (bench_run_begin(&__run, BENCH_KERNEL "/" PROBE, DEVICE, SIZE);        \
+         bench_run_next(&__run);) {                                            \
+      bench_iter_start(&__run);                                                \
+      FUNC_CALL;                                                               \
+      bench_iter_stop(&__run);                                                 \
+    }                                                                          \
+    bench_result_add_str(&__run.result, "ceiling", CEILING);                   \
+    bench_run_end(&__run);                                                     \
+  }
+
+void init_arrays(DATA_TYPE *b, DATA_TYPE *c) {
+  for (size_t i = 0; i < N; i++) {
+    b[i] = (DATA_TYPE)(i % SIZE) / SIZE;
+    c[i] = (DATA_TYPE)(i / SIZE) / SIZE;
+  }
+}
+
+int compareResults(DATA_TYPE *a, DATA_TYPE *a_OMP, size_t n) {
+  int fail = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    if (percentDiff(a[i], a_OMP[i]) > ERROR_THRESHOLD) {
+      fail++;
+    }
+  }
+
+  return fail;
+}
+
+void triad(DATA_TYPE *a, DATA_TYPE *b, DATA_TYPE *c, DATA_TYPE s) {
+  for (size_t i = 0; i < N; i++) {
+    a[i] = b[i] + s * c[i];
+  }
+}
+
+void fma_chains(DATA_TYPE *out, DATA_TYPE mul, DATA_TYPE add) {
+  for (int item = 0; item < ITEMS; item++) {
+    DATA_TYPE acc[CHAINS];
+    for (int k = 0; k < CHAINS; k++) {
+      acc[k] = item + k;
+    }
+    for (int r = 0; r < ROUNDS; r++) {
+      for (int k = 0; k < CHAINS; k++) {
+        acc[k] = acc[k] * mul + add;
+      }
+    }
+    DATA_TYPE sum = 0;
+    for (int k = 0; k < CHAINS; k++) {
+      sum += acc[k];
+    }
+    out[item] = sum;
+  }
+}
+
+void triad_OMP(DATA_TYPE *a, DATA_TYPE *b, DATA_TYPE *c, DATA_TYPE s) {
+  // the arrays are already present on the device, nothing is transferred
+  #pragma omp target teams distribute parallel for map(to: b[:N], c[:N]) map(from: a[:N]) device(OMP_DEVICE_ID)
+  for (size_t i = 0; i < N; i++) {
+    a[i] = b[i] + s * c[i];
+  }
+}
+
+void fma_chains_OMP(DATA_TYPE *out, DATA_TYPE mul, DATA_TYPE add) {
+  #pragma omp target teams distribute parallel for map(from: out[:ITEMS]) device(OMP_DEVICE_ID)
+  for (int item = 0; item < ITEMS; item++) {
+    DATA_TYPE acc[CHAINS];
+    for (int k = 0; k < CHAINS; k++) {
+      acc[k] = item + k;
+    }
+    for (int r = 0; r < ROUNDS; r++) {
+      for (int k = 0; k < CHAINS; k++) {
+        acc[k] = acc[k] * mul + add;
+      }
+    }
+    DATA_TYPE sum = 0;
+    for (int k = 0; k < CHAINS; k++) {
+      sum += acc[k];
+    }
+    out[item] = sum;
+  }
+}
+
+int main() {
+  SALUTE("Roofline: peak memory bandwidth and floating point throughput");
+
+  // scalars read at run time, so that the compute chains cannot be folded
+  volatile DATA_TYPE s = 3.0, mul = 0.999999, add = 1e-6;
+
+  // declare arrays and allocate memory
+  DATA_TYPE *b = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *c = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  DATA_TYPE *a = NULL, *out = NULL;
+  DATA_TYPE *a_OMP = NULL, *out_OMP = NULL;
+
+  // initialize arrays
+  init_arrays(b, c);
+
+// run OMP on GPU or CPU if enabled
+#if defined(RUN_OMP_GPU) || defined(RUN_OMP_CPU)
+  a_OMP = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  out_OMP = (DATA_TYPE *)bench_malloc(ITEMS * sizeof(DATA_TYPE));
+  #pragma omp target enter data map(to: b[:N], c[:N]) map(alloc: a_OMP[:N]) device(OMP_DEVICE_ID)
+  bench_work(TRIAD_FLOPS, TRIAD_BYTES);
+  PEAK_BENCHMARK("triad", "memory", __OMP_DEVICE_NAME,
+                 triad_OMP(a_OMP, b, c, s));
+  #pragma omp target exit data map(from: a_OMP[:N]) map(release: b[:N], c[:N]) device(OMP_DEVICE_ID)
+  bench_work(FMA_FLOPS, FMA_BYTES);
+  PEAK_BENCHMARK("fma", "compute", __OMP_DEVICE_NAME,
+                 fma_chains_OMP(out_OMP, mul, add));
+  // prevent dead code elimination
+  DCE_PREVENT(a_OMP, N);
+  DCE_PREVENT(out_OMP, ITEMS);
+#endif
+
+// run sequential version if enabled
+#ifdef RUN_CPU_SEQ
+  a = (DATA_TYPE *)bench_malloc(N * sizeof(DATA_TYPE));
+  out = (DATA_TYPE *)bench_malloc(ITEMS * sizeof(DATA_TYPE));
+  bench_work(TRIAD_FLOPS, TRIAD_BYTES);
+  PEAK_BENCHMARK("triad", "memory", "CPU", triad(a, b, c, s));
+  bench_work(FMA_FLOPS, FMA_BYTES);
+  PEAK_BENCHMARK("fma", "compute", "CPU", fma_chains(out, mul, add));
+  // prevent dead code elimination
+  DCE_PREVENT(a, N);
+  DCE_PREVENT(out, ITEMS);
+#endif
+
+  int fail = 0;
+// if test mode enabled, compare the results
+#ifdef RUN_TEST
+  fail = compareResults(a, a_OMP, N) + compareResults(out, out_OMP, ITEMS);
+  printf("Errors on OMP (threshold %4.2lf): %d\n", ERROR_THRESHOLD, fail);
+#endif
+
+  // Release memory
+  bench_free(a);
+  bench_free(b);
+  bench_free(c);
+  bench_free(out);
+  bench_free(a_OMP);
+  bench_free(out_OMP);
+
+  return fail;
+}
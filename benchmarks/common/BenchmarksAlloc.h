@@ -0,0 +1,297 @@
+// BenchmarksAlloc.h
+// Aligned, huge-page backed and NUMA-placed buffers for the benchmark data.
+//
+// Kernels allocate their buffers with bench_malloc or bench_calloc, which
+// both return zeroed memory, and release them with bench_free:
+//
+//   float *A = (float *)bench_malloc(n * sizeof(float));
+//   ...
+//   bench_free(A);
+//
+// Every buffer is aligned to BENCH_ALIGN bytes (64 by default, a cache line).
+// Buffers of at least BENCH_ALLOC_MAP_MIN bytes are mapped on their own, so
+// they are also page aligned and placed with the NUMA policy of the run (see
+// BenchmarksNuma.h), and BENCH_HUGEPAGES backs them with huge pages:
+//
+//   none     the default, base pages
+//   thp      transparent huge pages, madvise(MADV_HUGEPAGE) on a mapping
+//            aligned to BENCH_HUGE_PAGE
+//   hugetlb  pages of the hugetlbfs pool (MAP_HUGETLB), which has to be
+//            reserved beforehand in /proc/sys/vm/nr_hugepages. Falls back to
+//            thp, with a warning, when the pool runs out
+//
+//   BENCH_HUGEPAGES=thp BENCH_ALIGN=4096 ./omp_cpu_LARGE
+//
+// bench_free also releases memory from malloc, so pointers of either origin
+// can be passed to it. The records carry the alignment and the huge pages in
+// their "align" and "hugepages" fields.
+
+#ifndef BENCHMARKS_ALLOC_H
+#define BENCHMARKS_ALLOC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "BenchmarksNuma.h"
+#include "BenchmarksResults.h"
+
+/** Alignment of the buffers in bytes, a power of two */
+#ifndef BENCH_ALIGN
+#define BENCH_ALIGN 64
+#endif
+
+/** Huge pages used when BENCH_HUGEPAGES is unset */
+#ifndef BENCH_HUGEPAGES
+#define BENCH_HUGEPAGES "none"
+#endif
+
+/** Size of a huge page */
+#ifndef BENCH_HUGE_PAGE
+#define BENCH_HUGE_PAGE (2UL << 20)
+#endif
+
+/** Smallest buffer mapped on its own, smaller ones come from the heap */
+#ifndef BENCH_ALLOC_MAP_MIN
+#define BENCH_ALLOC_MAP_MIN (64UL << 10)
+#endif
+
+typedef enum {
+  BENCH_HUGEPAGES_NONE,
+  BENCH_HUGEPAGES_THP,
+  BENCH_HUGEPAGES_HUGETLB,
+  BENCH_N_HUGEPAGES
+} bench_hugepages_t;
+
+static const char *bench_hugepages_names[BENCH_N_HUGEPAGES] = {"none", "thp",
+                                                               "hugetlb"};
+
+/**
+ * @brief A buffer mapped on its own
+ */
+typedef struct {
+  void *ptr;
+  size_t len;
+} bench_mapping_t;
+
+/**
+ * @brief Settings of the run, read from the environment by the first
+ * allocation, and the buffers mapped so far. Weak, so that every translation
+ * unit of a benchmark shares the same instance
+ */
+typedef struct {
+  int loaded;
+  size_t align;
+  bench_hugepages_t hugepages;
+  size_t allocs;
+  bench_mapping_t *maps;
+  size_t n_maps, cap_maps;
+} bench_alloc_t;
+
+__attribute__((weak)) bench_alloc_t bench_alloc_state;
+
+/**
+ * @brief Reads BENCH_ALIGN and BENCH_HUGEPAGES. Exits on invalid values
+ */
+static inline void bench_alloc_load(void) {
+  bench_alloc_t *a = &bench_alloc_state;
+  if (a->loaded)
+    return;
+
+  const char *env = getenv("BENCH_ALIGN");
+  a->align = (env && *env) ? strtoul(env, NULL, 10) : BENCH_ALIGN;
+  if (a->align < sizeof(void *) || (a->align & (a->align - 1))) {
+    fprintf(stderr, "Invalid BENCH_ALIGN %zu, expected a power of two\n",
+            a->align);
+    exit(EXIT_FAILURE);
+  }
+
+  env = getenv("BENCH_HUGEPAGES");
+  if (!env || !*env)
+    env = BENCH_HUGEPAGES;
+  int h = 0;
+  while (h < BENCH_N_HUGEPAGES && strcmp(env, bench_hugepages_names[h]))
+    h++;
+  if (h == BENCH_N_HUGEPAGES) {
+    fprintf(stderr, "Unknown BENCH_HUGEPAGES %s, options:", env);
+    for (int i = 0; i < BENCH_N_HUGEPAGES; i++)
+      fprintf(stderr, " %s", bench_hugepages_names[i]);
+    fputc('\n', stderr);
+    exit(EXIT_FAILURE);
+  }
+  a->hugepages = (bench_hugepages_t)h;
+  a->loaded = 1;
+}
+
+#ifdef __linux__
+/**
+ * @brief Maps len bytes aligned to align, a multiple of the page size, by
+ * mapping align bytes more and trimming both ends
+ */
+static inline char *bench_map_aligned(size_t len, size_t align) {
+  char *raw = (char *)mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return NULL;
+
+  uintptr_t mask = (uintptr_t)(align - 1);
+  char *base = (char *)(((uintptr_t)raw + mask) & ~mask);
+  if (base > raw)
+    munmap(raw, base - raw);
+  if (raw + align > base)
+    munmap(base + len, raw + align - base);
+  return base;
+}
+
+/**
+ * @brief Maps a buffer of at least bytes with the settings of the run, and
+ * returns its length in len
+ */
+static inline char *bench_map(size_t bytes, size_t *len) {
+  bench_alloc_t *a = &bench_alloc_state;
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t align = a->align > page ? a->align : page;
+  char *base = NULL;
+
+  if (a->hugepages != BENCH_HUGEPAGES_NONE && bytes >= BENCH_HUGE_PAGE) {
+    *len = (bytes + BENCH_HUGE_PAGE - 1) & ~(BENCH_HUGE_PAGE - 1);
+    if (a->hugepages == BENCH_HUGEPAGES_HUGETLB) {
+      base = (char *)mmap(NULL, *len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (base == MAP_FAILED) {
+        fprintf(stderr, "No hugetlb pages left for %zu bytes, using thp\n",
+                *len);
+        a->hugepages = BENCH_HUGEPAGES_THP;
+        base = NULL;
+      }
+    }
+    if (!base) {
+      base = bench_map_aligned(
+          *len, align > BENCH_HUGE_PAGE ? align : BENCH_HUGE_PAGE);
+      if (base)
+        madvise(base, *len, MADV_HUGEPAGE);
+    }
+  } else {
+    *len = (bytes + page - 1) & ~(page - 1);
+    base = bench_map_aligned(*len, align);
+  }
+  return base;
+}
+#endif
+
+/**
+ * @brief Allocates bytes of zeroed memory, aligned to BENCH_ALIGN and, when
+ * mapped on its own, placed with the NUMA policy of the run. Released with
+ * bench_free
+ */
+static inline void *bench_malloc(size_t bytes) {
+  bench_alloc_t *a = &bench_alloc_state;
+  void *ptr = NULL;
+
+  bench_alloc_load();
+  if (!bytes)
+    bytes = 1;
+
+#ifdef __linux__
+  if (bytes >= BENCH_ALLOC_MAP_MIN) {
+    size_t len;
+    char *base = bench_map(bytes, &len);
+    if (!base)
+      return NULL;
+    bench_mem_place(base, len);
+
+    int ok = 1;
+    #pragma omp critical(bench_alloc)
+    {
+      if (a->n_maps == a->cap_maps) {
+        size_t cap = a->cap_maps ? 2 * a->cap_maps : 16;
+        bench_mapping_t *maps = (bench_mapping_t *)realloc(
+            a->maps, cap * sizeof(bench_mapping_t));
+        if (maps) {
+          a->maps = maps;
+          a->cap_maps = cap;
+        }
+      }
+      if (a->n_maps < a->cap_maps) {
+        a->maps[a->n_maps].ptr = base;
+        a->maps[a->n_maps].len = len;
+        a->n_maps++;
+        a->allocs++;
+      } else {
+        ok = 0;
+      }
+    }
+    if (!ok) {
+      munmap(base, len);
+      return NULL;
+    }
+    return base;
+  }
+#endif
+
+  size_t align = a->align > sizeof(void *) ? a->align : sizeof(void *);
+  if (posix_memalign(&ptr, align, bytes))
+    return NULL;
+  memset(ptr, 0, bytes);
+  #pragma omp atomic
+  a->allocs++;
+  return ptr;
+}
+
+/**
+ * @brief bench_malloc of n elements of size bytes
+ */
+static inline void *bench_calloc(size_t n, size_t size) {
+  if (size && n > (size_t)-1 / size)
+    return NULL;
+  return bench_malloc(n * size);
+}
+
+/**
+ * @brief Releases the memory of bench_malloc, bench_calloc or malloc. NULL is
+ * ignored
+ */
+static inline void bench_free(void *ptr) {
+  bench_alloc_t *a = &bench_alloc_state;
+  size_t len = 0;
+
+  if (!ptr)
+    return;
+
+  #pragma omp critical(bench_alloc)
+  {
+    for (size_t i = 0; i < a->n_maps; i++) {
+      if (a->maps[i].ptr == ptr) {
+        len = a->maps[i].len;
+        a->maps[i] = a->maps[--a->n_maps];
+        break;
+      }
+    }
+  }
+
+#ifdef __linux__
+  if (len) {
+    munmap(ptr, len);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+/**
+ * @brief Attaches the alignment and the huge pages of the buffers to a record,
+ * when the kernel allocated its data with bench_malloc
+ */
+static inline void bench_alloc_add_fields(bench_result_t *r) {
+  if (!bench_alloc_state.allocs)
+    return;
+  bench_result_add_num(r, "align", (double)bench_alloc_state.align);
+  bench_result_add_str(r, "hugepages",
+                       bench_hugepages_names[bench_alloc_state.hugepages]);
+}
+
+#endif
@@ -0,0 +1,175 @@
+// BenchmarksCache.h
+// Cache state in which the timed iterations start: cold, warm or steady.
+//
+// The BENCH_CACHE environment variable selects the measurement mode:
+//
+//   steady  the default: BENCH_WARMUP untimed iterations, then repetitions
+//           until the timings converge (see BenchmarksStats.h). Each iteration
+//           finds in cache whatever the previous one left there
+//   warm    at least one untimed warm-up iteration, then exactly
+//           BENCH_MIN_RUNS timed iterations, without the convergence loop
+//   cold    as steady, but the last level cache is evicted before every timed
+//           iteration, outside of the timed region
+//
+//   BENCH_CACHE=cold BENCH_MAX_RUNS=10 ./omp_cpu_MINI
+//
+// The eviction streams a buffer twice the combined capacity of the last level
+// caches of the host, read from sysfs, with all the OpenMP threads so that
+// every socket evicts its own cache. BENCH_FLUSH_BYTES sets another size. It
+// clears the host caches only; offloaded kernels keep their device memory.
+// The records carry the mode in their "cache" field.
+
+#ifndef BENCHMARKS_CACHE_H
+#define BENCHMARKS_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Mode used when BENCH_CACHE is unset */
+#ifndef BENCH_CACHE
+#define BENCH_CACHE "steady"
+#endif
+
+/** Eviction buffer used when the caches cannot be read from sysfs */
+#define BENCH_FLUSH_DEFAULT_BYTES (64UL << 20)
+
+typedef enum {
+  BENCH_CACHE_STEADY,
+  BENCH_CACHE_WARM,
+  BENCH_CACHE_COLD,
+  BENCH_N_CACHE_MODES
+} bench_cache_mode_t;
+
+static const char *bench_cache_names[BENCH_N_CACHE_MODES] = {"steady", "warm",
+                                                             "cold"};
+
+/**
+ * @brief Eviction buffer, allocated by the first flush. Weak, so that every
+ * translation unit of a benchmark shares the same instance
+ */
+typedef struct {
+  unsigned char *buf;
+  size_t bytes;
+} bench_flush_t;
+
+__attribute__((weak)) bench_flush_t bench_flush_state;
+
+/**
+ * @brief Mode selected by BENCH_CACHE. Exits if the name is unknown
+ */
+static inline bench_cache_mode_t bench_cache_mode(void) {
+  const char *env = getenv("BENCH_CACHE");
+  if (!env || !*env)
+    env = BENCH_CACHE;
+
+  int m = 0;
+  while (m < BENCH_N_CACHE_MODES && strcmp(env, bench_cache_names[m]))
+    m++;
+  if (m == BENCH_N_CACHE_MODES) {
+    fprintf(stderr, "Unknown BENCH_CACHE %s, options:", env);
+    for (int i = 0; i < BENCH_N_CACHE_MODES; i++)
+      fprintf(stderr, " %s", bench_cache_names[i]);
+    fputc('\n', stderr);
+    exit(EXIT_FAILURE);
+  }
+  return (bench_cache_mode_t)m;
+}
+
+/**
+ * @brief Reads one line of a sysfs file of cache index d of cpu0
+ */
+static inline int bench_cache_read(int d, const char *file, char *out,
+                                   int len) {
+  char path[96];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/%s",
+           d, file);
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return 0;
+  int ok = fgets(out, len, f) != NULL;
+  fclose(f);
+  out[strcspn(out, "\n")] = '\0';
+  return ok;
+}
+
+/**
+ * @brief Number of CPUs in a sysfs list such as "0-3,8-11"
+ */
+static inline long bench_count_cpus(const char *list) {
+  long n = 0;
+  while (*list) {
+    char *end;
+    long lo = strtol(list, &end, 10), hi = lo;
+    if (end == list)
+      break;
+    if (*end == '-')
+      hi = strtol(end + 1, &end, 10);
+    n += hi - lo + 1;
+    list = *end == ',' ? end + 1 : end;
+  }
+  return n;
+}
+
+/**
+ * @brief Combined capacity of the last level caches of the host in bytes: the
+ * size of the last level of cpu0, times the number of such caches over the
+ * online CPUs. Zero if sysfs has no cache information
+ */
+static inline size_t bench_llc_bytes(void) {
+  int level = 0;
+  size_t size = 0;
+  long sharers = 1;
+  char buf[256];
+
+  for (int d = 0; bench_cache_read(d, "level", buf, sizeof(buf)); d++) {
+    int l = atoi(buf);
+    char type[32];
+    if (l < level || !bench_cache_read(d, "type", type, sizeof(type)) ||
+        !strcmp(type, "Instruction") ||
+        !bench_cache_read(d, "size", buf, sizeof(buf)))
+      continue;
+
+    char *unit;
+    size = strtoul(buf, &unit, 10);
+    size <<= *unit == 'K' ? 10 : *unit == 'M' ? 20 : *unit == 'G' ? 30 : 0;
+    level = l;
+    sharers = bench_cache_read(d, "shared_cpu_list", buf, sizeof(buf))
+                  ? bench_count_cpus(buf)
+                  : 1;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (sharers < 1)
+    sharers = 1;
+  return cpus > sharers ? size * (size_t)((cpus + sharers - 1) / sharers)
+                        : size;
+}
+
+/**
+ * @brief Evicts the last level caches by writing every line of the eviction
+ * buffer, with the OpenMP threads in static chunks
+ */
+static inline void bench_cache_flush(void) {
+  bench_flush_t *f = &bench_flush_state;
+
+  if (!f->buf) {
+    const char *env = getenv("BENCH_FLUSH_BYTES");
+    f->bytes = (env && *env) ? strtoul(env, NULL, 10) : 2 * bench_llc_bytes();
+    if (!f->bytes)
+      f->bytes = BENCH_FLUSH_DEFAULT_BYTES;
+    f->buf = (unsigned char *)calloc(f->bytes, 1);
+    if (!f->buf)
+      return;
+  }
+
+  unsigned char *buf = f->buf;
+  long lines = (long)(f->bytes / 64);
+  #pragma omp parallel for schedule(static)
+  for (long i = 0; i < lines; i++) {
+    buf[i * 64]++;
+  }
+}
+
+#endif
@@ -0,0 +1,297 @@
+// BenchmarksCounters.h
+// Hardware performance counters around the timed region, via perf_event_open.
+//
+// Counting is off by default. The BENCH_COUNTERS environment variable selects
+// the events as a comma-separated list of names, where "default" (or "1")
+// stands for cycles, instructions, cache, TLB and branch misses. Events without
+// a portable definition, such as vector floating point operations, are given
+// as raw PMU encodings with name=r<hex>, e.g. on Intel Skylake and later
+//
+//   BENCH_COUNTERS=cycles,instructions,fp-vector=rfcc7 ./omp_cpu_LARGE
+//
+// Each thread of the OpenMP pool opens its own counters, and threads created
+// later are inherited, so the counts cover the whole process. Only user space
+// is counted, which works with the default perf_event_paranoid setting.
+
+#ifndef BENCHMARKS_COUNTERS_H
+#define BENCHMARKS_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "BenchmarksResults.h"
+
+/** Maximum number of events counted at once */
+#define BENCH_MAX_COUNTERS 16
+
+/** Maximum number of threads with their own counters */
+#define BENCH_MAX_COUNTER_THREADS 256
+
+/** Events counted by BENCH_COUNTERS=default */
+#define BENCH_COUNTERS_DEFAULT                                                 \
+  "cycles,instructions,l1d-misses,llc-misses,dtlb-misses,branch-misses"
+
+/**
+ * @brief One counted event. value is the count of the measured iterations,
+ * scaled up when the kernel multiplexed the event with others
+ */
+typedef struct {
+  char name[32];
+  uint32_t type;
+  uint64_t config;
+  int fd[BENCH_MAX_COUNTER_THREADS];
+  double value;
+} bench_counter_t;
+
+typedef struct {
+  size_t n;
+  int n_threads;
+  bench_counter_t counter[BENCH_MAX_COUNTERS];
+} bench_counters_t;
+
+#ifdef __linux__
+#define BENCH_HW_CACHE(cache, result)                                          \
+  ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+/**
+ * @brief Resolves an event name to its perf type and config
+ * @return int 0 on success, -1 for unknown names
+ */
+static inline int bench_counter_lookup(const char *name, uint32_t *type,
+                                       uint64_t *config) {
+  static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+  } events[] = {
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+      {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+      {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {"l1d-loads", PERF_TYPE_HW_CACHE,
+       BENCH_HW_CACHE(PERF_COUNT_HW_CACHE_L1D,
+                      PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+      {"l1d-misses", PERF_TYPE_HW_CACHE,
+       BENCH_HW_CACHE(PERF_COUNT_HW_CACHE_L1D,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"llc-loads", PERF_TYPE_HW_CACHE,
+       BENCH_HW_CACHE(PERF_COUNT_HW_CACHE_LL,
+                      PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+      {"llc-misses", PERF_TYPE_HW_CACHE,
+       BENCH_HW_CACHE(PERF_COUNT_HW_CACHE_LL,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"dtlb-misses", PERF_TYPE_HW_CACHE,
+       BENCH_HW_CACHE(PERF_COUNT_HW_CACHE_DTLB,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+  };
+
+  // raw PMU encoding, name=r<hex>
+  const char *raw = strchr(name, '=');
+  if (raw) {
+    if (raw[1] != 'r')
+      return -1;
+    *type = PERF_TYPE_RAW;
+    *config = strtoull(raw + 2, NULL, 16);
+    return 0;
+  }
+  for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+    if (!strcmp(name, events[i].name)) {
+      *type = events[i].type;
+      *config = events[i].config;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static inline int bench_counter_open(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief Reads a counter, scaled by the fraction of time it was scheduled
+ */
+static inline double bench_counter_read(int fd) {
+  uint64_t v[3];
+  if (read(fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+    return 0.0;
+  return (double)v[0] * ((double)v[1] / (double)v[2]);
+}
+
+/**
+ * @brief Appends the events of a comma-separated list. "default" expands to
+ * the default set
+ */
+static inline void bench_counters_parse(bench_counters_t *c, const char *env) {
+  char *list = strdup(env);
+  for (char *save, *name = strtok_r(list, ",", &save);
+       name && c->n < BENCH_MAX_COUNTERS; name = strtok_r(NULL, ",", &save)) {
+    if (!strcmp(name, "1") || !strcmp(name, "default")) {
+      bench_counters_parse(c, BENCH_COUNTERS_DEFAULT);
+      continue;
+    }
+    bench_counter_t *e = &c->counter[c->n];
+    if (bench_counter_lookup(name, &e->type, &e->config)) {
+      fprintf(stderr, "Unknown counter %s, ignored\n", name);
+      continue;
+    }
+    // the name of a raw event is the part before '='
+    snprintf(e->name, sizeof(e->name), "%.*s", (int)strcspn(name, "="), name);
+    c->n++;
+  }
+  free(list);
+}
+
+/**
+ * @brief Opens the events selected by BENCH_COUNTERS on every thread. Events
+ * that cannot be opened are reported and dropped
+ */
+static inline void bench_counters_open(bench_counters_t *c) {
+  memset(c, 0, sizeof(*c));
+  const char *env = getenv("BENCH_COUNTERS");
+  if (!env || !*env || !strcmp(env, "0"))
+    return;
+  bench_counters_parse(c, env);
+  if (c->n == 0)
+    return;
+
+#ifdef _OPENMP
+  c->n_threads = omp_get_max_threads();
+  if (c->n_threads > BENCH_MAX_COUNTER_THREADS)
+    c->n_threads = BENCH_MAX_COUNTER_THREADS;
+  #pragma omp parallel num_threads(c->n_threads)
+  {
+    int t = omp_get_thread_num();
+#else
+  c->n_threads = 1;
+  {
+    int t = 0;
+#endif
+    for (size_t i = 0; i < c->n; i++)
+      c->counter[i].fd[t] =
+          bench_counter_open(c->counter[i].type, c->counter[i].config);
+  }
+
+  // keep only the events that every thread could open
+  size_t n = 0;
+  for (size_t i = 0; i < c->n; i++) {
+    bench_counter_t *e = &c->counter[i];
+    int ok = 1;
+    for (int t = 0; t < c->n_threads; t++)
+      ok &= e->fd[t] >= 0;
+    if (!ok) {
+      fprintf(stderr, "Counter %s unavailable, ignored\n", e->name);
+      for (int t = 0; t < c->n_threads; t++)
+        if (e->fd[t] >= 0)
+          close(e->fd[t]);
+      continue;
+    }
+    c->counter[n++] = *e;
+  }
+  c->n = n;
+}
+
+static inline void bench_counters_ioctl(bench_counters_t *c,
+                                        unsigned long request) {
+  for (size_t i = 0; i < c->n; i++)
+    for (int t = 0; t < c->n_threads; t++)
+      ioctl(c->counter[i].fd[t], request, 0);
+}
+
+static inline void bench_counters_start(bench_counters_t *c) {
+  bench_counters_ioctl(c, PERF_EVENT_IOC_RESET);
+  bench_counters_ioctl(c, PERF_EVENT_IOC_ENABLE);
+}
+
+/**
+ * @brief Stops the counters and, for measured iterations, accumulates them
+ */
+static inline void bench_counters_stop(bench_counters_t *c, int measured) {
+  bench_counters_ioctl(c, PERF_EVENT_IOC_DISABLE);
+  if (!measured)
+    return;
+  for (size_t i = 0; i < c->n; i++)
+    for (int t = 0; t < c->n_threads; t++)
+      c->counter[i].value += bench_counter_read(c->counter[i].fd[t]);
+}
+
+static inline void bench_counters_close(bench_counters_t *c) {
+  for (size_t i = 0; i < c->n; i++)
+    for (int t = 0; t < c->n_threads; t++)
+      close(c->counter[i].fd[t]);
+  c->n = 0;
+}
+#else
+static inline void bench_counters_open(bench_counters_t *c) {
+  memset(c, 0, sizeof(*c));
+  if (getenv("BENCH_COUNTERS"))
+    fprintf(stderr, "Hardware counters are only supported on Linux\n");
+}
+static inline void bench_counters_start(bench_counters_t *c) {}
+static inline void bench_counters_stop(bench_counters_t *c, int measured) {}
+static inline void bench_counters_close(bench_counters_t *c) {}
+#endif
+
+/**
+ * @brief Value of a counter per iteration, or -1 if it is not counted
+ */
+static inline double bench_counters_get(const bench_counters_t *c,
+                                        const char *name, size_t n) {
+  for (size_t i = 0; i < c->n; i++)
+    if (!strcmp(c->counter[i].name, name))
+      return c->counter[i].value / n;
+  return -1.0;
+}
+
+/**
+ * @brief Prints the counters averaged over n iterations, with the derived
+ * instructions per cycle when both are counted
+ */
+static inline void bench_counters_print(FILE *out, const char *device,
+                                        const bench_counters_t *c, size_t n) {
+  fprintf(out, "%s Counters:", device);
+  for (size_t i = 0; i < c->n; i++)
+    fprintf(out, " %s=%.0lf", c->counter[i].name, c->counter[i].value / n);
+  double cycles = bench_counters_get(c, "cycles", n);
+  double instructions = bench_counters_get(c, "instructions", n);
+  if (cycles > 0.0 && instructions >= 0.0)
+    fprintf(out, " ipc=%0.3lf", instructions / cycles);
+  fputc('\n', out);
+}
+
+/**
+ * @brief Attaches the counters, averaged over n iterations, to a result record
+ */
+static inline void bench_counters_add_fields(bench_result_t *r,
+                                             const bench_counters_t *c,
+                                             size_t n) {
+  for (size_t i = 0; i < c->n; i++)
+    bench_result_add_num(r, c->counter[i].name, c->counter[i].value / n);
+}
+
+#endif
@@ -0,0 +1,223 @@
+// BenchmarksGemm.h
+// Cache-blocked, packed and register-tiled matrix multiply for the CPU.
+//
+// This is the BLOCKED variant of the matrix multiply kernels (2MM, 3MM, GEMM,
+// SYRK and SYR2K), selected with VARIANT=BLOCKED. It replaces the naive OMP
+// body on RUN_OMP_CPU builds, so the test mode checks it against the
+// sequential reference. The BLOCKED Gram-Schmidt (GRAMSCHM) uses it for its
+// panel projections. Include it after DATA_TYPE is declared.
+//
+// The loop structure follows the usual five-loop scheme: the NC x KC panel of
+// B is packed once and shared by all threads, each thread packs MC x KC
+// blocks of A, and a MR x NR micro-kernel keeps its tile of C in registers
+// while streaming the packed panels. The block sizes can be tuned at compile
+// time, e.g. -DBENCH_GEMM_NR=16 on AVX2 or AVX-512 hosts. The packed panels
+// live in a workspace allocated by the first call and reused by the next
+// ones, so the timed calls do not allocate.
+
+#ifndef BENCHMARKS_GEMM_H
+#define BENCHMARKS_GEMM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "BenchmarksAlloc.h"
+
+#if defined(BLOCKED) && defined(RUN_OMP_GPU)
+#error "The BLOCKED variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+/** Rows of the micro-tile of C */
+#ifndef BENCH_GEMM_MR
+#define BENCH_GEMM_MR 4
+#endif
+
+/** Columns of the micro-tile of C, a multiple of the vector width */
+#ifndef BENCH_GEMM_NR
+#define BENCH_GEMM_NR 8
+#endif
+
+/** Rows of A packed per block, sized so that the block stays in L2 */
+#ifndef BENCH_GEMM_MC
+#define BENCH_GEMM_MC 128
+#endif
+
+/** Depth of the packed panels, sized so that a NR x KC panel stays in L1 */
+#ifndef BENCH_GEMM_KC
+#define BENCH_GEMM_KC 256
+#endif
+
+/** Columns of B packed per panel, sized so that the panel stays in LLC */
+#ifndef BENCH_GEMM_NC
+#define BENCH_GEMM_NC 2048
+#endif
+
+#define BENCH_GEMM_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/** Elements of the packed panel of B and of the packed block of A */
+#define BENCH_GEMM_BP_SIZE                                                     \
+  ((size_t)(BENCH_GEMM_NC + BENCH_GEMM_NR - 1) / BENCH_GEMM_NR *               \
+   BENCH_GEMM_NR * BENCH_GEMM_KC)
+#define BENCH_GEMM_AP_SIZE                                                     \
+  ((size_t)(BENCH_GEMM_MC + BENCH_GEMM_MR) * BENCH_GEMM_KC)
+
+/**
+ * @brief Workspace of bench_gemm for threads threads: the packed panel of B,
+ * followed by the packed block of A of each thread. Allocated on the first
+ * call and kept for the process, it is only replaced when a call runs more
+ * threads. Exits when the memory runs out
+ */
+static inline DATA_TYPE *bench_gemm_workspace(int threads) {
+  static DATA_TYPE *ws = NULL;
+  static int ws_threads = 0;
+
+  if (threads > ws_threads) {
+    bench_free(ws);
+    ws = (DATA_TYPE *)bench_calloc(
+        BENCH_GEMM_BP_SIZE + threads * BENCH_GEMM_AP_SIZE, sizeof(DATA_TYPE));
+    if (!ws) {
+      fprintf(stderr, "Out of memory for the bench_gemm workspace\n");
+      exit(EXIT_FAILURE);
+    }
+    ws_threads = threads;
+  }
+  return ws;
+}
+
+/**
+ * @brief Packs a mc x kc block of op(A) into MR-row panels, each stored
+ * column by column. Rows past mc are zero padded
+ */
+static inline void bench_gemm_pack_a(int trans, int mc, int kc,
+                                     const DATA_TYPE *A, int lda,
+                                     DATA_TYPE *Ap) {
+  for (int ir = 0; ir < mc; ir += BENCH_GEMM_MR) {
+    int mr = BENCH_GEMM_MIN(BENCH_GEMM_MR, mc - ir);
+    for (int p = 0; p < kc; p++) {
+      for (int i = 0; i < mr; i++)
+        Ap[i] = trans ? A[p * lda + ir + i] : A[(ir + i) * lda + p];
+      for (int i = mr; i < BENCH_GEMM_MR; i++)
+        Ap[i] = 0;
+      Ap += BENCH_GEMM_MR;
+    }
+  }
+}
+
+/**
+ * @brief Packs the NR-column panel jr of a kc x nc block of op(B), stored row
+ * by row. Columns past nc are zero padded
+ */
+static inline void bench_gemm_pack_b(int trans, int jr, int nc, int kc,
+                                     const DATA_TYPE *B, int ldb,
+                                     DATA_TYPE *Bp) {
+  int nr = BENCH_GEMM_MIN(BENCH_GEMM_NR, nc - jr);
+  for (int p = 0; p < kc; p++) {
+    for (int j = 0; j < nr; j++)
+      Bp[j] = trans ? B[(jr + j) * ldb + p] : B[p * ldb + jr + j];
+    for (int j = nr; j < BENCH_GEMM_NR; j++)
+      Bp[j] = 0;
+    Bp += BENCH_GEMM_NR;
+  }
+}
+
+/**
+ * @brief C[0:mr][0:nr] += scale * Ap . Bp, over kc packed columns. The full
+ * MR x NR tile is accumulated in registers, in ACC_TYPE, and only its valid
+ * part is stored
+ */
+static inline void bench_gemm_micro(int kc, int mr, int nr, DATA_TYPE scale,
+                                    const DATA_TYPE *restrict Ap,
+                                    const DATA_TYPE *restrict Bp,
+                                    DATA_TYPE *restrict C, int ldc) {
+  ACC_TYPE acc[BENCH_GEMM_MR][BENCH_GEMM_NR] = {{0}};
+
+  for (int p = 0; p < kc; p++) {
+    for (int i = 0; i < BENCH_GEMM_MR; i++) {
+      for (int j = 0; j < BENCH_GEMM_NR; j++) {
+        acc[i][j] += Ap[i] * Bp[j];
+      }
+    }
+    Ap += BENCH_GEMM_MR;
+    Bp += BENCH_GEMM_NR;
+  }
+
+  for (int i = 0; i < mr; i++)
+    for (int j = 0; j < nr; j++)
+      C[i * ldc + j] += scale * acc[i][j];
+}
+
+/**
+ * @brief C = c_scale * C + ab_scale * op(A) . op(B), with OpenMP threads
+ *
+ * All matrices are row-major. op(A) is m x k: A itself (m x k, leading
+ * dimension lda) or, if trans_a, the transpose of a k x m matrix. Likewise
+ * op(B) is k x n: B (k x n, ldb) or, if trans_b, the transpose of a n x k
+ * matrix. The scales are not called alpha and beta, which some kernels define
+ * as macros.
+ */
+static inline void bench_gemm(int trans_a, int trans_b, int m, int n, int k,
+                              DATA_TYPE ab_scale, const DATA_TYPE *A, int lda,
+                              const DATA_TYPE *B, int ldb, DATA_TYPE c_scale,
+                              DATA_TYPE *C, int ldc) {
+#ifdef _OPENMP
+  DATA_TYPE *Bp = bench_gemm_workspace(omp_get_max_threads());
+#else
+  DATA_TYPE *Bp = bench_gemm_workspace(1);
+#endif
+
+  #pragma omp parallel
+  {
+#ifdef _OPENMP
+    DATA_TYPE *Ap =
+        Bp + BENCH_GEMM_BP_SIZE + omp_get_thread_num() * BENCH_GEMM_AP_SIZE;
+#else
+    DATA_TYPE *Ap = Bp + BENCH_GEMM_BP_SIZE;
+#endif
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) {
+        C[i * ldc + j] = c_scale == 0 ? 0 : c_scale * C[i * ldc + j];
+      }
+    }
+
+    for (int jc = 0; jc < n; jc += BENCH_GEMM_NC) {
+      int nc = BENCH_GEMM_MIN(BENCH_GEMM_NC, n - jc);
+
+      for (int pc = 0; pc < k; pc += BENCH_GEMM_KC) {
+        int kc = BENCH_GEMM_MIN(BENCH_GEMM_KC, k - pc);
+        const DATA_TYPE *Bb = trans_b ? B + jc * ldb + pc : B + pc * ldb + jc;
+        const DATA_TYPE *Ab = trans_a ? A + pc * lda : A + pc;
+
+        // the implicit barrier publishes the packed panel to every thread
+        #pragma omp for schedule(static)
+        for (int jr = 0; jr < nc; jr += BENCH_GEMM_NR) {
+          bench_gemm_pack_b(trans_b, jr, nc, kc, Bb, ldb,
+                            Bp + (size_t)jr * kc);
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (int ic = 0; ic < m; ic += BENCH_GEMM_MC) {
+          int mc = BENCH_GEMM_MIN(BENCH_GEMM_MC, m - ic);
+          bench_gemm_pack_a(trans_a, mc, kc,
+                            trans_a ? Ab + ic : Ab + ic * lda, lda, Ap);
+
+          for (int jr = 0; jr < nc; jr += BENCH_GEMM_NR) {
+            int nr = BENCH_GEMM_MIN(BENCH_GEMM_NR, nc - jr);
+            for (int ir = 0; ir < mc; ir += BENCH_GEMM_MR) {
+              int mr = BENCH_GEMM_MIN(BENCH_GEMM_MR, mc - ir);
+              bench_gemm_micro(kc, mr, nr, ab_scale, Ap + (size_t)ir * kc,
+                               Bp + (size_t)jr * kc,
+                               C + (ic + ir) * ldc + jc + jr, ldc);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,195 @@
+// BenchmarksNuma.h
+// NUMA placement of the kernel data and thread binding of the run.
+//
+// The arrays that kernels allocate with bench_malloc or bench_calloc (see
+// BenchmarksAlloc.h) are placed with the policy named by the BENCH_MEMPOLICY
+// environment variable:
+//
+//   default     on the node of the thread that first writes them, which is
+//               the master thread for the serial init loops of the kernels
+//   firsttouch  the OpenMP threads write the pages in static chunks as soon as
+//               they are allocated, so the rows that the static schedules of
+//               the kernels give to a thread land on its node
+//   interleave  round-robin over the nodes the process may use
+//   local       only on the node of the allocating thread, failing over to
+//               no other node
+//
+//   BENCH_MEMPOLICY=interleave OMP_PROC_BIND=spread ./omp_cpu_LARGE
+//
+// The policies are set with the mbind system call, without libnuma. Where the
+// kernel has no NUMA support they fall back to default, with a warning. The
+// thread binding is left to the OpenMP runtime (OMP_PROC_BIND and OMP_PLACES,
+// which unibench sets from BENCH_BIND and BENCH_PLACES). Both are recorded in
+// the result records, as "mempolicy", "proc_bind" and "places".
+
+#ifndef BENCHMARKS_NUMA_H
+#define BENCHMARKS_NUMA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#include "BenchmarksResults.h"
+
+/** Nodes covered by the node masks */
+#define BENCH_MAX_NODES 1024
+
+typedef enum {
+  BENCH_MEMPOLICY_DEFAULT,
+  BENCH_MEMPOLICY_FIRSTTOUCH,
+  BENCH_MEMPOLICY_INTERLEAVE,
+  BENCH_MEMPOLICY_LOCAL,
+  BENCH_N_MEMPOLICIES
+} bench_mempolicy_t;
+
+static const char *bench_mempolicy_names[BENCH_N_MEMPOLICIES] = {
+    "default", "firsttouch", "interleave", "local"};
+
+/**
+ * @brief Policy of the run, read from BENCH_MEMPOLICY by the first allocation,
+ * and the number of allocations placed with it. Weak, so that every
+ * translation unit of a benchmark shares the same instance
+ */
+typedef struct {
+  int loaded;
+  bench_mempolicy_t policy;
+  size_t placed;
+} bench_numa_t;
+
+__attribute__((weak)) bench_numa_t bench_numa_state;
+
+/**
+ * @brief Policy selected by BENCH_MEMPOLICY. Exits if the name is unknown
+ */
+static inline bench_mempolicy_t bench_mempolicy(void) {
+  if (bench_numa_state.loaded)
+    return bench_numa_state.policy;
+
+  const char *env = getenv("BENCH_MEMPOLICY");
+  int p = 0;
+  if (env && *env) {
+    while (p < BENCH_N_MEMPOLICIES && strcmp(env, bench_mempolicy_names[p]))
+      p++;
+    if (p == BENCH_N_MEMPOLICIES) {
+      fprintf(stderr, "Unknown BENCH_MEMPOLICY %s, options:", env);
+      for (int i = 0; i < BENCH_N_MEMPOLICIES; i++)
+        fprintf(stderr, " %s", bench_mempolicy_names[i]);
+      fputc('\n', stderr);
+      exit(EXIT_FAILURE);
+    }
+  }
+  bench_numa_state.policy = (bench_mempolicy_t)p;
+  bench_numa_state.loaded = 1;
+  return bench_numa_state.policy;
+}
+
+#ifdef __linux__
+/**
+ * @brief Sets the policy of a fresh mapping before any of its pages is
+ * touched. Returns 0 on success
+ */
+static inline int bench_mem_bind(void *addr, size_t len,
+                                 bench_mempolicy_t policy) {
+  unsigned long mask[BENCH_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+  int mode;
+
+  if (policy == BENCH_MEMPOLICY_INTERLEAVE) {
+    // every node in the cpuset of the process
+    if (syscall(SYS_get_mempolicy, NULL, mask, BENCH_MAX_NODES, NULL,
+                MPOL_F_MEMS_ALLOWED))
+      return -1;
+    mode = MPOL_INTERLEAVE;
+  } else {
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) || node >= BENCH_MAX_NODES)
+      return -1;
+    mask[node / (8 * sizeof(unsigned long))] |=
+        1UL << (node % (8 * sizeof(unsigned long)));
+    mode = MPOL_BIND;
+  }
+  // the kernel reads one bit less than maxnode
+  return (int)syscall(SYS_mbind, addr, len, mode, mask, BENCH_MAX_NODES + 1,
+                      0);
+}
+#endif
+
+/**
+ * @brief Writes the first byte of every page with the OpenMP threads, in
+ * static chunks
+ */
+static inline void bench_mem_touch(char *base, size_t len) {
+  long page = sysconf(_SC_PAGESIZE);
+  long pages = (long)((len + page - 1) / page);
+
+  #pragma omp parallel for schedule(static)
+  for (long p = 0; p < pages; p++) {
+    base[p * page] = 0;
+  }
+}
+
+/**
+ * @brief Places a fresh mapping of len bytes with the policy of the run,
+ * before any of its pages is touched
+ */
+static inline void bench_mem_place(char *base, size_t len) {
+  bench_mempolicy_t policy = bench_mempolicy();
+
+#ifdef __linux__
+  if ((policy == BENCH_MEMPOLICY_INTERLEAVE ||
+       policy == BENCH_MEMPOLICY_LOCAL) &&
+      bench_mem_bind(base, len, policy)) {
+    fprintf(stderr, "BENCH_MEMPOLICY %s is not supported, using default\n",
+            bench_mempolicy_names[policy]);
+    bench_numa_state.policy = BENCH_MEMPOLICY_DEFAULT;
+  }
+#endif
+  if (policy == BENCH_MEMPOLICY_FIRSTTOUCH)
+    bench_mem_touch(base, len);
+  bench_numa_state.placed++;
+}
+
+/**
+ * @brief Name of the thread binding of the OpenMP runtime
+ */
+static inline const char *bench_proc_bind_name(void) {
+#ifdef _OPENMP
+  switch ((int)omp_get_proc_bind()) {
+  case 0:
+    return "false";
+  case 1:
+    return "true";
+  case 2:
+    return "master";
+  case 3:
+    return "close";
+  case 4:
+    return "spread";
+  }
+#endif
+  return "none";
+}
+
+/**
+ * @brief Attaches the thread binding and, when the kernel allocated its data
+ * with bench_malloc (see BenchmarksAlloc.h), the memory policy to a record
+ */
+static inline void bench_numa_add_fields(bench_result_t *r) {
+  const char *places = getenv("OMP_PLACES");
+
+  bench_result_add_str(r, "proc_bind", bench_proc_bind_name());
+  if (places && *places)
+    bench_result_add_str(r, "places", places);
+  if (bench_numa_state.placed)
+    bench_result_add_str(r, "mempolicy",
+                         bench_mempolicy_names[bench_numa_state.policy]);
+}
+
+#endif
@@ -0,0 +1,185 @@
+// BenchmarksPhases.h
+// Monotonic clock and per-phase timers for offloaded kernels.
+//
+// An offloaded kernel splits its data environment with explicit
+// `target enter data` / `target exit data` directives and wraps each part
+// with bench_phase_start/bench_phase_stop, so that host-to-device transfers,
+// kernel execution and device-to-host transfers are timed separately:
+//
+//   bench_phase_start();
+//   #pragma omp target enter data map(to: A[:N]) map(alloc: B[:N])
+//   bench_phase_stop(BENCH_PHASE_H2D, N * sizeof(DATA_TYPE));
+//
+//   bench_phase_start();
+//   #pragma omp target teams distribute parallel for map(to: A[:N]) ...
+//   ...
+//   bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+//
+//   bench_phase_start();
+//   #pragma omp target exit data map(from: B[:N]) map(release: A[:N])
+//   bench_phase_stop(BENCH_PHASE_D2H, N * sizeof(DATA_TYPE));
+//
+// The map clauses of the kernel itself are kept: the data is already present
+// on the device, so they do not transfer anything. Allocation and release of
+// device memory are accounted to the transfer phases.
+//
+// Kernels run with BENCHMARK_OMP_RESIDENT map their data once for the whole
+// run instead, before the first iteration, and copy the results back after
+// the last one. Those two transfers are reported apart from the phases of the
+// iterations, as the "Mapping" line and the map_h2d_* and map_d2h_* fields.
+
+#ifndef BENCHMARKS_PHASES_H
+#define BENCHMARKS_PHASES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "BenchmarksResults.h"
+
+typedef enum {
+  BENCH_PHASE_H2D,
+  BENCH_PHASE_KERNEL,
+  BENCH_PHASE_D2H,
+  BENCH_N_PHASES
+} bench_phase_id_t;
+
+/**
+ * @brief Time (seconds) and transferred bytes accumulated per phase
+ */
+typedef struct {
+  double time[BENCH_N_PHASES];
+  double bytes[BENCH_N_PHASES];
+  uint64_t t_start;
+  int used;
+} bench_phases_t;
+
+/**
+ * @brief Phases recorded since the last bench_phases_clear. Weak, so that
+ * every translation unit of a benchmark shares the same instance
+ */
+__attribute__((weak)) bench_phases_t bench_phases_state;
+
+/**
+ * @brief Monotonic clock with nanosecond resolution
+ * @return uint64_t Nanoseconds since an unspecified starting point
+ */
+static inline uint64_t bench_clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline void bench_phases_clear(bench_phases_t *p) {
+  memset(p, 0, sizeof(*p));
+}
+
+/**
+ * @brief Adds the phases in src to dst
+ */
+static inline void bench_phases_add(bench_phases_t *dst,
+                                    const bench_phases_t *src) {
+  for (int i = 0; i < BENCH_N_PHASES; i++) {
+    dst->time[i] += src->time[i];
+    dst->bytes[i] += src->bytes[i];
+  }
+  dst->used |= src->used;
+}
+
+static inline void bench_phase_start(void) {
+  bench_phases_state.t_start = bench_clock_ns();
+}
+
+/**
+ * @brief Accounts the time since bench_phase_start to a phase
+ * @param phase The phase being timed
+ * @param bytes Bytes transferred by the phase (0 for kernels)
+ */
+static inline void bench_phase_stop(bench_phase_id_t phase, size_t bytes) {
+  uint64_t t_end = bench_clock_ns();
+  bench_phases_state.time[phase] +=
+      (t_end - bench_phases_state.t_start) * 1e-9;
+  bench_phases_state.bytes[phase] += (double)bytes;
+  bench_phases_state.used = 1;
+}
+
+/**
+ * @brief Accounts bytes to a transfer phase without timing it, for transfers
+ * that overlap the kernel (see BenchmarksPipeline.h)
+ */
+static inline void bench_phase_bytes(bench_phase_id_t phase, size_t bytes) {
+  bench_phases_state.bytes[phase] += (double)bytes;
+  bench_phases_state.used = 1;
+}
+
+/**
+ * @brief Prints the phases averaged over n iterations
+ */
+static inline void bench_phases_print(FILE *out, const char *device,
+                                      const bench_phases_t *p, size_t n) {
+  fprintf(out,
+          "%s Phases: h2d=%0.6lfs (%.0lf bytes) kernel=%0.6lfs "
+          "d2h=%0.6lfs (%.0lf bytes)\n",
+          device, p->time[BENCH_PHASE_H2D] / n, p->bytes[BENCH_PHASE_H2D] / n,
+          p->time[BENCH_PHASE_KERNEL] / n, p->time[BENCH_PHASE_D2H] / n,
+          p->bytes[BENCH_PHASE_D2H] / n);
+}
+
+/**
+ * @brief Attaches the phases, averaged over n iterations, to a result record
+ */
+static inline void bench_phases_add_fields(bench_result_t *r,
+                                           const bench_phases_t *p, size_t n) {
+  bench_result_add_num(r, "h2d_time", p->time[BENCH_PHASE_H2D] / n);
+  bench_result_add_num(r, "h2d_bytes", p->bytes[BENCH_PHASE_H2D] / n);
+  bench_result_add_num(r, "kernel_time", p->time[BENCH_PHASE_KERNEL] / n);
+  bench_result_add_num(r, "d2h_time", p->time[BENCH_PHASE_D2H] / n);
+  bench_result_add_num(r, "d2h_bytes", p->bytes[BENCH_PHASE_D2H] / n);
+}
+
+/**
+ * @brief Prints the transfers of the data mapped once for the whole run
+ */
+static inline void bench_mapping_print(FILE *out, const char *device,
+                                       const bench_phases_t *p) {
+  fprintf(out,
+          "%s Mapping: h2d=%0.6lfs (%.0lf bytes) d2h=%0.6lfs (%.0lf bytes)\n",
+          device, p->time[BENCH_PHASE_H2D], p->bytes[BENCH_PHASE_H2D],
+          p->time[BENCH_PHASE_D2H], p->bytes[BENCH_PHASE_D2H]);
+}
+
+/**
+ * @brief Attaches the transfers of the data mapped once for the whole run to a
+ * result record
+ */
+static inline void bench_mapping_add_fields(bench_result_t *r,
+                                            const bench_phases_t *p) {
+  bench_result_add_num(r, "map_h2d_time", p->time[BENCH_PHASE_H2D]);
+  bench_result_add_num(r, "map_h2d_bytes", p->bytes[BENCH_PHASE_H2D]);
+  bench_result_add_num(r, "map_d2h_time", p->time[BENCH_PHASE_D2H]);
+  bench_result_add_num(r, "map_d2h_bytes", p->bytes[BENCH_PHASE_D2H]);
+}
+
+/**
+ * @brief Same as bench_result_emit_time, for benchmarks that time their
+ * kernels by hand. Prints and attaches the phases recorded by the kernel, then
+ * clears them
+ */
+static inline void bench_phases_emit_time(const char *kernel,
+                                          const char *device, long size,
+                                          double seconds) {
+  bench_result_t r;
+  bench_result_init(&r, kernel, device, size);
+  r.times = &seconds;
+  r.n_times = 1;
+  bench_result_print_rates(stdout, &r, seconds);
+  if (bench_phases_state.used) {
+    bench_phases_print(stdout, device, &bench_phases_state, 1);
+    bench_phases_add_fields(&r, &bench_phases_state, 1);
+  }
+  bench_result_emit(&r);
+  bench_phases_clear(&bench_phases_state);
+}
+
+#endif
@@ -0,0 +1,87 @@
+// BenchmarksPipeline.h
+// Chunked, asynchronous offload for the PIPELINED variant.
+//
+// This is the PIPELINED variant of ATAX, BICG and 2DCONV, selected with
+// VARIANT=PIPELINED. Their OMP versions copy the whole input to the device,
+// compute, then copy the whole output back. The variant splits the rows into
+// chunks and gives each chunk its own target tasks (`nowait`), ordered with
+// `depend` clauses, so that the copy of chunk c+1 to the device and the copy
+// of chunk c-1 back to the host overlap the kernel of chunk c:
+//
+//   #pragma omp target enter data map(alloc: A[:N*M])
+//   for (int c = 0; c < chunks; c++) {
+//     int lo = bench_chunk_lo(c, chunks, N), hi = bench_chunk_lo(c + 1, ...);
+//     #pragma omp target update to(A[lo*M:(hi-lo)*M]) nowait depend(out: dep[c])
+//     #pragma omp target teams ... nowait depend(inout: dep[c])
+//     #pragma omp target update from(B[lo:hi-lo]) nowait depend(in: dep[c])
+//   }
+//   #pragma omp taskwait
+//
+// The arrays are allocated on the device as a whole and the chunks move with
+// `target update`, because sections that overlap a mapped one, such as the
+// halo rows of a stencil, cannot be mapped on their own. The tasks are created
+// by one thread of a team of two, so that the second thread can launch a
+// transfer while the first one waits on a kernel. The kernels still take the
+// whole device each and run one after the other.
+//
+// BENCH_CHUNKS sets the number of chunks when the program starts (PIPE_CHUNKS,
+// 8 by default). The records carry it in their "chunks" field. Since the
+// transfers overlap the kernels, the phases only account their bytes, and the
+// whole pipeline is timed as the kernel phase.
+
+#ifndef BENCHMARKS_PIPELINE_H
+#define BENCHMARKS_PIPELINE_H
+
+#include <stdlib.h>
+
+#include "BenchmarksResults.h"
+
+/** Number of chunks used when BENCH_CHUNKS is unset */
+#ifndef PIPE_CHUNKS
+#define PIPE_CHUNKS 8
+#endif
+
+/**
+ * @brief Number of chunks of the last pipeline. Weak, so that every
+ * translation unit of a benchmark shares the same instance
+ */
+typedef struct {
+  int chunks;
+} bench_pipe_t;
+
+__attribute__((weak)) bench_pipe_t bench_pipe_state;
+
+/**
+ * @brief Number of chunks selected by BENCH_CHUNKS, between 1 and the n rows
+ * to split
+ */
+static inline int bench_pipe_chunks(int n) {
+  const char *env = getenv("BENCH_CHUNKS");
+  int chunks = (env && *env) ? atoi(env) : PIPE_CHUNKS;
+  if (chunks > n)
+    chunks = n;
+  if (chunks < 1)
+    chunks = 1;
+  bench_pipe_state.chunks = chunks;
+  return chunks;
+}
+
+/**
+ * @brief First row of chunk c of n rows split in chunks, and the end of chunk
+ * c - 1. The chunks differ in size by one row at most
+ */
+static inline int bench_chunk_lo(int c, int chunks, int n) {
+  return (int)((long)n * c / chunks);
+}
+
+/**
+ * @brief Attaches the number of chunks to a record, when the kernel ran a
+ * pipeline, then clears it for the next run
+ */
+static inline void bench_pipe_add_fields(bench_result_t *r) {
+  if (bench_pipe_state.chunks)
+    bench_result_add_num(r, "chunks", (double)bench_pipe_state.chunks);
+  bench_pipe_state.chunks = 0;
+}
+
+#endif
@@ -0,0 +1,80 @@
+// BenchmarksPrecision.h
+// Floating point precision of the kernel data, chosen at compile time.
+//
+// Kernels include it after BenchmarksUtil.h and declare their data as
+// `typedef BENCH_REAL DATA_TYPE;`. The default builds are single precision;
+// PRECISION=FP64, FP16 or BF16 (-DFP64, -DFP16 or -DBF16) store the data as
+// double, IEEE half (_Float16) or bfloat16 (__bf16) instead:
+//
+//   BENCH_NAME=Polybench/GEMM SIZE=LARGE PRECISION=FP16 make run-omp-cpu
+//
+// The reduced types only store the data. Their arithmetic is carried out in
+// single precision, and long sums accumulate into ACC_TYPE, which stays float
+// (double for FP64), so that the result is not lost once the partial sum
+// outgrows the few bits of the format. The test mode widens ERROR_THRESHOLD by
+// BENCH_ERROR_SCALE, and the result records carry the precision in their
+// "precision" field.
+//
+// The half precision formats cannot hold the initial data of the products,
+// which grows with the problem size: IEEE half overflows past 65504. Their
+// kernels set it with BENCH_INPUT, which normalises each operand to [0, 1) and
+// divides it by the length of the reductions that read it, so that the results
+// stay representable. The single and double precision data is unchanged.
+
+#ifndef BENCHMARKS_PRECISION_H
+#define BENCHMARKS_PRECISION_H
+
+#include "BenchmarksResults.h"
+
+#if defined(FP64) + defined(FP32) + defined(FP16) + defined(BF16) > 1
+#error "Select at most one precision: FP64, FP32, FP16 or BF16"
+#endif
+
+#if defined(FP64)
+#define BENCH_REAL double
+#define ACC_TYPE double
+#define BENCH_PRECISION "fp64"
+#elif defined(FP16)
+#if !defined(__FLT16_MAX__)
+#error "FP16 needs a compiler with _Float16 support for this target"
+#endif
+#define BENCH_REAL _Float16
+#define ACC_TYPE float
+#define BENCH_PRECISION "fp16"
+#undef BENCH_ERROR_SCALE
+/** 11-bit significand, each value is rounded by up to 0.05% */
+#define BENCH_ERROR_SCALE 10
+#elif defined(BF16)
+#if !defined(__BFLT16_MAX__)
+#error "BF16 needs a compiler with __bf16 arithmetic (e.g. GCC 13, Clang 17)"
+#endif
+#define BENCH_REAL __bf16
+#define ACC_TYPE float
+#define BENCH_PRECISION "bf16"
+#undef BENCH_ERROR_SCALE
+/** 8-bit significand, each value is rounded by up to 0.4% */
+#define BENCH_ERROR_SCALE 40
+#else
+#define BENCH_REAL float
+#define ACC_TYPE float
+#define BENCH_PRECISION "fp32"
+#endif
+
+/**
+ * @brief Initial value @p x, computed in ACC_TYPE. The 16-bit formats divide it
+ * by @p range, a bound of @p x times the length of the reductions over it
+ */
+#if defined(FP16) || defined(BF16)
+#define BENCH_INPUT(x, range) ((x) / (ACC_TYPE)(range))
+#else
+#define BENCH_INPUT(x, range) (x)
+#endif
+
+/**
+ * @brief Records the precision in the result records of the kernel
+ */
+__attribute__((constructor)) static void bench_precision_init(void) {
+  bench_work_state.precision = BENCH_PRECISION;
+}
+
+#endif
@@ -0,0 +1,298 @@
+// BenchmarksResults.h
+// Machine-readable result records shared by every benchmark suite.
+//
+// Each record is written as one JSON object per line (JSON-lines) to the file
+// named by the BENCH_RESULTS environment variable ("-" selects stdout). Nothing
+// is written when BENCH_RESULTS is unset.
+
+#ifndef BENCHMARKS_RESULTS_H
+#define BENCHMARKS_RESULTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** Kernel name recorded in the results, set by the Makefile from BENCH_NAME */
+#ifndef BENCH_KERNEL
+#define BENCH_KERNEL __FILE__
+#endif
+
+/** Maximum number of extra fields attached to a record */
+#define BENCH_RESULT_MAX_FIELDS 32
+
+#if defined(__clang__)
+#define BENCH_COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#define BENCH_COMPILER "gcc " __VERSION__
+#else
+#define BENCH_COMPILER "unknown"
+#endif
+
+/**
+ * @brief Extra field of a record, either a string (str != NULL) or a number
+ */
+typedef struct {
+  const char *key;
+  const char *str;
+  double num;
+} bench_field_t;
+
+/**
+ * @brief Analytic work of one kernel run: floating point operations and
+ * compulsory memory traffic in bytes (every operand read once, every result
+ * written once), the precision of its data (see BenchmarksPrecision.h) and,
+ * for graph traversals, the edges traversed and the queries answered, and for
+ * time-stepped solvers the iterations
+ */
+typedef struct {
+  double flops;
+  double bytes;
+  const char *precision;
+  double edges;
+  double queries;
+  double iterations;
+} bench_work_t;
+
+/**
+ * @brief Work declared by the running kernel with bench_work. Weak, so that
+ * every translation unit of a benchmark shares the same instance
+ */
+__attribute__((weak)) bench_work_t bench_work_state;
+
+/**
+ * @brief Declares the work of the kernel launched next. It is attached to the
+ * result records and turned into GFLOP/s, GB/s and arithmetic intensity
+ */
+static inline void bench_work(double flops, double bytes) {
+  bench_work_state.flops = flops;
+  bench_work_state.bytes = bytes;
+}
+
+/**
+ * @brief Declares the edges traversed by the graph kernel launched next. They
+ * are attached to the result records and turned into GTEPS (billions of
+ * traversed edges per second)
+ */
+static inline void bench_work_edges(double edges) {
+  bench_work_state.edges = edges;
+}
+
+/**
+ * @brief Declares the queries answered by the kernel launched next, such as
+ * the searches of a batch of BFS sources. They are attached to the result
+ * records and turned into queries per second
+ */
+static inline void bench_work_queries(double queries) {
+  bench_work_state.queries = queries;
+}
+
+/**
+ * @brief Declares the timesteps run by the solver launched next. They are
+ * attached to the result records and turned into iterations per second
+ */
+static inline void bench_work_iterations(double iterations) {
+  bench_work_state.iterations = iterations;
+}
+
+/**
+ * @brief One result record
+ *
+ * bytes and flops are the data moved and the floating point operations of one
+ * iteration; they are written as null when unknown (zero). precision names the
+ * type of the kernel data, when the kernel declares it. edges are the edges
+ * traversed by one iteration of a graph kernel, queries the queries it
+ * answers and iterations the timesteps of a solver, written only when known.
+ */
+typedef struct {
+  const char *kernel;
+  const char *device;
+  long size;
+  int threads;
+  const double *times;
+  size_t n_times;
+  double bytes;
+  double flops;
+  const char *precision;
+  double edges;
+  double queries;
+  double iterations;
+  size_t n_fields;
+  bench_field_t fields[BENCH_RESULT_MAX_FIELDS];
+} bench_result_t;
+
+static inline void bench_result_init(bench_result_t *r, const char *kernel,
+                                     const char *device, long size) {
+  r->kernel = kernel;
+  r->device = device;
+  r->size = size;
+#ifdef _OPENMP
+  r->threads = omp_get_max_threads();
+#else
+  r->threads = 1;
+#endif
+  r->times = NULL;
+  r->n_times = 0;
+  r->bytes = bench_work_state.bytes;
+  r->flops = bench_work_state.flops;
+  r->precision = bench_work_state.precision;
+  r->edges = bench_work_state.edges;
+  r->queries = bench_work_state.queries;
+  r->iterations = bench_work_state.iterations;
+  r->n_fields = 0;
+}
+
+static inline void bench_result_add_num(bench_result_t *r, const char *key,
+                                        double num) {
+  if (r->n_fields == BENCH_RESULT_MAX_FIELDS)
+    return;
+  r->fields[r->n_fields].key = key;
+  r->fields[r->n_fields].str = NULL;
+  r->fields[r->n_fields].num = num;
+  r->n_fields++;
+}
+
+static inline void bench_result_add_str(bench_result_t *r, const char *key,
+                                        const char *str) {
+  if (r->n_fields == BENCH_RESULT_MAX_FIELDS)
+    return;
+  r->fields[r->n_fields].key = key;
+  r->fields[r->n_fields].str = str ? str : "";
+  r->fields[r->n_fields].num = 0.0;
+  r->n_fields++;
+}
+
+/**
+ * @brief Prints the achieved throughput of a record for a run time in seconds,
+ * when its work is known
+ */
+static inline void bench_result_print_rates(FILE *out,
+                                            const bench_result_t *r,
+                                            double seconds) {
+  if (seconds <= 0.0)
+    return;
+  if (r->edges > 0.0)
+    fprintf(out, "%s Traversal: %0.3lf GTEPS\n", r->device,
+            r->edges / seconds * 1e-9);
+  if (r->queries > 0.0)
+    fprintf(out, "%s Throughput: %0.1lf queries/s\n", r->device,
+            r->queries / seconds);
+  if (r->iterations > 0.0)
+    fprintf(out, "%s Throughput: %0.1lf iterations/s\n", r->device,
+            r->iterations / seconds);
+  if (r->flops <= 0.0 && r->bytes <= 0.0)
+    return;
+  fprintf(out, "%s Roofline: %0.3lf GFLOP/s %0.3lf GB/s", r->device,
+          r->flops / seconds * 1e-9, r->bytes / seconds * 1e-9);
+  if (r->flops > 0.0 && r->bytes > 0.0)
+    fprintf(out, " AI=%0.3lf FLOP/B", r->flops / r->bytes);
+  fputc('\n', out);
+}
+
+static inline void bench_json_str(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    if ((unsigned char)*s >= 0x20)
+      fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+static inline void bench_json_num(FILE *out, double v) {
+  // JSON has no representation for inf/nan
+  if (v != v || v - v != 0.0)
+    fputs("null", out);
+  else
+    fprintf(out, "%.9g", v);
+}
+
+/**
+ * @brief Appends the record to the BENCH_RESULTS file
+ */
+static inline void bench_result_emit(const bench_result_t *r) {
+  const char *path = getenv("BENCH_RESULTS");
+  if (!path || !*path)
+    return;
+
+  FILE *out = (path[0] == '-' && !path[1]) ? stdout : fopen(path, "a");
+  if (!out) {
+    fprintf(stderr, "Failed to open results file %s\n", path);
+    return;
+  }
+
+  fputs("{\"kernel\":", out);
+  bench_json_str(out, r->kernel);
+  fputs(",\"device\":", out);
+  bench_json_str(out, r->device);
+  fprintf(out, ",\"size\":%ld,\"threads\":%d,\"compiler\":", r->size,
+          r->threads);
+  bench_json_str(out, BENCH_COMPILER);
+  fprintf(out, ",\"timestamp\":%ld,\"times\":[", (long)time(NULL));
+  for (size_t i = 0; i < r->n_times; i++) {
+    if (i)
+      fputc(',', out);
+    bench_json_num(out, r->times[i]);
+  }
+  fputs("],\"bytes\":", out);
+  if (r->bytes > 0.0)
+    bench_json_num(out, r->bytes);
+  else
+    fputs("null", out);
+  fputs(",\"flops\":", out);
+  if (r->flops > 0.0)
+    bench_json_num(out, r->flops);
+  else
+    fputs("null", out);
+  if (r->precision) {
+    fputs(",\"precision\":", out);
+    bench_json_str(out, r->precision);
+  }
+  if (r->edges > 0.0) {
+    fputs(",\"edges\":", out);
+    bench_json_num(out, r->edges);
+  }
+  if (r->queries > 0.0) {
+    fputs(",\"queries\":", out);
+    bench_json_num(out, r->queries);
+  }
+  if (r->iterations > 0.0) {
+    fputs(",\"iterations\":", out);
+    bench_json_num(out, r->iterations);
+  }
+  for (size_t i = 0; i < r->n_fields; i++) {
+    fputc(',', out);
+    bench_json_str(out, r->fields[i].key);
+    fputc(':', out);
+    if (r->fields[i].str)
+      bench_json_str(out, r->fields[i].str);
+    else
+      bench_json_num(out, r->fields[i].num);
+  }
+  fputs("}\n", out);
+
+  if (out != stdout)
+    fclose(out);
+  else
+    fflush(out);
+}
+
+/**
+ * @brief Emits a record with a single measured time, for benchmarks that time
+ * their kernels by hand
+ */
+static inline void bench_result_emit_time(const char *kernel,
+                                          const char *device, long size,
+                                          double seconds) {
+  bench_result_t r;
+  bench_result_init(&r, kernel, device, size);
+  r.times = &seconds;
+  r.n_times = 1;
+  bench_result_print_rates(stdout, &r, seconds);
+  bench_result_emit(&r);
+}
+
+#endif
@@ -0,0 +1,188 @@
+// BenchmarksSimd.h
+// Explicitly vectorized matrix-vector primitives with run-time ISA dispatch.
+//
+// This is the SIMD variant of the matrix-vector kernels (ATAX, BICG, GESUMMV
+// and MVT), selected with VARIANT=SIMD. Their OMP bodies are rewritten as dot
+// products and axpy updates over contiguous rows of the matrix, and this
+// header compiles those two primitives once per instruction set: AVX-512,
+// AVX2 (with FMA), SSE4.2 and a scalar fallback that the compiler is kept from
+// vectorizing. Other architectures get the compiler's baseline vector code and
+// the scalar fallback. Include it after DATA_TYPE is declared. The dot products
+// accumulate in ACC_TYPE (see BenchmarksPrecision.h).
+//
+// The widest set the CPU supports is picked when the program starts. BENCH_ISA
+// forces another one, so that every flavour can be measured on the same host:
+//
+//   BENCH_ISA=sse4.2 ./omp_cpu_LARGE_SIMD
+//
+// The flavour is appended to the device name of the results, e.g. "OMP CPU
+// avx2", which reports each one as a device of its own.
+
+#ifndef BENCHMARKS_SIMD_H
+#define BENCHMARKS_SIMD_H
+
+#ifdef SIMD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(RUN_OMP_GPU)
+#error "The SIMD variant only runs on the CPU: select RUN_OMP_CPU"
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BENCH_SIMD_X86 1
+#else
+#define BENCH_SIMD_X86 0
+#endif
+
+/** Columns of the output vector updated per task by the transposed products */
+#ifndef BENCH_SIMD_SLICE
+#define BENCH_SIMD_SLICE 256
+#endif
+
+#define BENCH_SIMD_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#define BENCH_SIMD_PRAGMA(x) _Pragma(#x)
+
+/** Loop vectorized for the instruction set of the enclosing function */
+#define BENCH_SIMD_VECTOR(clauses) BENCH_SIMD_PRAGMA(omp simd clauses)
+
+/** Loop kept scalar, together with BENCH_SIMD_SCALAR_ATTR on the function */
+#if defined(__clang__)
+#define BENCH_SIMD_SCALAR(clauses)                                             \
+  BENCH_SIMD_PRAGMA(clang loop vectorize(disable) interleave(disable))
+#define BENCH_SIMD_SCALAR_ATTR
+#else
+#define BENCH_SIMD_SCALAR(clauses)
+#define BENCH_SIMD_SCALAR_ATTR __attribute__((optimize("no-tree-vectorize")))
+#endif
+
+/**
+ * @brief Defines bench_dot_<ISA> (the dot product of two vectors) and
+ * bench_axpy_<ISA> (y += s * x), compiled with the function attributes ATTR
+ * and the loop pragma LOOP
+ */
+#define BENCH_SIMD_PRIMITIVES(ISA, ATTR, LOOP)                                 \
+  ATTR static ACC_TYPE bench_dot_##ISA(const DATA_TYPE *restrict a,            \
+                                       const DATA_TYPE *restrict b, int n) {   \
+    ACC_TYPE sum = 0;                                                          \
+    LOOP(reduction(+ : sum))                                                   \
+    for (int i = 0; i < n; i++)                                                \
+      sum += a[i] * b[i];                                                      \
+    return sum;                                                                \
+  }                                                                            \
+  ATTR static void bench_axpy_##ISA(DATA_TYPE *restrict y, DATA_TYPE s,        \
+                                    const DATA_TYPE *restrict x, int n) {      \
+    LOOP()                                                                     \
+    for (int i = 0; i < n; i++)                                                \
+      y[i] += s * x[i];                                                        \
+  }
+
+#if BENCH_SIMD_X86
+BENCH_SIMD_PRIMITIVES(avx512, __attribute__((target("avx512f,avx512vl"))),
+                      BENCH_SIMD_VECTOR)
+BENCH_SIMD_PRIMITIVES(avx2, __attribute__((target("avx2,fma"))),
+                      BENCH_SIMD_VECTOR)
+BENCH_SIMD_PRIMITIVES(sse42, __attribute__((target("sse4.2"))),
+                      BENCH_SIMD_VECTOR)
+#else
+BENCH_SIMD_PRIMITIVES(simd, , BENCH_SIMD_VECTOR)
+#endif
+BENCH_SIMD_PRIMITIVES(scalar, BENCH_SIMD_SCALAR_ATTR, BENCH_SIMD_SCALAR)
+
+/**
+ * @brief One flavour of the primitives
+ */
+typedef struct {
+  const char *name;
+  ACC_TYPE (*dot)(const DATA_TYPE *restrict, const DATA_TYPE *restrict, int);
+  void (*axpy)(DATA_TYPE *restrict, DATA_TYPE, const DATA_TYPE *restrict,
+               int);
+} bench_simd_t;
+
+/** Flavours from the widest to the scalar fallback */
+static const bench_simd_t bench_simd_isas[] = {
+#if BENCH_SIMD_X86
+    {"avx512", bench_dot_avx512, bench_axpy_avx512},
+    {"avx2", bench_dot_avx2, bench_axpy_avx2},
+    {"sse4.2", bench_dot_sse42, bench_axpy_sse42},
+#else
+    {"simd", bench_dot_simd, bench_axpy_simd},
+#endif
+    {"scalar", bench_dot_scalar, bench_axpy_scalar},
+};
+
+#define BENCH_SIMD_N_ISAS                                                      \
+  (sizeof(bench_simd_isas) / sizeof(bench_simd_isas[0]))
+
+/** Flavour selected for this run */
+static bench_simd_t bench_simd;
+
+/** Device name of the results, e.g. "OMP CPU avx2" */
+static char bench_simd_device[32];
+
+/**
+ * @brief Whether the CPU and the OS support a flavour of bench_simd_isas
+ */
+static inline int bench_simd_supported(size_t isa) {
+#if BENCH_SIMD_X86
+  __builtin_cpu_init();
+  switch (isa) {
+  case 0:
+    return __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512vl");
+  case 1:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case 2:
+    return __builtin_cpu_supports("sse4.2");
+  }
+#endif
+  return 1;
+}
+
+/**
+ * @brief Selects the flavour named by BENCH_ISA, or else the widest one the
+ * CPU supports. Exits if the requested one is unknown or unsupported
+ */
+__attribute__((constructor)) static void bench_simd_init(void) {
+  const char *env = getenv("BENCH_ISA");
+  size_t isa = 0;
+
+  if (env && *env) {
+    while (isa < BENCH_SIMD_N_ISAS && strcmp(env, bench_simd_isas[isa].name))
+      isa++;
+    if (isa == BENCH_SIMD_N_ISAS) {
+      fprintf(stderr, "Unknown BENCH_ISA %s, options:", env);
+      for (size_t i = 0; i < BENCH_SIMD_N_ISAS; i++)
+        fprintf(stderr, " %s", bench_simd_isas[i].name);
+      fputc('\n', stderr);
+      exit(EXIT_FAILURE);
+    }
+    if (!bench_simd_supported(isa)) {
+      fprintf(stderr, "BENCH_ISA %s is not supported by this CPU\n", env);
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    while (!bench_simd_supported(isa))
+      isa++;
+  }
+
+  bench_simd = bench_simd_isas[isa];
+  snprintf(bench_simd_device, sizeof(bench_simd_device), "%s %s",
+           __OMP_DEVICE_NAME, bench_simd.name);
+}
+
+/**
+ * @brief Auxiliar macro to launch the SIMD variant, reported under the device
+ * name of the selected flavour
+ * @see __BENCHMARK
+ */
+#define BENCHMARK_SIMD(FUNC_CALL) __BENCHMARK(bench_simd_device, FUNC_CALL)
+#define BENCHMARK_SIMD_SETUP(SETUP_CALL, FUNC_CALL)                            \
+  __BENCHMARK_SETUP(bench_simd_device, SETUP_CALL, FUNC_CALL)
+
+#endif
+
+#endif
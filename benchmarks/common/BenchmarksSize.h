@@ -0,0 +1,141 @@
+// BenchmarksSize.h
+// Problem dimensions fixed at compile time or chosen at run time.
+//
+// Kernels name their dimensions with BENCH_DIM, e.g. `#define NI BENCH_DIM(NI)`.
+// In the default builds (SIZE=MINI, SMALL, MEDIUM or LARGE) every dimension is
+// the compile-time constant SIZE, so the compiler specializes the loops for it.
+// Building with SIZE=RUNTIME (-DRUNTIME) turns the dimensions into variables
+// read when the program starts, so one binary covers any size:
+//
+//   ./omp_cpu_RUNTIME --size 3000
+//   ./omp_cpu_RUNTIME --size 2048 --NK 64
+//   BENCH_SIZE=3000 BENCH_NK=64 ./omp_cpu_RUNTIME
+//
+// Every dimension defaults to the size, which defaults to 1024. Command line
+// options take precedence over the environment.
+
+#ifndef BENCHMARKS_SIZE_H
+#define BENCHMARKS_SIZE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef RUNTIME
+
+#include <string.h>
+#include <strings.h>
+
+/** Size used when neither --size nor BENCH_SIZE is given */
+#define BENCH_DEFAULT_SIZE 1024
+
+typedef enum {
+  BENCH_DIM_SIZE,
+  BENCH_DIM_N,
+  BENCH_DIM_M,
+  BENCH_DIM_NI,
+  BENCH_DIM_NJ,
+  BENCH_DIM_NK,
+  BENCH_DIM_NL,
+  BENCH_DIM_NM,
+  BENCH_DIM_NX,
+  BENCH_DIM_NY,
+  BENCH_N_DIMS
+} bench_dim_id_t;
+
+static const char *bench_dim_names[BENCH_N_DIMS] = {
+    "SIZE", "N", "M", "NI", "NJ", "NK", "NL", "NM", "NX", "NY"};
+
+/** Dimensions of the run, also read by the offloaded kernels */
+#pragma omp declare target
+static int bench_dims[BENCH_N_DIMS];
+#pragma omp end declare target
+
+#define BENCH_DIM(d) bench_dims[BENCH_DIM_##d]
+
+/**
+ * @brief Parses a dimension, exiting on values that are not positive integers
+ */
+static inline int bench_dim_parse(const char *name, const char *v) {
+  char *end;
+  long n = strtol(v, &end, 10);
+  if (*v == '\0' || *end != '\0' || n < 1 || n > 1 << 30) {
+    fprintf(stderr, "Invalid value for %s: %s\n", name, v);
+    exit(EXIT_FAILURE);
+  }
+  return (int)n;
+}
+
+/**
+ * @brief Reads the dimensions from the environment (BENCH_SIZE, BENCH_NI, ...)
+ * and the command line (--size N, --NI N or --NI=N) before main runs. glibc
+ * passes the program arguments to constructors; elsewhere only the environment
+ * is read
+ */
+__attribute__((constructor)) static void bench_dims_init(int argc,
+                                                         char **argv) {
+  int set[BENCH_N_DIMS] = {0};
+  char env[16];
+
+  for (int d = 0; d < BENCH_N_DIMS; d++) {
+    snprintf(env, sizeof(env), "BENCH_%s", bench_dim_names[d]);
+    const char *v = getenv(env);
+    if (v && *v) {
+      bench_dims[d] = bench_dim_parse(env, v);
+      set[d] = 1;
+    }
+  }
+
+  for (int i = 1; i < argc && argv; i++) {
+    if (strncmp(argv[i], "--", 2))
+      continue;
+    const char *opt = argv[i] + 2;
+    size_t len = strcspn(opt, "=");
+    for (int d = 0; d < BENCH_N_DIMS; d++) {
+      if (len != strlen(bench_dim_names[d]) ||
+          strncasecmp(opt, bench_dim_names[d], len))
+        continue;
+      const char *v = opt[len] == '=' ? opt + len + 1 : NULL;
+      if (!v && i + 1 < argc)
+        v = argv[++i];
+      if (!v) {
+        fprintf(stderr, "Missing value for %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      bench_dims[d] = bench_dim_parse(bench_dim_names[d], v);
+      set[d] = 1;
+    }
+  }
+
+  if (!set[BENCH_DIM_SIZE])
+    bench_dims[BENCH_DIM_SIZE] = BENCH_DEFAULT_SIZE;
+  for (int d = 0; d < BENCH_N_DIMS; d++)
+    if (!set[d])
+      bench_dims[d] = bench_dims[BENCH_DIM_SIZE];
+}
+
+/**
+ * @brief Copies the dimensions to the device. Called once before the first
+ * kernel is offloaded
+ */
+static inline void bench_dims_sync(int device) {
+  #pragma omp target update to(bench_dims) device(device)
+}
+
+#else
+
+#define BENCH_DIM(d) SIZE
+
+#endif
+
+/**
+ * @brief Exits when the dimensions of the run are not of a shape the kernel
+ * is defined for, e.g. `bench_dims_require(N <= M, "N <= M")`
+ */
+static inline void bench_dims_require(int ok, const char *shape) {
+  if (!ok) {
+    fprintf(stderr, "Invalid dimensions, the kernel needs %s\n", shape);
+    exit(EXIT_FAILURE);
+  }
+}
+
+#endif
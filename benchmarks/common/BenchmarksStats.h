@@ -0,0 +1,309 @@
+// BenchmarksStats.h
+// In-process measurement engine: warmup, adaptive repetitions and summary
+// statistics (min, median, mean, stddev, p95, p99) over a monotonic clock. The
+// cache state the iterations start in is set by BENCH_CACHE, see
+// BenchmarksCache.h
+
+#ifndef BENCHMARKS_STATS_H
+#define BENCHMARKS_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BenchmarksAlloc.h"
+#include "BenchmarksCache.h"
+#include "BenchmarksCounters.h"
+#include "BenchmarksPhases.h"
+#include "BenchmarksPipeline.h"
+#include "BenchmarksResults.h"
+
+/**
+ * Compile-time defaults of the engine. Each one can be overridden at run time
+ * by the environment variable with the same name, e.g.
+ * BENCH_TARGET_CI=0.5 BENCH_MAX_RUNS=200 ./omp_cpu_MINI
+ */
+
+/** Untimed iterations executed before measuring */
+#ifndef BENCH_WARMUP
+#define BENCH_WARMUP 1
+#endif
+
+/** Minimum number of measured iterations */
+#ifndef BENCH_MIN_RUNS
+#define BENCH_MIN_RUNS IN_RUNS
+#endif
+
+/** Maximum number of measured iterations */
+#ifndef BENCH_MAX_RUNS
+#define BENCH_MAX_RUNS 30
+#endif
+
+/** Target half-width of the 95% confidence interval, in percent of the mean */
+#ifndef BENCH_TARGET_CI
+#define BENCH_TARGET_CI 2.0
+#endif
+
+/** Time budget in seconds for the measured iterations of one kernel */
+#ifndef BENCH_TIME_BUDGET
+#define BENCH_TIME_BUDGET 2.0
+#endif
+
+/**
+ * @brief Engine settings, loaded from the compile-time defaults and the
+ * environment
+ */
+typedef struct {
+  size_t warmup;
+  size_t min_runs;
+  size_t max_runs;
+  double target_ci;
+  double time_budget;
+  bench_cache_mode_t cache;
+} bench_config_t;
+
+/**
+ * @brief Summary of the measured iterations. Times are in seconds
+ */
+typedef struct {
+  double *samples;
+  size_t n;
+  double min, max, median, mean, stddev, p95, p99;
+  /** Half-width of the 95% confidence interval, in percent of the mean */
+  double ci95;
+} bench_stats_t;
+
+/**
+ * @brief State of one benchmark run, driven by bench_run_next
+ */
+typedef struct {
+  const char *device;
+  bench_config_t cfg;
+  bench_stats_t stats;
+  bench_result_t result;
+  /** Phases accumulated over the measured iterations */
+  bench_phases_t phases;
+  /** Transfers of the data mapped once for the whole run */
+  bench_phases_t mapping;
+  /** Hardware counters accumulated over the measured iterations */
+  bench_counters_t counters;
+  size_t iter;
+  uint64_t t_budget;
+  uint64_t t_start;
+} bench_run_t;
+
+static inline size_t bench_env_size(const char *name, size_t def) {
+  const char *v = getenv(name);
+  return (v && *v) ? (size_t)strtoul(v, NULL, 10) : def;
+}
+
+static inline double bench_env_double(const char *name, double def) {
+  const char *v = getenv(name);
+  return (v && *v) ? strtod(v, NULL) : def;
+}
+
+static inline bench_config_t bench_config_load(void) {
+  bench_config_t cfg;
+  cfg.warmup = bench_env_size("BENCH_WARMUP", BENCH_WARMUP);
+  cfg.min_runs = bench_env_size("BENCH_MIN_RUNS", BENCH_MIN_RUNS);
+  cfg.max_runs = bench_env_size("BENCH_MAX_RUNS", BENCH_MAX_RUNS);
+  cfg.target_ci = bench_env_double("BENCH_TARGET_CI", BENCH_TARGET_CI);
+  cfg.time_budget = bench_env_double("BENCH_TIME_BUDGET", BENCH_TIME_BUDGET);
+  cfg.cache = bench_cache_mode();
+  if (cfg.cache == BENCH_CACHE_WARM) {
+    // one warm-up at least, then a fixed number of timed iterations
+    if (cfg.warmup < 1)
+      cfg.warmup = 1;
+    cfg.max_runs = cfg.min_runs;
+  }
+#ifdef RUN_TEST
+  // in test mode the kernel runs exactly once, so that in-place kernels
+  // produce the same output as the sequential reference
+  cfg.warmup = 0;
+  cfg.min_runs = 1;
+  cfg.max_runs = 1;
+#endif
+  if (cfg.min_runs < 1)
+    cfg.min_runs = 1;
+  if (cfg.max_runs < cfg.min_runs)
+    cfg.max_runs = cfg.min_runs;
+  return cfg;
+}
+
+/**
+ * @brief Two-sided 95% quantile of the Student t distribution
+ * @param df Degrees of freedom
+ */
+static inline double bench_t95(size_t df) {
+  static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                             2.306,  2.262, 2.228, 2.201, 2.179, 2.160, 2.145,
+                             2.131,  2.120, 2.110, 2.101, 2.093, 2.086, 2.080,
+                             2.074,  2.069, 2.064, 2.060, 2.056, 2.052, 2.048,
+                             2.045,  2.042};
+  if (df == 0)
+    return INFINITY;
+  return df <= 30 ? t[df - 1] : 1.96;
+}
+
+static inline int bench_cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentile of a sorted array, with linear interpolation
+ */
+static inline double bench_percentile(const double *sorted, size_t n,
+                                      double p) {
+  double pos = p * (n - 1);
+  size_t lo = (size_t)pos;
+  size_t hi = lo + 1 < n ? lo + 1 : lo;
+  return sorted[lo] + (pos - lo) * (sorted[hi] - sorted[lo]);
+}
+
+/**
+ * @brief Updates mean, stddev and the confidence interval of the samples
+ */
+static inline void bench_stats_moments(bench_stats_t *s) {
+  double sum = 0.0, sq = 0.0;
+  for (size_t i = 0; i < s->n; i++)
+    sum += s->samples[i];
+  s->mean = sum / s->n;
+  for (size_t i = 0; i < s->n; i++)
+    sq += (s->samples[i] - s->mean) * (s->samples[i] - s->mean);
+  s->stddev = s->n > 1 ? sqrt(sq / (s->n - 1)) : 0.0;
+  s->ci95 = s->n > 1 && s->mean > 0.0
+                ? 100.0 * bench_t95(s->n - 1) * s->stddev / sqrt((double)s->n) /
+                      s->mean
+                : INFINITY;
+}
+
+/**
+ * @brief Computes the order statistics of the samples
+ */
+static inline void bench_stats_compute(bench_stats_t *s) {
+  if (s->n == 0)
+    return;
+  bench_stats_moments(s);
+  double *sorted = (double *)malloc(s->n * sizeof(double));
+  memcpy(sorted, s->samples, s->n * sizeof(double));
+  qsort(sorted, s->n, sizeof(double), bench_cmp_double);
+  s->min = sorted[0];
+  s->max = sorted[s->n - 1];
+  s->median = bench_percentile(sorted, s->n, 0.50);
+  s->p95 = bench_percentile(sorted, s->n, 0.95);
+  s->p99 = bench_percentile(sorted, s->n, 0.99);
+  free(sorted);
+}
+
+static inline void bench_stats_print(FILE *out, const char *device,
+                                     const bench_stats_t *s) {
+  fprintf(out, "%s Runtime: %0.6lfs\n", device, s->median);
+  fprintf(out,
+          "%s Stats: runs=%zu min=%0.6lfs median=%0.6lfs mean=%0.6lfs "
+          "stddev=%0.6lfs p95=%0.6lfs p99=%0.6lfs ci95=%0.2lf%%\n",
+          device, s->n, s->min, s->median, s->mean, s->stddev, s->p95, s->p99,
+          s->ci95);
+}
+
+static inline void bench_run_begin(bench_run_t *run, const char *kernel,
+                                   const char *device, long size) {
+  memset(run, 0, sizeof(*run));
+  run->device = device;
+  bench_result_init(&run->result, kernel, device, size);
+  run->cfg = bench_config_load();
+  run->stats.samples = (double *)malloc(run->cfg.max_runs * sizeof(double));
+  bench_counters_open(&run->counters);
+}
+
+/**
+ * @brief Decides whether another iteration must run
+ *
+ * Warmup iterations come first. Measured iterations then repeat until at least
+ * min_runs samples exist and either the confidence interval is within target,
+ * the time budget is spent or max_runs is reached.
+ */
+static inline int bench_run_next(bench_run_t *run) {
+  bench_stats_t *s = &run->stats;
+  if (run->iter < run->cfg.warmup)
+    return 1;
+  if (run->iter == run->cfg.warmup)
+    run->t_budget = bench_clock_ns();
+  if (s->n < run->cfg.min_runs)
+    return 1;
+  if (s->n >= run->cfg.max_runs)
+    return 0;
+  if ((bench_clock_ns() - run->t_budget) * 1e-9 >= run->cfg.time_budget)
+    return 0;
+  bench_stats_moments(s);
+  return s->ci95 > run->cfg.target_ci;
+}
+
+static inline void bench_iter_start(bench_run_t *run) {
+  if (run->cfg.cache == BENCH_CACHE_COLD && run->iter >= run->cfg.warmup)
+    bench_cache_flush();
+  bench_phases_clear(&bench_phases_state);
+  bench_counters_start(&run->counters);
+  run->t_start = bench_clock_ns();
+}
+
+static inline void bench_iter_stop(bench_run_t *run) {
+  uint64_t t_end = bench_clock_ns();
+  int measured = run->iter++ >= run->cfg.warmup;
+  bench_counters_stop(&run->counters, measured);
+  if (measured) {
+    run->stats.samples[run->stats.n++] = (t_end - run->t_start) * 1e-9;
+    bench_phases_add(&run->phases, &bench_phases_state);
+  }
+}
+
+/**
+ * @brief Starts timing the transfers of data mapped once for the whole run,
+ * outside of the iterations
+ * @see BENCHMARK_OMP_RESIDENT
+ */
+static inline void bench_map_start(void) {
+  bench_phases_clear(&bench_phases_state);
+}
+
+/**
+ * @brief Accounts the transfers since bench_map_start to the mapping of the run
+ */
+static inline void bench_map_stop(bench_run_t *run) {
+  bench_phases_add(&run->mapping, &bench_phases_state);
+}
+
+static inline void bench_run_end(bench_run_t *run) {
+  bench_stats_compute(&run->stats);
+  bench_stats_print(stdout, run->device, &run->stats);
+  bench_result_print_rates(stdout, &run->result, run->stats.median);
+  run->result.times = run->stats.samples;
+  run->result.n_times = run->stats.n;
+  bench_result_add_num(&run->result, "warmup", (double)run->cfg.warmup);
+  bench_result_add_str(&run->result, "cache",
+                       bench_cache_names[run->cfg.cache]);
+  if (run->phases.used && run->stats.n) {
+    bench_phases_print(stdout, run->device, &run->phases, run->stats.n);
+    bench_phases_add_fields(&run->result, &run->phases, run->stats.n);
+  }
+  if (run->mapping.used) {
+    bench_mapping_print(stdout, run->device, &run->mapping);
+    bench_mapping_add_fields(&run->result, &run->mapping);
+  }
+  if (run->counters.n && run->stats.n) {
+    bench_counters_print(stdout, run->device, &run->counters, run->stats.n);
+    bench_counters_add_fields(&run->result, &run->counters, run->stats.n);
+  }
+  bench_counters_close(&run->counters);
+  bench_numa_add_fields(&run->result);
+  bench_alloc_add_fields(&run->result);
+  bench_pipe_add_fields(&run->result);
+  bench_result_emit(&run->result);
+  free(run->stats.samples);
+  run->stats.samples = NULL;
+}
+
+#endif
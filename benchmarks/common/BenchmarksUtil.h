@@ -5,6 +5,7 @@
 #ifndef BENCHMARKS_UTIL_H
 #define BENCHMARKS_UTIL_H
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
@@ -24,8 +25,13 @@
 
 #define RUN_CPU_SEQ
 #define IN_RUNS 1
+#ifndef RUNTIME
 #define SIZE 1024
 #endif
+#endif
+
+#include "BenchmarksSize.h"
+#include "BenchmarksStats.h"
 
 /** Pre-set problem sizes */
 #ifdef _OPS_O2
@@ -42,6 +48,8 @@
 #define SIZE 2048*_SIZE_FACTOR
 #elif LARGE
 #define SIZE 4096*_SIZE_FACTOR
+#elif defined(RUNTIME)
+#define SIZE BENCH_DIM(SIZE)
 #endif
 
 /** Set default problem size, if undefined */
@@ -70,16 +78,27 @@
 #define OMP_DEVICE_ID 1
 #endif
 
+/** Widened by BenchmarksPrecision.h for the reduced precision builds */
+#define BENCH_ERROR_SCALE 1
+
+/** Tolerance of a kernel at full precision, in percent. Kernels that need
+ * another one define it before including this header */
+#ifndef KERNEL_ERROR_THRESHOLD
+#define KERNEL_ERROR_THRESHOLD 0.5
+#endif
+
 // define the error threshold for the results "not matching"
-#define ERROR_THRESHOLD 0.5
+#define ERROR_THRESHOLD (KERNEL_ERROR_THRESHOLD * BENCH_ERROR_SCALE)
 
 /**
  * @brief Run function responsible to setup everything before running the actual
  * kernel.
  *
  * The function is executed IN_RUNS times. Each call repeats the memory
- * allocation and initialization process before calling the kernel, as an
- * attempt to ensure cold cache
+ * allocation and initialization process before calling the kernel. This does
+ * not leave the caches cold, the inputs just initialized are still in the LLC:
+ * BENCH_CACHE=cold evicts it before every timed iteration (see
+ * BenchmarksCache.h)
  *
  */
 #define BENCH_INIT(KERNEL_SETUP_FUNC)                                          \
@@ -90,17 +109,56 @@
   }
 
 /**
- * @brief Measures the execution time to execute the kernels function and
- * outputs to stdout
+ * @brief Measures the execution time of the kernel function and outputs the
+ * summary statistics to stdout. The samples are also emitted as a result record
  *
+ * The kernel runs BENCH_WARMUP untimed iterations, then repeats until the
+ * confidence interval target or the time budget is met.
+ * SETUP_CALL runs untimed before every iteration, which lets kernels that
+ * update their operands in place restore them. It may be left empty.
+ * @see BenchmarksStats.h
  */
-#define __BENCHMARK(DEVICE, FUNC_CALL)                                         \
+#define __BENCHMARK_SETUP(DEVICE, SETUP_CALL, FUNC_CALL)                       \
   {                                                                            \
-    double __t_start, __t_end;                                                 \
-    __t_start = rtclock();                                                     \
-    FUNC_CALL;                                                                 \
-    __t_end = rtclock();                                                       \
-    fprintf(stdout, DEVICE " Runtime: %0.6lfs\n", __t_end - __t_start);        \
+    bench_run_t __run;                                                         \
+    for (bench_run_begin(&__run, BENCH_KERNEL, DEVICE, SIZE);                  \
+         bench_run_next(&__run);) {                                            \
+      SETUP_CALL;                                                              \
+      bench_iter_start(&__run);                                                \
+      FUNC_CALL;                                                               \
+      bench_iter_stop(&__run);                                                 \
+    }                                                                          \
+    bench_run_end(&__run);                                                     \
+  }
+
+#define __BENCHMARK(DEVICE, FUNC_CALL) __BENCHMARK_SETUP(DEVICE, , FUNC_CALL)
+
+/**
+ * @brief Same as __BENCHMARK_SETUP, for kernels whose data stays on the device
+ * for the whole run. ENTER_CALL maps it before the first iteration and
+ * EXIT_CALL copies the results back after the last one, both untimed, so the
+ * iterations only launch the kernel. SETUP_CALL has to reset the operands on
+ * the device. The transfers of ENTER_CALL and EXIT_CALL are reported on their
+ * own (see BenchmarksPhases.h)
+ */
+#define __BENCHMARK_RESIDENT(DEVICE, ENTER_CALL, SETUP_CALL, FUNC_CALL,        \
+                             EXIT_CALL)                                        \
+  {                                                                            \
+    bench_run_t __run;                                                         \
+    bench_run_begin(&__run, BENCH_KERNEL, DEVICE, SIZE);                       \
+    bench_map_start();                                                         \
+    ENTER_CALL;                                                                \
+    bench_map_stop(&__run);                                                    \
+    while (bench_run_next(&__run)) {                                           \
+      SETUP_CALL;                                                              \
+      bench_iter_start(&__run);                                                \
+      FUNC_CALL;                                                               \
+      bench_iter_stop(&__run);                                                 \
+    }                                                                          \
+    bench_map_start();                                                         \
+    EXIT_CALL;                                                                 \
+    bench_map_stop(&__run);                                                    \
+    bench_run_end(&__run);                                                     \
   }
 
 /**
@@ -108,16 +166,26 @@
  * @see __BENCHMARK
  */
 #if defined(RUN_OMP_GPU)
-#define BENCHMARK_OMP(FUNC_CALL) __BENCHMARK("OMP GPU", FUNC_CALL)
+#define __OMP_DEVICE_NAME "OMP GPU"
 #elif defined(RUN_OMP_CPU)
-#define BENCHMARK_OMP(FUNC_CALL) __BENCHMARK("OMP CPU", FUNC_CALL)
+#define __OMP_DEVICE_NAME "OMP CPU"
+#else
+#define __OMP_DEVICE_NAME "OMP"
 #endif
+#define BENCHMARK_OMP(FUNC_CALL) __BENCHMARK(__OMP_DEVICE_NAME, FUNC_CALL)
+#define BENCHMARK_OMP_SETUP(SETUP_CALL, FUNC_CALL)                             \
+  __BENCHMARK_SETUP(__OMP_DEVICE_NAME, SETUP_CALL, FUNC_CALL)
+#define BENCHMARK_OMP_RESIDENT(ENTER_CALL, SETUP_CALL, FUNC_CALL, EXIT_CALL)   \
+  __BENCHMARK_RESIDENT(__OMP_DEVICE_NAME, ENTER_CALL, SETUP_CALL, FUNC_CALL,   \
+                       EXIT_CALL)
 
 /**
  * @brief Auxiliar macro to launch CPU sequential benchmarks
  * @see __BENCHMARK
  */
 #define BENCHMARK_CPU(FUNC_CALL) __BENCHMARK("CPU", FUNC_CALL)
+#define BENCHMARK_CPU_SETUP(SETUP_CALL, FUNC_CALL)                             \
+  __BENCHMARK_SETUP("CPU", SETUP_CALL, FUNC_CALL)
 
 #ifdef LLVM_MCA
 #define LLVM_MCA_BEGIN(name) __asm volatile("# LLVM-MCA-BEGIN " name)
@@ -137,7 +205,7 @@
 #ifndef RUN_TEST
 #define DCE_PREVENT(array, elems)                                              \
   {                                                                            \
-    DATA_TYPE __acc = 0;                                                       \
+    double __acc = 0;                                                          \
     for (size_t __i = 0; __i < elems; __i++)                                   \
       __acc += array[__i];                                                     \
     fprintf(stderr, "dead code elimination prevent: acc = %lf\n", __acc);      \
@@ -146,20 +214,27 @@
 #define DCE_PREVENT(array, elems)
 #endif
 
-#define SALUTE(msg) fprintf(stdout, ">> %s (N=%d) <<\n", msg, SIZE)
+/**
+ * @brief Copies the problem dimensions to the device in SIZE=RUNTIME builds.
+ * SALUTE does it for the Polybench kernels
+ * @see BenchmarksSize.h
+ */
+#ifdef RUNTIME
+#define BENCH_SIZE_SYNC() bench_dims_sync(OMP_DEVICE_ID)
+#else
+#define BENCH_SIZE_SYNC()
+#endif
+
+#define SALUTE(msg)                                                            \
+  {                                                                            \
+    BENCH_SIZE_SYNC();                                                         \
+    fprintf(stdout, ">> %s (N=%d) <<\n", msg, SIZE);                           \
+  }
 
 // define a small float value
 #define SMALL_FLOAT_VAL 0.00000001f
 
-double rtclock() {
-  struct timezone Tzp;
-  struct timeval Tp;
-  int stat;
-  stat = gettimeofday(&Tp, &Tzp);
-  if (stat != 0)
-    printf("Error return from gettimeofday: %d", stat);
-  return (Tp.tv_sec + Tp.tv_usec * 1.0e-6);
-}
+double rtclock() { return bench_clock_ns() * 1.0e-9; }
 
 float absVal(float a) {
   if (a < 0) {
@@ -169,7 +244,16 @@ float absVal(float a) {
   }
 }
 
+/**
+ * @brief Relative difference of two results, in percent. An infinite or NaN
+ * value on either side, from an overflow or an invalid operation, is always
+ * beyond the threshold
+ */
 float percentDiff(double val1, double val2) {
+  if (!isfinite(val1) || !isfinite(val2)) {
+    return INFINITY;
+  }
+
   if ((absVal(val1) < 0.01) && (absVal(val2) < 0.01)) {
     return 0.0f;
   }
@@ -9,6 +9,7 @@
 #endif
 
 #include "main.h"
+#include "BenchmarksResults.h"
 
 #define min(a, b) ((a<b)?a:b)
 #define max(a, b) ((a>b)?a:b)
@@ -130,6 +131,15 @@ int main(int argc, char* argv[])
     qsort(all_times, params.niter, sizeof(double), comp);
     double median = all_times[params.niter / 2];
 
+    bench_result_t result;
+    bench_result_init(&result, BENCH_KERNEL, "OMP CPU", params.matrix_size);
+    result.times = all_times;
+    result.n_times = params.niter;
+    bench_result_add_num(&result, "blocksize", params.blocksize);
+    bench_result_add_num(&result, "titer", params.titer);
+    bench_result_add_num(&result, "type", params.type);
+    bench_result_emit(&result);
+
     free(all_times);
 
     printf("Parallel Stats\n");
@@ -195,6 +205,14 @@ int main(int argc, char* argv[])
     qsort(all_times_seq, params_seq.niter, sizeof(double), comp);
     double median_seq = all_times_seq[params_seq.niter / 2];
 
+    bench_result_t result_seq;
+    bench_result_init(&result_seq, BENCH_KERNEL, "CPU", params_seq.matrix_size);
+    result_seq.times = all_times_seq;
+    result_seq.n_times = params_seq.niter;
+    bench_result_add_num(&result_seq, "blocksize", params_seq.blocksize);
+    bench_result_add_num(&result_seq, "titer", params_seq.titer);
+    bench_result_emit(&result_seq);
+
     free(all_times_seq);
 
 
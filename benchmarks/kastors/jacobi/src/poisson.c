@@ -13,6 +13,7 @@
 # include "poisson.h"
 # include "main.h"
 #include "../../common/Utils.h"
+#include "BenchmarksAlloc.h"
 
 
 double r8mat_rms(int nx, int ny, double *a_);
@@ -97,10 +98,10 @@ double run(struct user_parameters* params)
     int jj,j;
     int nx = matrix_size;
     int ny = matrix_size;
-    double *f_ = malloc(nx * nx * sizeof(double));
+    double *f_ = bench_malloc(nx * nx * sizeof(double));
     double (*f)[nx][ny] = (double (*)[nx][ny])f_;
-    double *u_ = malloc(nx * nx * sizeof(double));
-    double *unew_ = malloc(nx * ny * sizeof(double));
+    double *u_ = bench_malloc(nx * nx * sizeof(double));
+    double *unew_ = bench_malloc(nx * ny * sizeof(double));
     double (*unew)[nx][ny] = (double (*)[nx][ny])unew_;
 
     /* test if valid */
@@ -176,7 +177,7 @@ double run(struct user_parameters* params)
     if(params->check) {
         double x;
         double y;
-        double *udiff_ = malloc(nx * ny * sizeof(double));
+        double *udiff_ = bench_malloc(nx * ny * sizeof(double));
         double (*udiff)[nx][ny] = (double (*)[nx][ny])udiff_;
         /// CHECK OUTPUT
         // Check for convergence.
@@ -219,15 +220,15 @@ double run(struct user_parameters* params)
         }
         error1 = r8mat_rms(nx, ny, udiff_);
         params->succeed = fabs(error - error1) < 1.0E-6;
-        free(udiff_);
+        bench_free(udiff_);
     }
 #else
     params->succeed = 1;
     (void)error;
 #endif
-    free(f_);
-    free(u_);
-    free(unew_);
+    bench_free(f_);
+    bench_free(u_);
+    bench_free(unew_);
     return (t_end - t_start);
 }
 
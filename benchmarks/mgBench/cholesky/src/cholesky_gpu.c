@@ -23,7 +23,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -46,6 +46,12 @@ void init_arrays(float *A, float *B_GPU, float *B_CPU) {
 /// Cholesky algorithm GPU
 /// s = size of matrix
 void cholesky_GPU(float *A, float *B) {
+  bench_phase_start();
+#pragma omp target enter data map(to : A[0 : SIZE *SIZE], B[0 : SIZE *SIZE])   \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, 2 * SIZE * SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : A[0 : SIZE *SIZE]) map(tofrom : B[0 : SIZE *SIZE]) \
     device(DEVICE_ID)
   {
@@ -72,6 +78,12 @@ void cholesky_GPU(float *A, float *B) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : B[0 : SIZE *SIZE])                     \
+    map(release : A[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * SIZE * sizeof(float));
 }
 
 void cholesky_CPU(float *A, float *B) {
@@ -114,13 +126,15 @@ int compareResults(float *E, float *E_GPU) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   float *A, *B_CPU, *B_GPU;
   int fail = 0;
 
-  A = (float *)malloc(SIZE * SIZE * sizeof(float));
-  B_CPU = (float *)malloc(SIZE * SIZE * sizeof(float));
-  B_GPU = (float *)malloc(SIZE * SIZE * sizeof(float));
+  A = (float *)bench_malloc(SIZE * SIZE * sizeof(float));
+  B_CPU = (float *)bench_malloc(SIZE * SIZE * sizeof(float));
+  B_GPU = (float *)bench_malloc(SIZE * SIZE * sizeof(float));
 
   fprintf(stdout, "<< Cholesky >>\n");
 
@@ -130,19 +144,21 @@ int main(int argc, char *argv[]) {
   cholesky_GPU(A, B_GPU);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   cholesky_CPU(A, B_CPU);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(B_CPU, B_GPU);
 #endif
 
-  free(A);
-  free(B_CPU);
-  free(B_GPU);
+  bench_free(A);
+  bench_free(B_CPU);
+  bench_free(B_GPU);
 
   return fail;
 }
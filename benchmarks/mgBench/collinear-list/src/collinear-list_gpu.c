@@ -28,7 +28,7 @@
 #define SIZE 1024
 #elif RUN_BENCHMARK
 #define SIZE 1024 * 16
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1024
 #endif
 
@@ -53,12 +53,18 @@ void generate_points() {
 /// N = size of vector
 int colinear_list_points_GPU() {
   int val = 0;
-  int *parallel_lines = (int *)malloc(sizeof(int) * SIZE);
+  int *parallel_lines = (int *)bench_malloc(sizeof(int) * SIZE);
 
   for (int i = 0; i < SIZE; i++) {
     parallel_lines[i] = 0;
   }
 
+  bench_phase_start();
+#pragma omp target enter data                                                  \
+    map(to : points[ : SIZE], parallel_lines[ : SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, SIZE * (sizeof(point) + sizeof(int)));
+
+  bench_phase_start();
 #pragma omp target map(to : points[ : SIZE])                                   \
     map(tofrom : parallel_lines[ : SIZE]) device(DEVICE_ID)
   {
@@ -88,6 +94,12 @@ int colinear_list_points_GPU() {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : parallel_lines[ : SIZE])               \
+    map(release : points[ : SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * sizeof(int));
 
   val = 0;
   for (int i = 0; i < SIZE; i++) {
@@ -97,7 +109,7 @@ int colinear_list_points_GPU() {
     }
   }
 
-  free(parallel_lines);
+  bench_free(parallel_lines);
 
   return val;
 }
@@ -151,6 +163,8 @@ int compareResults(int A, int A_outputFromGpu) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
 
@@ -158,24 +172,26 @@ int main(int argc, char *argv[]) {
 
   fprintf(stdout, "<< Collinear List >>\n");
 
-  points = (point *)malloc(sizeof(points) * SIZE);
+  points = (point *)bench_malloc(sizeof(points) * SIZE);
   generate_points();
 
   t_start = rtclock();
   result_GPU = colinear_list_points_GPU();
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   result_CPU = colinear_list_points_CPU();
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(result_GPU, result_CPU);
 #endif
 
-  free(points);
+  bench_free(points);
 
   return fail;
 }
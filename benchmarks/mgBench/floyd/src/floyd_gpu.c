@@ -30,7 +30,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -73,6 +73,12 @@ void Knearest_GPU(int *matrix, int *matrix_dist) {
   }
 
 /// opportunity of parallelism here
+  bench_phase_start();
+#pragma omp target enter data map(to : matrix_dist[ : SIZE *SIZE])             \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, SIZE * SIZE * sizeof(int));
+
+  bench_phase_start();
 #pragma omp target map(tofrom : matrix_dist[ : SIZE *SIZE]) device(DEVICE_ID)
   {
     for (i = 0; i < SIZE; i++) {
@@ -90,6 +96,12 @@ void Knearest_GPU(int *matrix, int *matrix_dist) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : matrix_dist[ : SIZE *SIZE])            \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * SIZE * sizeof(int));
 }
 
 void Knearest_CPU(int *matrix, int *matrix_dist) {
@@ -141,6 +153,8 @@ int compareResults(int *B, int *B_GPU) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   int i;
   int points, var;
   double t_start, t_end;
@@ -151,9 +165,9 @@ int main(int argc, char *argv[]) {
 
   fprintf(stdout, "<< K-nearest GPU >>\n");
 
-  matrix = (int *)malloc(sizeof(int) * SIZE * SIZE);
-  matrix_dist_cpu = (int *)malloc(sizeof(int) * SIZE * SIZE);
-  matrix_dist_gpu = (int *)malloc(sizeof(int) * SIZE * SIZE);
+  matrix = (int *)bench_malloc(sizeof(int) * SIZE * SIZE);
+  matrix_dist_cpu = (int *)bench_malloc(sizeof(int) * SIZE * SIZE);
+  matrix_dist_gpu = (int *)bench_malloc(sizeof(int) * SIZE * SIZE);
 
   init(matrix, matrix_dist_cpu, matrix_dist_gpu);
 
@@ -161,19 +175,21 @@ int main(int argc, char *argv[]) {
   Knearest_GPU(matrix, matrix_dist_gpu);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   Knearest_CPU(matrix, matrix_dist_cpu);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(matrix_dist_cpu, matrix_dist_gpu);
 #endif
 
-  free(matrix);
-  free(matrix_dist_cpu);
-  free(matrix_dist_gpu);
+  bench_free(matrix);
+  bench_free(matrix_dist_cpu);
+  bench_free(matrix_dist_gpu);
 
   return fail;
 }
@@ -25,7 +25,7 @@
 #define SIZE 128
 #elif RUN_BENCHMARK
 #define SIZE 256
-#else
+#elif !defined(RUNTIME)
 #define SIZE 128
 #endif
 
@@ -72,6 +72,15 @@ void k_nearest_gpu(point *pivots, point *the_points, sel_points *selected_init,
 
   sel_points aux;
 
+  bench_phase_start();
+#pragma omp target enter data map(                                             \
+    to : pivots[0 : SIZE_2], the_points[0 : SIZE],                             \
+    selected_init[0 : SIZE *SIZE], selected[0 : SIZE *SIZE],                   \
+    selected2[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (SIZE_2 + SIZE) * sizeof(point) +
+                                       3 * SIZE * SIZE * sizeof(sel_points));
+
+  bench_phase_start();
 #pragma omp target map(                                                        \
     to : pivots[0 : SIZE_2],                                                   \
                 the_points[0 : SIZE], selected_init[0 : SIZE *SIZE])           \
@@ -125,6 +134,14 @@ void k_nearest_gpu(point *pivots, point *the_points, sel_points *selected_init,
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(                                              \
+    from : selected[0 : SIZE *SIZE], selected2[0 : SIZE *SIZE])                \
+    map(release : pivots[0 : SIZE_2], the_points[0 : SIZE],                    \
+        selected_init[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, 2 * SIZE * SIZE * sizeof(sel_points));
 }
 void k_nearest_cpu(point *pivots, point *the_points, sel_points *selected) {
   int i, j;
@@ -189,6 +206,8 @@ int compareResults(sel_points *B, sel_points *B_GPU) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
 
@@ -199,13 +218,13 @@ int main(int argc, char *argv[]) {
 
   fprintf(stdout, "<< K-nearest >>\n");
 
-  pivots = (point *)malloc(sizeof(point) * SIZE);
-  the_points = (point *)malloc(sizeof(point) * SIZE);
-  selected_cpu = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
-  selected_gpu = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
-  selected_gpu_init = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
+  pivots = (point *)bench_malloc(sizeof(point) * SIZE);
+  the_points = (point *)bench_malloc(sizeof(point) * SIZE);
+  selected_cpu = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
+  selected_gpu = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
+  selected_gpu_init = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
 
-  selected_gpu2 = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
+  selected_gpu2 = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
 
   init(pivots, the_points, selected_cpu, selected_gpu_init);
 
@@ -214,20 +233,22 @@ int main(int argc, char *argv[]) {
                 selected_gpu2);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   k_nearest_cpu(pivots, the_points, selected_cpu);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(selected_cpu, selected_gpu2);
 #endif
 
-  free(selected_cpu);
-  free(selected_gpu);
-  free(pivots);
-  free(the_points);
+  bench_free(selected_cpu);
+  bench_free(selected_gpu);
+  bench_free(pivots);
+  bench_free(the_points);
 
   return fail;
 }
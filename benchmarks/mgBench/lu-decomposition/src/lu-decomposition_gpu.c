@@ -29,6 +29,8 @@
 #elif RUN_BENCHMARK
 #define SIZE 500
 #define points 250
+#elif defined(RUNTIME)
+#define points 250
 #else
 #define SIZE 500
 #define points 250
@@ -53,6 +55,12 @@ void init(int s, float *a, float *b) {
 /// Crout algorithm GPU
 /// s = size of matrix
 void Crout_GPU(int s, float *a, float *b) {
+  bench_phase_start();
+#pragma omp target enter data map(to : a[0 : SIZE *SIZE], b[0 : SIZE *SIZE])   \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, 2 * SIZE * SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : a[0 : SIZE *SIZE]) map(tofrom : b[0 : SIZE *SIZE]) \
     device(DEVICE_ID)
   {
@@ -75,6 +83,12 @@ void Crout_GPU(int s, float *a, float *b) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : b[0 : SIZE *SIZE])                     \
+    map(release : a[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * SIZE * sizeof(float));
 }
 
 void Crout_CPU(int s, float *a, float *b) {
@@ -121,14 +135,16 @@ int compareResults(float *b_cpu, float *b_gpu) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
   int i;
 
   float *a, *b_cpu, *b_gpu;
-  a = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  b_cpu = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  b_gpu = (float *)malloc(sizeof(float) * SIZE * SIZE);
+  a = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  b_cpu = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  b_gpu = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
 
   fprintf(stdout, "<< LU decomposition GPU >>\n");
 
@@ -139,6 +155,7 @@ int main(int argc, char *argv[]) {
   }
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
@@ -148,13 +165,14 @@ int main(int argc, char *argv[]) {
   }
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(b_cpu, b_gpu);
 #endif
 
-  free(a);
-  free(b_cpu);
-  free(b_gpu);
+  bench_free(a);
+  bench_free(b_cpu);
+  bench_free(b_gpu);
 
   return fail;
 }
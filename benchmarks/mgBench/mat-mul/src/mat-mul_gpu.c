@@ -23,7 +23,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -46,6 +46,13 @@ void init(float *a, float *b, float *c_cpu, float *c_gpu) {
 /// s = size of matrix
 void mul_GPU(float *a, float *b, float *c) {
 
+  bench_phase_start();
+#pragma omp target enter data                                                  \
+    map(to : a[ : SIZE *SIZE], b[0 : SIZE *SIZE], c[ : SIZE *SIZE])            \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, 3 * SIZE * SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : a[ : SIZE *SIZE], b[0 : SIZE *SIZE])               \
                            map(tofrom : c[ : SIZE *SIZE]) device(DEVICE_ID)
   {
@@ -60,6 +67,12 @@ void mul_GPU(float *a, float *b, float *c) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : c[ : SIZE *SIZE])                      \
+    map(release : a[ : SIZE *SIZE], b[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * SIZE * sizeof(float));
 }
 
 void mul_CPU(float *a, float *b, float *c) {
@@ -102,15 +115,16 @@ int compareResults(float *b_cpu, float *b_gpu) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
 
   double t_start, t_end;
   int fail = 0;
   float *a, *b, *c_cpu, *c_gpu;
 
-  a = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  b = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  c_cpu = (float *)calloc(sizeof(float), SIZE * SIZE);
-  c_gpu = (float *)calloc(sizeof(float), SIZE * SIZE);
+  a = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  b = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  c_cpu = (float *)bench_calloc(sizeof(float), SIZE * SIZE);
+  c_gpu = (float *)bench_calloc(sizeof(float), SIZE * SIZE);
 
   init(a, b, c_cpu, c_gpu);
 
@@ -120,20 +134,22 @@ int main(int argc, char *argv[]) {
   mul_GPU(a, b, c_gpu);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   mul_CPU(a, b, c_cpu);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(c_cpu, c_gpu);
 #endif
 
-  free(a);
-  free(b);
-  free(c_cpu);
-  free(c_gpu);
+  bench_free(a);
+  bench_free(b);
+  bench_free(c_cpu);
+  bench_free(c_gpu);
 
   return fail;
 }
@@ -23,7 +23,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -47,6 +47,13 @@ void init(float *a, float *b, float *c_cpu, float *c_gpu) {
 void sum_GPU(float *a, float *b, float *c) {
   int i, j;
 
+  bench_phase_start();
+#pragma omp target enter data                                                  \
+    map(to : a[0 : SIZE *SIZE], b[0 : SIZE *SIZE], c[0 : SIZE *SIZE])          \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, 3 * SIZE * SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : a[0 : SIZE *SIZE], b[0 : SIZE *SIZE])              \
                            map(tofrom : c[0 : SIZE *SIZE]) device(DEVICE_ID)
   {
@@ -57,6 +64,12 @@ void sum_GPU(float *a, float *b, float *c) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : c[0 : SIZE *SIZE])                     \
+    map(release : a[0 : SIZE *SIZE], b[0 : SIZE *SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * SIZE * sizeof(float));
 }
 
 /// matrix sum algorithm CPU
@@ -92,14 +105,16 @@ int compareResults(float *b_cpu, float *b_gpu) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   float *a, *b, *c_cpu, *c_gpu;
   int fail = 0;
 
-  a = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  b = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  c_cpu = (float *)malloc(sizeof(float) * SIZE * SIZE);
-  c_gpu = (float *)malloc(sizeof(float) * SIZE * SIZE);
+  a = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  b = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  c_cpu = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
+  c_gpu = (float *)bench_malloc(sizeof(float) * SIZE * SIZE);
 
   fprintf(stdout, "<< Matrix Sum >>\n");
 
@@ -109,20 +124,22 @@ int main(int argc, char *argv[]) {
   sum_GPU(a, b, c_gpu);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   sum_CPU(a, b, c_cpu);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(c_cpu, c_gpu);
 #endif
 
-  free(a);
-  free(b);
-  free(c_cpu);
-  free(c_gpu);
+  bench_free(a);
+  bench_free(b);
+  bench_free(c_cpu);
+  bench_free(c_gpu);
 
   return fail;
 }
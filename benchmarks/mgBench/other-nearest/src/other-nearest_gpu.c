@@ -23,7 +23,7 @@ typedef struct sel_points {
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 500
 #endif
 
@@ -51,6 +51,12 @@ void k_nearest_gpu(int s, point *vector, sel_points *selected) {
   int i, j, m, q;
   q = s * s;
 
+  bench_phase_start();
+#pragma omp target enter data map(to : vector[0 : s], selected[0 : q])         \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, s * sizeof(point) + q * sizeof(sel_points));
+
+  bench_phase_start();
 #pragma omp target map(to : vector[0 : s]) map(tofrom : selected[0 : q])       \
     device(DEVICE_ID)
   {
@@ -90,6 +96,12 @@ void k_nearest_gpu(int s, point *vector, sel_points *selected) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : selected[0 : q])                       \
+    map(release : vector[0 : s]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, q * sizeof(sel_points));
 }
 
 void k_nearest_cpu(int s, point *vector, sel_points *selected) {
@@ -162,15 +174,17 @@ int compareResults(sel_points *B, sel_points *B_GPU) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
 
   point *vector;
   sel_points *selected_cpu, *selected_gpu;
 
-  vector = (point *)malloc(sizeof(point) * SIZE);
-  selected_cpu = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
-  selected_gpu = (sel_points *)malloc(sizeof(sel_points) * SIZE * SIZE);
+  vector = (point *)bench_malloc(sizeof(point) * SIZE);
+  selected_cpu = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
+  selected_gpu = (sel_points *)bench_malloc(sizeof(sel_points) * SIZE * SIZE);
 
   int i;
 
@@ -184,6 +198,7 @@ int main(int argc, char *argv[]) {
   }
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
@@ -193,12 +208,13 @@ int main(int argc, char *argv[]) {
   }
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
   fail = compareResults(selected_cpu, selected_gpu);
 #endif
 
-  free(selected_cpu);
-  free(selected_gpu);
-  free(vector);
+  bench_free(selected_cpu);
+  bench_free(selected_gpu);
+  bench_free(vector);
   return fail;
 }
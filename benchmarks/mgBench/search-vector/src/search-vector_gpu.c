@@ -24,7 +24,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -44,6 +44,12 @@ int search_GPU(float *a, float c) {
 
   find2 = &find;
 
+  bench_phase_start();
+#pragma omp target enter data map(to : a[ : SIZE]) map(alloc : find2[ : 1])    \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : a[ : SIZE]) map(from : find2[ : 1])                \
     device(DEVICE_ID)
   {
@@ -55,6 +61,12 @@ int search_GPU(float *a, float c) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : find2[ : 1]) map(release : a[ : SIZE]) \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, sizeof(int));
 
   return find;
 }
@@ -74,13 +86,15 @@ int search_CPU(float *a, float c) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
 
   float *a, c;
   int find_cpu, find_gpu;
 
-  a = (float *)malloc(sizeof(float) * SIZE);
+  a = (float *)bench_malloc(sizeof(float) * SIZE);
   c = (float)SIZE - 5;
 
   init(a);
@@ -91,12 +105,14 @@ int main(int argc, char *argv[]) {
   find_gpu = search_GPU(a, c);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   find_cpu = search_CPU(a, c);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   if (find_gpu == find_cpu) {
     printf("Working %d=%d\n", find_gpu, find_cpu);
@@ -106,7 +122,7 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
-  free(a);
+  bench_free(a);
 
   return fail;
 }
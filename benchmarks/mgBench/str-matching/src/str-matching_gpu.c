@@ -25,7 +25,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -57,12 +57,20 @@ int string_matching_GPU(char *frase, char *palavra) {
 
   parallel_size = 10000;
   int *vector;
-  vector = (int *)malloc(sizeof(int) * parallel_size);
+  vector = (int *)bench_malloc(sizeof(int) * parallel_size);
 
   for (i = 0; i < parallel_size; i++) {
     vector[i] = 0;
   }
 
+  bench_phase_start();
+#pragma omp target enter data map(                                             \
+    to : frase[0 : SIZE], palavra[0 : SIZE2], vector[0 : parallel_size])       \
+    device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, (SIZE + SIZE2) * sizeof(char) +
+                                       parallel_size * sizeof(int));
+
+  bench_phase_start();
 #pragma omp target map(to : frase[0 : SIZE], palavra[0 : SIZE2]) map(          \
     tofrom : vector[0 : parallel_size]) device(DEVICE_ID)
   {
@@ -79,6 +87,12 @@ int string_matching_GPU(char *frase, char *palavra) {
       }
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : vector[0 : parallel_size])             \
+    map(release : frase[0 : SIZE], palavra[0 : SIZE2]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, parallel_size * sizeof(int));
 
   return count;
 }
@@ -105,6 +119,8 @@ int string_matching_CPU(char *frase, char *palavra) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
+
   double t_start, t_end;
   int fail = 0;
 
@@ -113,8 +129,8 @@ int main(int argc, char *argv[]) {
 
   int count_cpu, count_gpu;
 
-  frase = (char *)malloc(sizeof(char) * (SIZE + 1));
-  palavra = (char *)malloc(sizeof(char) * (SIZE2 + 1));
+  frase = (char *)bench_malloc(sizeof(char) * (SIZE + 1));
+  palavra = (char *)bench_malloc(sizeof(char) * (SIZE2 + 1));
 
   init(frase, palavra);
 
@@ -124,12 +140,14 @@ int main(int argc, char *argv[]) {
   count_cpu = string_matching_CPU(frase, palavra);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   count_gpu = string_matching_GPU(frase, palavra);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
   if (count_cpu == count_gpu) {
     printf("Corrects answers: %d = %d\n", count_cpu, count_gpu);
@@ -140,8 +158,8 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
-  free(frase);
-  free(palavra);
+  bench_free(frase);
+  bench_free(palavra);
 
   return fail;
 }
@@ -26,7 +26,7 @@
 #define SIZE 1100
 #elif RUN_BENCHMARK
 #define SIZE 9600
-#else
+#elif !defined(RUNTIME)
 #define SIZE 1000
 #endif
 
@@ -44,6 +44,12 @@ void init_arrays(float *A, float *B) {
 void product_GPU(float *A, float *B, float *C) {
   int i;
 
+  bench_phase_start();
+#pragma omp target enter data map(to : A[0 : SIZE], B[0 : SIZE])               \
+    map(alloc : C[0 : SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_H2D, 2 * SIZE * sizeof(float));
+
+  bench_phase_start();
 #pragma omp target map(to : A[0 : SIZE], B[0 : SIZE]) map(from : C[0 : SIZE])  \
                            device(DEVICE_ID)
   {
@@ -52,6 +58,12 @@ void product_GPU(float *A, float *B, float *C) {
       C[i] = A[i] * B[i];
     }
   }
+  bench_phase_stop(BENCH_PHASE_KERNEL, 0);
+
+  bench_phase_start();
+#pragma omp target exit data map(from : C[0 : SIZE])                           \
+    map(release : A[0 : SIZE], B[0 : SIZE]) device(DEVICE_ID)
+  bench_phase_stop(BENCH_PHASE_D2H, SIZE * sizeof(float));
 }
 
 void product_CPU(float *A, float *B, float *C) {
@@ -83,15 +95,16 @@ int compareResults(float *A, float *A_outputFromGpu) {
 }
 
 int main(int argc, char *argv[]) {
+  BENCH_SIZE_SYNC();
 
   double t_start, t_end;
   float *A, *B, *C_CPU, *C_GPU;
   int fail = 0;
 
-  A = (float *)malloc(sizeof(float) * SIZE);
-  B = (float *)malloc(sizeof(float) * SIZE);
-  C_CPU = (float *)malloc(sizeof(float) * SIZE);
-  C_GPU = (float *)malloc(sizeof(float) * SIZE);
+  A = (float *)bench_malloc(sizeof(float) * SIZE);
+  B = (float *)bench_malloc(sizeof(float) * SIZE);
+  C_CPU = (float *)bench_malloc(sizeof(float) * SIZE);
+  C_GPU = (float *)bench_malloc(sizeof(float) * SIZE);
 
   fprintf(stdout, "<< Vector Product >>\n");
   init_arrays(A, B);
@@ -100,20 +113,22 @@ int main(int argc, char *argv[]) {
   product_GPU(A, B, C_GPU);
   t_end = rtclock();
   fprintf(stdout, "GPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_phases_emit_time(BENCH_KERNEL, __OMP_DEVICE_NAME, SIZE, t_end - t_start);
 
 #ifdef RUN_TEST
   t_start = rtclock();
   product_CPU(A, B, C_CPU);
   t_end = rtclock();
   fprintf(stdout, "CPU Runtime: %0.6lfs\n", t_end - t_start);
+  bench_result_emit_time(BENCH_KERNEL, "CPU", SIZE, t_end - t_start);
 
   fail = compareResults(C_CPU, C_GPU);
 #endif
 
-  free(A);
-  free(B);
-  free(C_CPU);
-  free(C_GPU);
+  bench_free(A);
+  bench_free(B);
+  bench_free(C_CPU);
+  bench_free(C_GPU);
 
   return fail;
 }
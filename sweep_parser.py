@@ -0,0 +1,168 @@
+"""Analyzes a size sweep written by `./unibench sweep`
+
+Reads the JSON-lines records of one kernel run over a geometric range of
+sizes, computes the throughput of each size and locates the sizes where it
+falls off, next to the capacity of each level of the cache hierarchy.
+
+Usage: python3 sweep_parser.py <results.jsonl> [drop threshold, default 0.15]
+"""
+from os import path
+import glob
+import math
+import statistics
+import sys
+
+from benchmark_parser import parse_results_file
+
+CACHE_DIR = "/sys/devices/system/cpu/cpu0/cache"
+
+
+def parse_cache_size(s:str) -> int:
+    """Converts a sysfs cache size such as '48K' or '32M' to bytes"""
+    units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30}
+    s = s.strip()
+    return int(s[:-1]) * units[s[-1]] if s[-1] in units else int(s)
+
+
+def count_cpus(cpu_list:str) -> int:
+    """Counts the CPUs of a sysfs list such as '0-3,8-11'"""
+    n = 0
+    for r in cpu_list.strip().split(','):
+        lo, _, hi = r.partition('-')
+        n += int(hi or lo) - int(lo) + 1
+    return n
+
+
+def read_caches(threads:int) -> list:
+    """Reads the data cache levels of the host
+
+    The capacity seen by a kernel running on `threads` threads is the size of
+    one cache times the number of such caches the threads spread over.
+
+    Returns: List of (name, size, effective size) sorted by level
+    """
+    caches = []
+    for d in sorted(glob.glob(path.join(CACHE_DIR, "index*"))):
+        read = lambda f: open(path.join(d, f)).read().strip()
+        try:
+            if read("type") == "Instruction":
+                continue
+            level = int(read("level"))
+            size = parse_cache_size(read("size"))
+            sharers = count_cpus(read("shared_cpu_list"))
+        except (OSError, ValueError):
+            continue
+        name = f'L{level}' + ('d' if level == 1 else '')
+        caches.append((name, size, size * max(1, threads // sharers)))
+    return sorted(caches, key=lambda c: c[1])
+
+
+def format_bytes(n:float) -> str:
+    for unit in ('B', 'KiB', 'MiB', 'GiB'):
+        if n < 1024 or unit == 'GiB':
+            return f'{n:.0f} {unit}' if unit == 'B' else f'{n:.1f} {unit}'
+        n /= 1024
+
+
+def segment(y:list, threshold:float) -> list:
+    """Splits a curve into flat segments by binary segmentation
+
+    Each step splits the segment at the point that most reduces the squared
+    error around the segment means, as long as both sides keep two points and
+    their means differ by more than `threshold` (relative).
+
+    Returns: Sorted list of the indices where a new segment starts
+    """
+    def sse(a):
+        m = statistics.mean(a)
+        return sum((v - m) ** 2 for v in a)
+
+    def split(lo, hi):
+        best, cut = 0.0, None
+        for k in range(lo + 2, hi - 1):
+            gain = sse(y[lo:hi]) - sse(y[lo:k]) - sse(y[k:hi])
+            if gain > best:
+                best, cut = gain, k
+        if cut is None:
+            return []
+        left, right = statistics.mean(y[lo:cut]), statistics.mean(y[cut:hi])
+        if abs(math.exp(right - left) - 1.0) <= threshold:
+            return []
+        return split(lo, cut) + [cut] + split(cut, hi)
+
+    return split(0, len(y))
+
+
+def analyze(records:list, threshold:float):
+    """Prints the throughput curve and the transitions of each device"""
+    devices = dict()
+    for r in records:
+        devices.setdefault(r.get('device'), []).append(r)
+
+    for device, recs in devices.items():
+        # one point per size, median of all the samples of that size
+        points = dict()
+        for r in recs:
+            p = points.setdefault(r['size'], {'times': [], 'r': r})
+            p['times'].extend(t for t in r.get('times', []) if t is not None)
+        points = [(size, p['r'], statistics.median(p['times']))
+                  for size, p in sorted(points.items()) if p['times']]
+        if len(points) < 4:
+            print(f'{device}: not enough sizes to analyze ({len(points)})')
+            continue
+
+        r0 = points[0][1]
+        unit = 'GFLOP/s' if r0.get('flops') else 'GB/s' if r0.get('bytes') \
+            else 'runs/s'
+        amount = lambda r: r.get('flops') or r.get('bytes') or 1e9
+        rates = [amount(r) / t * 1e-9 for _, r, t in points]
+        footprint = [r.get('bytes') for _, r, _ in points]
+        threads = r0.get('threads', 1)
+
+        print(f'Sweep of {r0["kernel"]} on {device} ({threads} threads), '
+              f'{len(points)} sizes')
+        print(f'{"size":>8} {"footprint":>12} {unit:>12}')
+        for (size, _, _), fp, rate in zip(points, footprint, rates):
+            fp_s = format_bytes(fp) if fp else '-'
+            print(f'{size:>8} {fp_s:>12} {rate:>12.3f}')
+
+        caches = read_caches(threads)
+        if caches:
+            print('Caches: ' + ', '.join(
+                f'{name} {format_bytes(size)}' +
+                (f' ({format_bytes(eff)} over {threads} threads)'
+                 if eff != size else '') for name, size, eff in caches))
+
+        cuts = segment([math.log(r) for r in rates], threshold)
+        bounds = [0] + cuts + [len(rates)]
+        means = [statistics.mean(rates[a:b]) for a, b in zip(bounds, bounds[1:])]
+        drops = [(k, before, after) for k, before, after
+                 in zip(cuts, means, means[1:]) if after < before]
+        if not drops:
+            print(f'No drop beyond {threshold:.0%} in the swept range')
+        for k, before, after in drops:
+            lo, hi = points[k - 1][0], points[k][0]
+            line = f'Drop between N={lo} and N={hi}: {before:.3f} -> ' \
+                   f'{after:.3f} {unit} ({after / before - 1.0:+.0%})'
+            if footprint[k - 1] and footprint[k]:
+                mid = math.sqrt(footprint[k - 1] * footprint[k])
+                line += f', footprint {format_bytes(footprint[k - 1])} -> ' \
+                        f'{format_bytes(footprint[k])}'
+                if caches:
+                    # the cache level whose capacity is closest, in log scale
+                    name, _, eff = min(
+                        caches, key=lambda c: abs(math.log(c[2] / mid)))
+                    if abs(math.log(eff / mid)) <= math.log(4):
+                        line += f', leaving {name} ({format_bytes(eff)})'
+                    elif mid > caches[-1][2]:
+                        line += ', in DRAM'
+            print(line)
+        print()
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    threshold = float(sys.argv[2]) if len(sys.argv) > 2 else 0.15
+    analyze(parse_results_file(sys.argv[1]), threshold)